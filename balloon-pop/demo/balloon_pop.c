@@ -1,5 +1,6 @@
 #include "../include/body.h"
 #include "../include/sdl_wrapper.h"
+#include "../include/timing.h"
 #include "../include/list.h"
 #include "../include/vector.h"
 #include "../include/utils.h"
@@ -23,11 +24,8 @@ const RGBColor BLACK = (RGBColor) {0, 0, 0};
 // screen dimensions
 #define LENGTH_AND_HEIGHT (Vector){1000, 500}
 
-// Constants for gravity
-#define G 6.67E-11 // N m^2 / kg^2
-#define M 6E24 // kg
+// Acceleration due to gravity
 #define g 9.8 // m / s^2
-#define R (sqrt(G * M / g)) // m
 
 const RGBColor RED = (RGBColor) {1, 0, 0};
 const RGBColor ORANGE = (RGBColor) {1, 127.0/255, 0};
@@ -41,7 +39,7 @@ const Vector OUTER_BAR_CENTER = {-375, -225};
 const double OUTER_BAR_WIDTH = 100;
 const double BAR_HEIGHT = 20;
 const int POWER_DIVISIONS = 100;
-const int BALLOON_IDX_START = POWER_DIVISIONS+3;
+const int BALLOON_IDX_START = POWER_DIVISIONS+2;
 
 const double ARROW_WIDTH = 60;
 const double ARROW_HEIGHT = 4;
@@ -79,6 +77,11 @@ const int FONT_SIZE = 12;
 const int SCORE_TEXT_WIDTH = 320;
 const int SCORE_TEXT_HEIGHT = 30;
 const Vector SCORE_TEXT_POSITION = {-160, -215};
+// Game seconds per real second, to speed up physics
+const double GAME_SPEED = 3;
+const double PHYSICS_DT = 1.0 / 120;
+const size_t MAX_STEPS_PER_FRAME = 8;
+const double TARGET_FPS = 60;
 
 typedef struct {
     double power;
@@ -141,29 +144,15 @@ void spawn_arrow(GameInfo *game_info) {
     scene_add_body(scene, arrow);
 }
 
-/** Creates an Earth-like mass to accelerate the balls */
-void spawn_gravity_body(GameInfo *game_info) {
-    Scene* scene = get_scene(game_info);
-    // Will be offscreen, so shape is irrelevant
-    List *gravity_ball = get_circle_points(VEC_ZERO, 1);
-    Role *type = malloc(sizeof(*type));
-    *type = NEVER_REMOVE_ON_COLLISION;
-    Body *body = body_init_with_info(gravity_ball, M, BLACK, type, free);
-
-    // Move a distance R below the scene
-    Vector gravity_center = {.x = LENGTH_AND_HEIGHT.x/2, .y = -R};
-    body_set_centroid(body, gravity_center);
-    scene_add_body(scene, body);
-}
-
 void spawn_wall(GameInfo* game_info) {
     Scene* scene = get_scene(game_info);
-    List* points = get_rectangle((Vector){-150, 0}, \
-     15, 100);
-    Role *type = malloc(sizeof(Role));
-    assert(type);
+    // The wall only exists for one level, so it lives in the level arena
+    Arena* arena = scene_get_arena(scene);
+    List* points = get_rectangle_arena((Vector){-150, 0}, \
+     15, 100, arena);
+    Role *type = arena_alloc(arena, sizeof(Role));
     *type = NEVER_REMOVE_ON_COLLISION;
-    Body* wall = body_init_with_info(points, INFINITY, BLACK, type, free);
+    Body* wall = body_init_arena(points, INFINITY, BLACK, type, NULL, arena);
     scene_add_body(scene, wall);
 }
 
@@ -175,20 +164,36 @@ Body* spawn_dart(GameInfo *game_info) {
     Role *type = malloc(sizeof(Role));
     assert(type);
     *type = PLAYER;
+    // Darts fall in the scene's PLAYER gravity field set up in main()
     Body* dart = body_init_with_info(dart_pts, DART_MASS, BLACK, type, free);
-
-    /*
-     * Now, we have to add the gravity force to the ball. We know that the
-     * gravity body was instantiated after POWER_DIVISIONS bodies, followed by
-     * a single arrow body.
-     */
-    Body* gravity_body = scene_get_body(scene, POWER_DIVISIONS + 1);
-    assert(body_get_role(gravity_body) == (Role) NEVER_REMOVE_ON_COLLISION);
-    create_newtonian_gravity(scene, G, gravity_body, dart);
     scene_add_body(scene, dart);
     return dart;
 }
 
+int balloons_left(GameInfo* game_info) {
+    Scene *scene = get_scene(game_info);
+    size_t count = 0;
+
+    for (size_t i = BALLOON_IDX_START; i < scene_bodies(scene); i++) {
+        Body* body = scene_get_body(scene, i);
+
+        if (body_get_role(body) == REMOVE_ON_COLLISION) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void destroy_balloons(Scene *scene, Body* dart, GameInfo* game_info) {
+    int left = balloons_left(game_info);
+
+    for (size_t i = BALLOON_IDX_START; i < BALLOON_IDX_START+left+1; i++) {
+        Body *curr_body = scene_get_body(scene, i);
+        create_destructive_collision(scene, curr_body, dart);
+    }
+}
+
 /**
  * Handles key presses from the user. Arrows keys change the direction of
  * the arrow. Power is determined by how long the space bar is held
@@ -223,6 +228,7 @@ void on_key(char key, KeyEventType type, double held_time, void* info) {
               if (no_darts_on_screen(scene)) {
                   double power = i->power;
                   Body* dart = spawn_dart(game_info);
+                  destroy_balloons(scene, dart, game_info);
                   Vector dart_velocity = (Vector){MAX_DART_VELOCITY * cos(angle), MAX_DART_VELOCITY * sin(angle)};
                   body_set_velocity(dart, vec_multiply(power, dart_velocity));
                   i->dartsLeft--;
@@ -266,6 +272,7 @@ void on_key(char key, KeyEventType type, double held_time, void* info) {
 
 void spawn_balloons_l1(GameInfo* game_info) {
     Scene *scene = get_scene(game_info);
+    Arena *arena = scene_get_arena(scene);
     const RGBColor RAINBOW_COLORS[7] = {RED, ORANGE, YELLOW, GREEN, BLUE, INDIGO, VIOLET};
     Vector top_left = (Vector){-(NUM_COLS1 + (GAP + BALLOON_WIDTH) * NUM_COLS1) / 2, (BUFFER + NUM_ROWS1 + (GAP + BALLOON_HEIGHT) * NUM_ROWS1)/ 2};
 
@@ -275,12 +282,11 @@ void spawn_balloons_l1(GameInfo* game_info) {
             Vector balloon_center = (Vector){GAP + top_left.x + \
                 (BALLOON_WIDTH + GAP) * j + BALLOON_WIDTH / 2, y_coord};
             if ((i != 0 && i != NUM_ROWS1 - 1) || (j != 0 && j != NUM_COLS1 - 1) ) {
-            List* balloon_pts = get_bloon_points(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT);
-            Role *type = malloc(sizeof(Role));
-            assert(type);
+            List* balloon_pts = get_bloon_points_arena(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT, arena);
+            Role *type = arena_alloc(arena, sizeof(Role));
             *type = REMOVE_ON_COLLISION;
             int color = pseudo_rand_int(0,6);
-            Body* balloon = body_init_with_info(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, free);
+            Body* balloon = body_init_arena(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, NULL, arena);
             scene_add_body(scene, balloon);
           }
         }
@@ -289,6 +295,7 @@ void spawn_balloons_l1(GameInfo* game_info) {
 
 void spawn_balloons_l2(GameInfo* game_info) {
     Scene *scene = get_scene(game_info);
+    Arena *arena = scene_get_arena(scene);
     const RGBColor RAINBOW_COLORS[7] = {RED, ORANGE, YELLOW, GREEN, BLUE, INDIGO, VIOLET};
     Vector top_left = (Vector){-(NUM_COLS2 + (GAP + BALLOON_WIDTH) * NUM_COLS2) / 2, (BUFFER + NUM_ROWS2 + (GAP + BALLOON_HEIGHT) * NUM_ROWS2)/ 2};
 
@@ -298,12 +305,11 @@ void spawn_balloons_l2(GameInfo* game_info) {
             Vector balloon_center = (Vector){GAP + top_left.x + \
                 (BALLOON_WIDTH + GAP) * j + BALLOON_WIDTH / 2, y_coord};
             if (i != 3 && i != 4 && j != 3 && j != 4) {
-            List* balloon_pts = get_bloon_points(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT);
-            Role *type = malloc(sizeof(Role));
-            assert(type);
+            List* balloon_pts = get_bloon_points_arena(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT, arena);
+            Role *type = arena_alloc(arena, sizeof(Role));
             *type = REMOVE_ON_COLLISION;
             int color = pseudo_rand_int(0,6);
-            Body* balloon = body_init_with_info(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, free);
+            Body* balloon = body_init_arena(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, NULL, arena);
             scene_add_body(scene, balloon);
           }
         }
@@ -312,6 +318,7 @@ void spawn_balloons_l2(GameInfo* game_info) {
 
 void spawn_balloons_l3(GameInfo* game_info) {
     Scene *scene = get_scene(game_info);
+    Arena *arena = scene_get_arena(scene);
     spawn_wall(game_info);
     const RGBColor RAINBOW_COLORS[7] = {RED, ORANGE, YELLOW, GREEN, BLUE, INDIGO, VIOLET};
     Vector top_left = (Vector){-(NUM_COLS3 + (GAP + BALLOON_WIDTH) * NUM_COLS3) / 2, (BUFFER + NUM_ROWS3 + (GAP + BALLOON_HEIGHT) * NUM_ROWS3)/ 2};
@@ -322,12 +329,11 @@ void spawn_balloons_l3(GameInfo* game_info) {
             Vector balloon_center = (Vector){GAP + top_left.x + \
                 (BALLOON_WIDTH + GAP) * j + BALLOON_WIDTH / 2, y_coord};
             if ((i != 0 && i != NUM_ROWS3 - 1) || (j != 0 && j != NUM_COLS3 - 1) ) {
-            List* balloon_pts = get_bloon_points(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT);
-            Role *type = malloc(sizeof(Role));
-            assert(type);
+            List* balloon_pts = get_bloon_points_arena(balloon_center, BALLOON_WIDTH, BALLOON_HEIGHT, arena);
+            Role *type = arena_alloc(arena, sizeof(Role));
             *type = REMOVE_ON_COLLISION;
             int color = pseudo_rand_int(0,6);
-            Body* balloon = body_init_with_info(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, free);
+            Body* balloon = body_init_arena(balloon_pts, INFINITY, RAINBOW_COLORS[color], type, NULL, arena);
             scene_add_body(scene, balloon);
           }
         }
@@ -359,42 +365,6 @@ GameInfo* setup_game(void) {
     return game_info;
 }
 
-void clear_balloons(GameInfo* game_info) {
-    Scene *scene = get_scene(game_info);
-
-    for (size_t i = BALLOON_IDX_START-1; i < scene_bodies(scene); i++) {
-        Body* body = scene_get_body(scene, i);
-
-        if (body_get_role(body) == REMOVE_ON_COLLISION) {
-            body_remove(body);
-        }
-    }
-}
-
-int balloons_left(GameInfo* game_info) {
-    Scene *scene = get_scene(game_info);
-    size_t count = 0;
-
-    for (size_t i = BALLOON_IDX_START; i < scene_bodies(scene); i++) {
-        Body* body = scene_get_body(scene, i);
-
-        if (body_get_role(body) == REMOVE_ON_COLLISION) {
-            count++;
-        }
-    }
-
-    return count;
-}
-
-void destroy_balloons(Scene *scene, Body* dart, GameInfo* game_info) {
-    int left = balloons_left(game_info);
-
-    for (size_t i = BALLOON_IDX_START; i < BALLOON_IDX_START+left+1; i++) {
-        Body *curr_body = scene_get_body(scene, i);
-        create_destructive_collision(scene, curr_body, dart);
-    }
-}
-
 int restart(GameInfo* game_info) {
     AdditionalInfo* info = get_additional_info(game_info);
     Scene *scene = get_scene(game_info);
@@ -418,7 +388,8 @@ int level_completed(GameInfo* game_info) {
 }
 
 void destroy_bullet(Scene *scene) {
-    for (size_t i = BALLOON_IDX_START - 3; i < scene_bodies(scene); i++) {
+    // Darts come after the power bars, starting from the arrow's index
+    for (size_t i = POWER_DIVISIONS; i < scene_bodies(scene); i++) {
         Body *body = scene_get_body(scene, i);
         if (body_get_role(body) == PLAYER) {
             if (body_get_centroid(body).y + DART_LENGTH < (LENGTH_AND_HEIGHT.y * -0.5) || fabs(body_get_centroid(body).x + DART_LENGTH) > (LENGTH_AND_HEIGHT.x * 0.5)) {
@@ -431,7 +402,8 @@ void destroy_bullet(Scene *scene) {
 void load_level(GameInfo* game_info) {
     AdditionalInfo* info = get_additional_info(game_info);
     info->dartsLeft = 5;
-    clear_balloons(game_info);
+    // Every balloon, wall and collision of the old level lives in the arena
+    scene_reset_arena(get_scene(game_info));
 
     if (info->level == 1) {
         spawn_balloons_l1(game_info);
@@ -443,6 +415,11 @@ void load_level(GameInfo* game_info) {
 }
 
 
+/* The game has always integrated once more, without forces, after each tick */
+void tick_no_forces(Scene *scene, double dt, void *aux) {
+    scene_tick_no_forces(scene, dt);
+}
+
 int main(int argc, char* argv[]) {
 
     GameInfo* game_info = setup_game();
@@ -452,7 +429,8 @@ int main(int argc, char* argv[]) {
      * ordering to determine which index a certain body of the scene is at. */
     initialize_power_bars(game_info);
     spawn_arrow(game_info);
-    spawn_gravity_body(game_info);
+    // Only darts fall; balloons, the arrow and the power bars stay put
+    scene_set_role_gravity(get_scene(game_info), PLAYER, (Vector) {0, -g});
     load_level(game_info);
     spawn_sprite(game_info, PLAYER_SPRITE_PATH, ARCHER_POSITION, ARCHER_WIDTH, \
         ARCHER_HEIGHT);
@@ -467,21 +445,20 @@ int main(int argc, char* argv[]) {
 
     Scene *scene = get_scene(game_info);
     sdl_on_key(on_key, game_info);
+    FixedStep *stepper = fixed_step_init(scene, PHYSICS_DT, MAX_STEPS_PER_FRAME);
+    fixed_step_on_tick(stepper, tick_no_forces, NULL);
+    FrameTimer *timer = frame_timer_init(TARGET_FPS);
 
     while (!sdl_is_done()) {
-        dt = time_since_last_tick();
+        dt = frame_timer_tick(timer);
         time_elapsed += dt;
-        // Multiply by constant to speed up physics
-        scene_tick(scene, 3 * dt);
-        scene_tick_no_forces(scene, 3 * dt);
+        fixed_step_advance(stepper, GAME_SPEED * dt);
 
         if (!no_darts_on_screen(scene)) {
-            Body* dart = scene_get_body(scene, scene_bodies(scene) - 1);
-            destroy_balloons(scene, dart, game_info);
             destroy_bullet(scene);
         }
 
-        sdl_render_game(game_info);
+        sdl_render_game_interpolated(game_info, stepper);
 
         if (restart(game_info)) {
             load_level(game_info);
@@ -492,6 +469,8 @@ int main(int argc, char* argv[]) {
 
             if (info->level == 3) {
                 printf("Congratulations you win!\n");
+                frame_timer_free(timer);
+                fixed_step_free(stepper);
                 game_info_free(game_info);
                 exit(0);
             } else {
@@ -500,6 +479,8 @@ int main(int argc, char* argv[]) {
             }
         }
     }
+    frame_timer_free(timer);
+    fixed_step_free(stepper);
     game_info_free(game_info);
     return 0;
 }
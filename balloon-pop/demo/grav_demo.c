@@ -1,5 +1,6 @@
 #include "../include/body.h"
 #include "../include/sdl_wrapper.h"
+#include "../include/timing.h"
 #include "../include/list.h"
 #include "../include/vector.h"
 #include "../include/utils.h"
@@ -21,6 +22,10 @@ const double TIME_SPACING = 2;
 const double STARTING_MASS = 1.0;   // Not relevant for this demo
 const int POINTS = 4;
 const int NUM_BODIES = 50;
+const double THETA = 0.5;   // Barnes-Hut opening angle
+const double PHYSICS_DT = 1.0 / 120;
+const size_t MAX_STEPS_PER_FRAME = 8;
+const double TARGET_FPS = 60;
 
 Scene* initialize_scene_grav(void) {
     Scene* scene = scene_init();
@@ -34,29 +39,25 @@ Scene* initialize_scene_grav(void) {
     return scene;
 }
 
-void apply_gravitational_force(Scene *scene) {
-  for (size_t i = 0; i < scene_bodies(scene); i++) {
-    for(size_t j = i; j < scene_bodies(scene); j++) {
-      create_newtonian_gravity(scene, G, scene_get_body(scene, i), \
-                                         scene_get_body(scene, j));
-    }
-  }
-}
-
 int main(int argc, char* argv[]) {
     Vector bottom_left = vec_multiply(-0.5, LENGTH_AND_HEIGHT);
     Vector top_right = vec_multiply(0.5, LENGTH_AND_HEIGHT);
 
     sdl_init(bottom_left, top_right);
     Scene* scene = initialize_scene_grav();
+    create_barnes_hut_gravity(scene, G, THETA);
+    // Verlet keeps the orbits' energy from creeping up over time
+    scene_set_integrator(scene, INTEGRATOR_VELOCITY_VERLET);
 
+    FixedStep *stepper = fixed_step_init(scene, PHYSICS_DT, MAX_STEPS_PER_FRAME);
+    FrameTimer *timer = frame_timer_init(TARGET_FPS);
     while (!sdl_is_done()) {
-        double dt = time_since_last_tick();
-        apply_gravitational_force(scene);
-
-        scene_tick(scene, dt);
+        double dt = frame_timer_tick(timer);
+        fixed_step_advance(stepper, dt);
 
-        sdl_render_scene(scene);
+        sdl_render_scene_interpolated(scene, stepper);
     }
+    frame_timer_free(timer);
+    fixed_step_free(stepper);
     scene_free(scene);
 }
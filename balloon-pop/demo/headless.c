@@ -0,0 +1,66 @@
+/*
+ * Ticks a scene of gravitating, colliding bodies as fast as possible,
+ * with no window, and reports how long it took.
+ * Links only the physics library, so it runs on machines without SDL.
+ *
+ * Usage: bin/headless [bodies] [ticks] [threads]
+ * threads is the number of worker threads to tick on; 0 ticks on one thread.
+ */
+#include "forces.h"
+#include "job_system.h"
+#include "scene.h"
+#include "timing.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t DEFAULT_BODIES = 1000;
+const size_t DEFAULT_TICKS = 1000;
+const double DT = 1e-3;
+const Vector DIMENSIONS = {1000, 1000};
+const double BODY_SIZE = 2;
+const double G = 10;
+const double THETA = 0.5;           // Barnes-Hut opening angle
+const double DRAG = 0.01;
+const double REPULSION = 100;       // spring constant between touching bodies
+const double SKIN = 1;              // neighbor list slack
+
+/* Scatters bodies over the scene, pulling on and pushing off each other */
+Scene *make_scene(size_t bodies) {
+    Scene *scene = scene_init();
+    srand(1);
+    for (size_t i = 0; i < bodies; i++) {
+        Body *body = body_init(get_rectangle(VEC_ZERO, BODY_SIZE, BODY_SIZE),
+            1, (RGBColor) {0, 0, 0});
+        body_set_centroid(body, rand_center(DIMENSIONS));
+        scene_add_body(scene, body);
+        create_drag(scene, DRAG, body);
+    }
+    create_barnes_hut_gravity(scene, G, THETA);
+    create_neighbor_repulsion(scene, REPULSION, BODY_SIZE, SKIN);
+    return scene;
+}
+
+int main(int argc, char *argv[]) {
+    size_t bodies = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_BODIES;
+    size_t ticks = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_TICKS;
+    size_t threads = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+
+    Scene *scene = make_scene(bodies);
+    JobSystem *jobs = threads > 0 ? job_system_init(threads) : NULL;
+    scene_set_jobs(scene, jobs);
+
+    double start = timing_now();
+    for (size_t i = 0; i < ticks; i++) {
+        scene_tick(scene, DT);
+    }
+    double elapsed = timing_now() - start;
+    printf("%zu bodies, %zu ticks in %.3f s (%.1f ticks/s)\n",
+        scene_bodies(scene), ticks, elapsed, ticks / elapsed);
+
+    scene_free(scene);
+    if (jobs) {
+        job_system_free(jobs);
+    }
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "polygon.h"
 #include "scene.h"
 #include "sdl_wrapper.h"
+#include "timing.h"
 #include <assert.h>
 #define CIRCLE_POINTS 40
 
@@ -28,20 +29,20 @@
 
 #define BALL_MASS 2.0
 
+#define PHYSICS_DT (1.0 / 120) // s
+#define MAX_STEPS_PER_FRAME 8
+#define TARGET_FPS 60
+
 #define BALL_COLOR ((RGBColor) {1, 0, 0})
 #define PEG_COLOR ((RGBColor) {0, 1, 0})
 #define WALL_COLOR ((RGBColor) {0, 0, 1})
 
-#define G 6.67E-11 // N m^2 / kg^2
-#define M 6E24 // kg
 #define g 9.8 // m / s^2
-#define R (sqrt(G * M / g)) // m
 
 typedef enum {
     BALL,
     FROZEN,
-    WALL, // or peg
-    GRAVITY
+    WALL // or peg
 } BodyType;
 
 BodyType get_type(Body *body) {
@@ -96,27 +97,12 @@ Vector get_peg_center(int row, int col) {
     return center;
 }
 
-/** Creates an Earth-like mass to accelerate the balls */
-Body *get_gravity_body() {
-    // Will be offscreen, so shape is irrelevant
-    List *gravity_ball = rect_init(1, 1);
-    BodyType *type = malloc(sizeof(*type));
-    *type = GRAVITY;
-    Body *body = body_init_with_info(gravity_ball, M, WALL_COLOR, type, free);
-
-    // Move a distnace R below the scene
-    Vector gravity_center = {.x = MAX.x / 2, .y = -R};
-    body_set_centroid(body, gravity_center);
-
-    return body;
-}
-
 /** Creates a ball with the given starting position and velocity */
-Body *get_ball(Vector center, Vector velocity) {
+Body *get_ball(Vector center, Vector velocity, double mass) {
     List *shape = circle_init(BALL_RADIUS);
     BodyType *info = malloc(sizeof(*info));
     *info = BALL;
-    Body *ball = body_init_with_info(shape, BALL_MASS, BALL_COLOR, info, free);
+    Body *ball = body_init_with_info(shape, mass, BALL_COLOR, info, free);
 
     body_set_centroid(ball, center);
     body_set_velocity(ball, velocity);
@@ -129,9 +115,10 @@ void freeze(Body *ball, Body *target, Vector axis, void *aux) {
     // Skip body if it was already frozen
     if (body_is_removed(ball)) return;
     body_remove(ball);
-    // Replace the ball with a frozen version
+    // Replace the ball with a frozen version, which is immovable so it
+    // doesn't fall in the scene's gravity
     Scene *scene = (Scene *) aux;
-    Body *frozen = get_ball(body_get_centroid(ball), VEC_ZERO);
+    Body *frozen = get_ball(body_get_centroid(ball), VEC_ZERO, INFINITY);
     *((BodyType *) body_get_info(frozen)) = FROZEN;
     scene_add_body(scene, frozen);
     // Make other falling bodies freeze when they collide with this body
@@ -145,18 +132,15 @@ void freeze(Body *ball, Body *target, Vector axis, void *aux) {
 }
 
 /** Adds a ball to the scene */
-void add_ball(Scene *scene, Body *gravity_body, List *obstacles) {
+void add_ball(Scene *scene, List *obstacles) {
     // Add the ball to the scene.
     Vector ball_center = {
         .x = MAX.x / 2 + (rand_double() - 0.5) * DELTA_X,
         .y = DROP_Y
     };
-    Body *ball = get_ball(ball_center, START_VELOCITY);
+    Body *ball = get_ball(ball_center, START_VELOCITY, BALL_MASS);
     scene_add_body(scene, ball);
 
-    // Simulate earth's gravity acting on the ball.
-    create_newtonian_gravity(scene, G, gravity_body, ball);
-
     // Add collisions between all bodies
     size_t obstacle_count = list_size(obstacles);
     for (size_t i = 0; i < obstacle_count; i++) {
@@ -229,31 +213,33 @@ int main(int argc, char **argv){
     // Initialize scene
     sdl_init(VEC_ZERO, MAX);
     Scene *scene = scene_init();
+    // Simulate earth's gravity acting on the balls
+    scene_set_gravity(scene, (Vector) {.x = 0.0, .y = -g});
 
-    // Add the gravity body to the scene
-    Body *gravity_body = get_gravity_body();
     // Add pegs and walls
     List *obstacles = add_obstacles(scene);
-    //add_ball(scene, gravity_body, obstacles);
-    scene_add_body(scene, gravity_body);
 
     // Repeatedly render scene
     double time_since_drop = INFINITY;
+    FixedStep *stepper = fixed_step_init(scene, PHYSICS_DT, MAX_STEPS_PER_FRAME);
+    FrameTimer *timer = frame_timer_init(TARGET_FPS);
     while (!sdl_is_done()){
-        double dt = time_since_last_tick();
+        double dt = frame_timer_tick(timer);
 
         // Add a new ball every DROP_INTERVAL seconds
         time_since_drop += dt;
         if (time_since_drop > DROP_INTERVAL) {
-            add_ball(scene, gravity_body, obstacles);
+            add_ball(scene, obstacles);
             time_since_drop = 0.0;
         }
 
-        scene_tick(scene, dt);
-        sdl_render_scene(scene);
+        fixed_step_advance(stepper, dt);
+        sdl_render_scene_interpolated(scene, stepper);
     }
 
     // Clean up scene
+    frame_timer_free(timer);
+    fixed_step_free(stepper);
     scene_free(scene);
     // list_free(obstacles);
     return 0;
@@ -1,9 +1,11 @@
 #include "body.h"
 #include "sdl_wrapper.h"
+#include "timing.h"
 #include "vector.h"
 #include "utils.h"
 #include "scene.h"
 #include "forces.h"
+#include "spring_network.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,6 +18,9 @@ const double CIRCLE_RADIUS = 10.0;
 const RGBColor WHITE = (RGBColor) {1, 1, 1};
 const double SPRING_CONSTANT = 2;
 const double DRAG_COEFFICIENT = .3;
+const double PHYSICS_DT = 1.0 / 120;
+const size_t MAX_STEPS_PER_FRAME = 8;
+const double TARGET_FPS = 60;
 
 /**
  * Initializes the scene. Adds Pacman and a preset number of pellets.
@@ -47,21 +52,30 @@ int main(int argc, char* argv[]) {
     sdl_init(bottom_left, top_right);
     Scene* scene = initialize_scene_spring();
 
+    // All springs and drags are evaluated together as one force creator
+    SpringNetwork *network = spring_network_init(scene_bodies(scene) / 2);
     for (size_t i = 0; i < scene_bodies(scene); i += 2) {
-        Body *body1 = scene_get_body(scene, i);
-        Body *body2 = scene_get_body(scene, i+1);
-        create_spring(scene, SPRING_CONSTANT, body1, body2);
+        size_t body1 = spring_network_add_body(network, scene_get_body(scene, i));
+        size_t body2 = spring_network_add_body(network, scene_get_body(scene, i+1));
+        spring_network_add_spring(network, body1, body2, SPRING_CONSTANT, 0, 0);
 
         if (i < scene_bodies(scene) / 2) {
-            create_drag(scene, DRAG_COEFFICIENT, body2);
+            spring_network_set_drag(network, body2, DRAG_COEFFICIENT);
         }
     }
+    create_spring_network(scene, network);
+    // Backward Euler keeps the springs stable at whatever dt the frame takes
+    scene_set_implicit_springs(scene, true);
 
+    FixedStep *stepper = fixed_step_init(scene, PHYSICS_DT, MAX_STEPS_PER_FRAME);
+    FrameTimer *timer = frame_timer_init(TARGET_FPS);
     while (!sdl_is_done()) {
-        double dt = time_since_last_tick();
+        double dt = frame_timer_tick(timer);
 
-        scene_tick(scene, dt);
-        sdl_render_scene(scene);
+        fixed_step_advance(stepper, dt);
+        sdl_render_scene_interpolated(scene, stepper);
     }
+    frame_timer_free(timer);
+    fixed_step_free(stepper);
     scene_free(scene);
 }
@@ -0,0 +1,78 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**
+ * A bump allocator for data that all dies at the same time,
+ * e.g. every body, shape and force creator belonging to one level.
+ * Memory is handed out from large chunks; when a chunk fills up,
+ * another one is chained on. Nothing is freed individually:
+ * arena_reset() reclaims everything at once.
+ */
+typedef struct arena Arena;
+
+/**
+ * Allocates memory for a new, empty arena.
+ * Asserts that the required memory was allocated.
+ *
+ * @param chunk_size the number of bytes to reserve each time the arena grows;
+ *   allocations bigger than this get a chunk of their own
+ * @return a pointer to the newly allocated arena
+ */
+Arena *arena_init(size_t chunk_size);
+
+/**
+ * Releases the arena and every chunk it owns.
+ * All pointers returned by arena_alloc() become invalid.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ */
+void arena_free(Arena *arena);
+
+/**
+ * Allocates a block of memory from the arena.
+ * The block is suitably aligned for any type and lives until
+ * the next arena_reset() or arena_free().
+ * Asserts that the required memory was allocated.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @param size the number of bytes to allocate
+ * @return a pointer to the block
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Releases everything allocated from the arena in one step.
+ * The chunks are kept so the arena can be refilled without calling malloc().
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * Gets the number of bytes handed out since the last reset.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @return the number of bytes in use
+ */
+size_t arena_used(Arena *arena);
+
+/**
+ * Gets the scratch arena for temporaries that only live for one frame,
+ * such as the screen-space vertex arrays built while drawing.
+ * It is reset at the top of every frame by sdl_is_done(),
+ * so nothing allocated from it may be kept across frames.
+ * Only the thread running the frame loop may use it.
+ *
+ * @return the frame scratch arena
+ */
+Arena *frame_arena(void);
+
+/**
+ * Releases everything allocated from frame_arena() since the last reset.
+ * Called once at the top of each frame.
+ */
+void frame_arena_reset(void);
+
+#endif // #ifndef __ARENA_H__
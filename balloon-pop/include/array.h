@@ -0,0 +1,169 @@
+#ifndef __ARRAY_H__
+#define __ARRAY_H__
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/**
+ * Generates a growable array that stores elements of type T by value.
+ * Unlike List, there is no void* indirection and every accessor is inline,
+ * so reading an element in a loop costs no more than indexing a C array.
+ * T must be a single identifier, so pointer types need a typedef first
+ * (e.g. "typedef Body *BodyPtr; DEFINE_ARRAY(BodyPtr)").
+ *
+ * DEFINE_ARRAY(T) declares the struct type T##Array and these functions:
+ *   void   T_array_init(T##Array *array, size_t initial_size)
+ *   void   T_array_init_arena(T##Array *array, size_t initial_size, Arena *arena)
+ *   void   T_array_free(T##Array *array)
+ *   size_t T_array_size(const T##Array *array)
+ *   T      T_array_get(const T##Array *array, size_t index)
+ *   T     *T_array_at(T##Array *array, size_t index)
+ *   void   T_array_set(T##Array *array, size_t index, T value)
+ *   void   T_array_add(T##Array *array, T value)
+ *   void   T_array_add_all(T##Array *array, const T *values, size_t count)
+ *   void   T_array_reserve(T##Array *array, size_t capacity)
+ *   void   T_array_shrink(T##Array *array)
+ *   void   T_array_remove(T##Array *array, size_t index)
+ *   void   T_array_clear(T##Array *array)
+ *
+ * The struct itself is usually embedded in its owner rather than malloc'd;
+ * T_array_init() and T_array_free() only manage the element storage.
+ * Arrays made with T_array_init_arena() take their storage from the arena,
+ * so T_array_free() and T_array_shrink() leave it to arena_reset().
+ * The array never owns what its elements point to.
+ */
+#define DEFINE_ARRAY(T) \
+    typedef struct { \
+        T *data; \
+        size_t size; \
+        size_t capacity; \
+        Arena *arena; \
+    } T##Array; \
+    \
+    static inline void T##_array_init_arena( \
+        T##Array *array, size_t initial_size, Arena *arena \
+    ) { \
+        assert(array); \
+        array->data = NULL; \
+        if (initial_size > 0) { \
+            array->data = arena \
+                ? arena_alloc(arena, initial_size * sizeof(T)) \
+                : malloc(initial_size * sizeof(T)); \
+            assert(array->data); \
+        } \
+        array->size = 0; \
+        array->capacity = initial_size; \
+        array->arena = arena; \
+    } \
+    \
+    static inline void T##_array_init(T##Array *array, size_t initial_size) { \
+        T##_array_init_arena(array, initial_size, NULL); \
+    } \
+    \
+    static inline void T##_array_free(T##Array *array) { \
+        assert(array); \
+        if (!array->arena) { \
+            free(array->data); \
+        } \
+        array->data = NULL; \
+        array->size = 0; \
+        array->capacity = 0; \
+    } \
+    \
+    static inline size_t T##_array_size(const T##Array *array) { \
+        return array->size; \
+    } \
+    \
+    static inline T T##_array_get(const T##Array *array, size_t index) { \
+        assert(index < array->size); \
+        return array->data[index]; \
+    } \
+    \
+    static inline T *T##_array_at(T##Array *array, size_t index) { \
+        assert(index < array->size); \
+        return &array->data[index]; \
+    } \
+    \
+    static inline void T##_array_set(T##Array *array, size_t index, T value) { \
+        assert(index < array->size); \
+        array->data[index] = value; \
+    } \
+    \
+    static inline void T##_array_reserve(T##Array *array, size_t capacity) { \
+        assert(array); \
+        if (capacity <= array->capacity) { \
+            return; \
+        } \
+        T *data; \
+        /* Arena blocks can't be realloc'd, so copy into a bigger one */ \
+        if (array->arena) { \
+            data = arena_alloc(array->arena, capacity * sizeof(T)); \
+            if (array->size > 0) { \
+                memcpy(data, array->data, array->size * sizeof(T)); \
+            } \
+        } else { \
+            data = realloc(array->data, capacity * sizeof(T)); \
+            assert(data); \
+        } \
+        array->data = data; \
+        array->capacity = capacity; \
+    } \
+    \
+    static inline void T##_array_shrink(T##Array *array) { \
+        assert(array); \
+        if (array->arena || array->size == array->capacity) { \
+            return; \
+        } \
+        if (array->size == 0) { \
+            free(array->data); \
+            array->data = NULL; \
+        } else { \
+            T *data = realloc(array->data, array->size * sizeof(T)); \
+            assert(data); \
+            array->data = data; \
+        } \
+        array->capacity = array->size; \
+    } \
+    \
+    static inline void T##_array_add(T##Array *array, T value) { \
+        if (array->size == array->capacity) { \
+            /* Double capacity each time we need more space */ \
+            T##_array_reserve(array, array->capacity > 0 \
+                ? 2 * array->capacity : 1); \
+        } \
+        array->data[array->size++] = value; \
+    } \
+    \
+    static inline void T##_array_add_all( \
+        T##Array *array, const T *values, size_t count \
+    ) { \
+        if (count == 0) { \
+            return; \
+        } \
+        size_t needed = array->size + count; \
+        if (needed > array->capacity) { \
+            size_t capacity = array->capacity > 0 ? array->capacity : 1; \
+            while (capacity < needed) { \
+                capacity *= 2; \
+            } \
+            T##_array_reserve(array, capacity); \
+        } \
+        memcpy(array->data + array->size, values, count * sizeof(T)); \
+        array->size = needed; \
+    } \
+    \
+    static inline void T##_array_remove(T##Array *array, size_t index) { \
+        assert(index < array->size); \
+        /* Shift the tail down so the remaining elements keep their order */ \
+        memmove(array->data + index, array->data + index + 1, \
+            (array->size - index - 1) * sizeof(T)); \
+        array->size--; \
+    } \
+    \
+    static inline void T##_array_clear(T##Array *array) { \
+        array->size = 0; \
+    }
+
+#endif // #ifndef __ARRAY_H__
@@ -0,0 +1,45 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "job_system.h"
+#include "scene.h"
+
+/**
+ * Called once a scene in a batch has finished ticking, e.g. to record how
+ * it ended up. With a job system, callbacks for different scenes may run
+ * at the same time on different threads, in any order, so a callback
+ * should only write to results that belong to its own scene,
+ * e.g. results[index].
+ *
+ * @param scene the scene that finished
+ * @param index the scene's index in the array passed to batch_run()
+ * @param aux the auxiliary value passed to batch_run()
+ */
+typedef void (*BatchCallback)(Scene *scene, size_t index, void *aux);
+
+/**
+ * Ticks many independent scenes for the same number of ticks,
+ * spreading the scenes across a job system's threads,
+ * and reports on each one as soon as it finishes.
+ * The scenes must not share any bodies or force creator state,
+ * since they may be ticked at the same time on different threads.
+ * Each scene is ticked entirely on one thread (unless it has a job system
+ * of its own; see scene_set_jobs()), so it ends up in the same state
+ * as if it had been ticked on its own.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init(),
+ *   or NULL to tick the scenes one after another on the calling thread
+ * @param scenes the scenes to tick
+ * @param count the number of scenes
+ * @param ticks the number of times to tick each scene
+ * @param dt the length of each tick
+ * @param callback if non-NULL, a function to call on each scene
+ *   once it has been ticked
+ * @param aux an auxiliary value to pass to callback
+ */
+void batch_run(
+    JobSystem *jobs, Scene **scenes, size_t count, size_t ticks, double dt,
+    BatchCallback callback, void *aux
+);
+
+#endif // #ifndef __BATCH_H__
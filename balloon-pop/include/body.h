@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "color.h"
+#include "array.h"
 #include "list.h"
 #include "vector.h"
 
@@ -18,6 +19,7 @@ typedef enum {
     REMOVE_ON_COLLISION,
     TURN_WHITE_ON_COLLISION,
     NEVER_REMOVE_ON_COLLISION,
+    NUM_ROLES   // not a role; the number of roles above
 } Role;
 
 /**
@@ -36,6 +38,35 @@ enum {
  */
 typedef struct body Body;
 
+/**
+ * Everything about a body that changes as a scene runs, except the positions
+ * of its vertices; see body_save_state(). It holds no pointers the body owns,
+ * so it can be copied around with memcpy().
+ */
+typedef struct {
+    Vector velocity;
+    Vector acceleration;
+    Vector centroid;
+    Vector elasticity;
+    Vector forces;
+    Vector impulses;
+    RGBColor color;
+    double mass;
+    double angle;
+    double time_since_last_collision;
+    Body *colliding_body;
+    bool has_role;  // whether the info is known to be a Role
+    Role role;      // only meaningful if has_role
+    bool removed;
+} BodyState;
+
+/**
+ * A growable array of body pointers; see DEFINE_ARRAY in array.h.
+ * The array never owns the bodies it points to.
+ */
+typedef Body *BodyPtr;
+DEFINE_ARRAY(BodyPtr)
+
 /**
  * Contains additional information for a body. For space invader, we have
  * two ints, one to represent the role (enemy or player), and one to represent
@@ -73,8 +104,50 @@ Body *body_init_with_info(
     List *shape, double mass, RGBColor color, void *info, FreeFunc info_freer
 );
 
+/**
+ * Allocates a body like body_init_with_info(), with a newly allocated Role
+ * as its info. Unlike bodies given a Role through body_init_with_info(),
+ * these are known to have a role, so scene snapshots save it.
+ *
+ * @param shape a list of vectors describing the initial shape of the body
+ * @param mass the mass of the body (if INFINITY, prevents the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param role the body's role
+ * @return a pointer to the newly allocated body
+ */
+Body *body_init_with_role(List *shape, double mass, RGBColor color, Role role);
+
+/**
+ * Allocates a body like body_init_with_info(), but takes the body's own
+ * memory from an arena so it is reclaimed by arena_reset().
+ * The shape and info are typically arena-allocated as well,
+ * in which case info_freer should be NULL.
+ * If arena is NULL, this behaves exactly like body_init_with_info().
+ *
+ * @param shape a list of vectors describing the initial shape of the body
+ * @param mass the mass of the body (if INFINITY, prevents the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @param arena the arena to allocate from, or NULL to use the heap
+ * @return a pointer to the newly allocated body
+ */
+Body *body_init_arena(
+    List *shape, double mass, RGBColor color, void *info, FreeFunc info_freer,
+    Arena *arena
+);
+
+/**
+ * Gets the arena a body was allocated from.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the arena passed to body_init_arena(), or NULL for heap bodies
+ */
+Arena *body_get_arena(Body *body);
+
 /**
  * Releases the memory allocated for a body.
+ * For arena bodies, only the info freer runs; the rest is left to the arena.
  *
  * @param b a pointer to a body returned from body_init()
  */
@@ -242,7 +315,58 @@ void body_set_force(Body *body, Vector force);
 void body_set_impulse(Body *body, Vector impulse);
 
 /**
- * sets a body's role
+ * A force or impulse added to a body while the adding thread was recording
+ * (see body_record_into()).
+ */
+typedef struct {
+    Body *body;
+    Vector value;
+    bool impulse;   // whether value is an impulse rather than a force
+} Contribution;
+
+/**
+ * A growable array of contributions; see DEFINE_ARRAY in array.h.
+ */
+DEFINE_ARRAY(Contribution)
+
+/**
+ * Makes the forces and impulses the calling thread adds to bodies
+ * get appended to a log instead of added to the bodies themselves.
+ * This lets several threads work out forces on the same bodies at once,
+ * each into its own log, and the logs be replayed in a fixed order after,
+ * so the sums come out the same however the work was scheduled.
+ * Pass NULL to stop recording.
+ *
+ * @param log the array to append contributions to, or NULL
+ */
+void body_record_into(ContributionArray *log);
+
+/**
+ * Adds every contribution in a log to its body, in the order they were made.
+ *
+ * @param log an array filled in while recording with body_record_into()
+ */
+void body_replay(const ContributionArray *log);
+
+/**
+ * Gets the force accumulated on a body so far this tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the forces added since the last tick
+ */
+Vector body_get_force(Body *body);
+
+/**
+ * Gets the impulse accumulated on a body so far this tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the impulses added since the last tick
+ */
+Vector body_get_impulse(Body *body);
+
+/**
+ * sets a body's role. The body's info must be a Role, and from then on
+ * body_save_state() saves it.
  *
  * @param body 		the body to alter
  * @param role 	the role to change body's to
@@ -307,6 +431,54 @@ void body_add_impulse(Body *body, Vector impulse);
  */
 void body_tick(Body *body, double dt);
 
+/**
+ * Same as body_tick(), but the body also accelerates uniformly
+ * by the given field, as if a force of mass * field had been added.
+ * Bodies with infinite mass are still left in place.
+ *
+ * @param body the body to tick
+ * @param dt the number of seconds elapsed since the last tick
+ * @param field an acceleration applied on top of the accumulated forces,
+ *   e.g. gravity near the ground
+ */
+void body_tick_in_field(Body *body, double dt, Vector field);
+
+/**
+ * Same as body_tick_in_field(), but with semi-implicit (symplectic) Euler:
+ * the velocity is updated first and the body moves at the new velocity.
+ * Unlike the average-velocity update, this keeps the energy of orbits and
+ * oscillators bounded instead of letting it grow tick after tick.
+ *
+ * @param body the body to tick
+ * @param dt the number of seconds elapsed since the last tick
+ * @param field an acceleration applied on top of the accumulated forces
+ */
+void body_tick_semi_implicit(Body *body, double dt, Vector field);
+
+/**
+ * The first half of a velocity Verlet step: moves the body by
+ * v * dt + a * dt^2 / 2, using the acceleration from its last tick.
+ * Forces should then be added at the new position and the step finished
+ * with body_tick_verlet().
+ * Bodies with infinite mass are left in place.
+ *
+ * @param body the body to move
+ * @param dt the length of the step
+ */
+void body_drift(Body *body, double dt);
+
+/**
+ * The second half of a velocity Verlet step, after body_drift():
+ * updates the velocity by the average of the last tick's acceleration
+ * and the one from the forces added since the drift, then resets the forces
+ * and impulses like body_tick().
+ *
+ * @param body the body to tick
+ * @param dt the length of the step passed to body_drift()
+ * @param field an acceleration applied on top of the accumulated forces
+ */
+void body_tick_verlet(Body *body, double dt, Vector field);
+
 /**
  * Updates the body after a given time interval has elapsed
  * without forces. Just uses set acc/vels to update position
@@ -316,6 +488,31 @@ void body_tick(Body *body, double dt);
  */
 void body_tick_no_forces(Body *body, double dt);
 
+/**
+ * Copies a body's state and the positions of its vertices out,
+ * so that body_load_state() can put the body back exactly as it was.
+ * The info is left alone, except for the role of bodies known to have one:
+ * those made with body_init_with_role() or given one with body_set_role().
+ *
+ * @param body the body to save
+ * @param state where to write the body's state
+ * @param vertices where to write the vertices, which must have room
+ *   for list_size(body_get_shape(body)) of them
+ */
+void body_save_state(Body *body, BodyState *state, Vector *vertices);
+
+/**
+ * Restores the state and vertices saved by body_save_state().
+ * The body's shape must still have the same number of vertices.
+ *
+ * @param body the body to restore
+ * @param state the state written by body_save_state()
+ * @param vertices the vertices written by body_save_state()
+ */
+void body_load_state(
+    Body *body, const BodyState *state, const Vector *vertices
+);
+
 /**
  * Marks a body for removal--future calls to body_is_removed() will return true.
  * Does not free the body.
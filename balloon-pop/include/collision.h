@@ -20,8 +20,26 @@ typedef struct {
      * If collided is false, this value is undefined.
      */
     Vector axis;
+    /**
+     * If the shapes are colliding, how far they overlap along axis,
+     * i.e. how far apart they must be moved to stop colliding.
+     * If collided is false, this value is undefined.
+     */
+    double depth;
 } CollisionInfo;
 
+/**
+ * Determines whether two convex polygons intersect, and if so,
+ * the axis and depth of least penetration (separating axis theorem).
+ * Unlike find_collision(), every edge normal of both shapes is tested,
+ * and the axis is a unit normal pointing from shape1 towards shape2.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes collide, and along which axis and how deeply
+ */
+CollisionInfo find_collision_info(List *shape1, List *shape2);
+
 
 /**
  * Determines whether two convex polygons intersect.
@@ -0,0 +1,133 @@
+#ifndef __CONSTRAINTS_H__
+#define __CONSTRAINTS_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A set of position constraints solved with extended position-based
+ * dynamics (XPBD). After the bodies have been ticked, each constraint
+ * moves its bodies directly so the constraint holds again, and the
+ * velocities are corrected to match how far the bodies were moved.
+ * This is stable at any dt; more iterations give stiffer results.
+ *
+ * Compliance is the inverse of stiffness: 0 makes a constraint rigid,
+ * and larger values make it behave like a softer spring.
+ * Bodies with infinite mass are never moved by constraints.
+ *
+ * Scenes own one of these; see scene_add_distance_constraint() and friends.
+ */
+typedef struct constraints Constraints;
+
+/**
+ * Allocates memory for an empty constraint set.
+ * Asserts that the required memory was allocated.
+ *
+ * @return a pointer to the newly allocated set
+ */
+Constraints *constraints_init(void);
+
+/**
+ * Releases the memory allocated for a constraint set.
+ * Does not free the bodies it constrains.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ */
+void constraints_free(Constraints *constraints);
+
+/**
+ * Gets the number of constraints in the set.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @return the number of constraints
+ */
+size_t constraints_size(Constraints *constraints);
+
+/**
+ * Gets the number of bytes constraints_save() writes.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @return the size of the saved constraints
+ */
+size_t constraints_save_size(Constraints *constraints);
+
+/**
+ * Copies out every constraint in the set, so constraints_restore() can put
+ * them back, e.g. when a scene is restored from a snapshot.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param buf where to write constraints_save_size() bytes,
+ *   aligned like memory from malloc()
+ * @return the number of bytes written
+ */
+size_t constraints_save(Constraints *constraints, void *buf);
+
+/**
+ * Replaces the constraints in the set with ones saved by constraints_save().
+ * Their bodies must not have been freed since.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param buf the bytes written by constraints_save()
+ * @param size the number of bytes constraints_save() wrote
+ */
+void constraints_restore(Constraints *constraints, const void *buf, size_t size);
+
+/**
+ * Keeps the centroids of two bodies a fixed distance apart.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param distance the distance to keep between the centroids
+ * @param compliance 0 for a rigid rod, larger for a softer link
+ */
+void constraints_add_distance(
+    Constraints *constraints, Body *body1, Body *body2,
+    double distance, double compliance
+);
+
+/**
+ * Keeps the centroid of a body at a fixed point.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param body the body to pin
+ * @param point where to hold the body's centroid
+ * @param compliance 0 for a rigid pin, larger for a softer one
+ */
+void constraints_add_pin(
+    Constraints *constraints, Body *body, Vector point, double compliance
+);
+
+/**
+ * Keeps two bodies from overlapping. Whenever their shapes intersect,
+ * they are pushed apart along the axis of least penetration.
+ * Contacts only push, never pull, and they do not bounce.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void constraints_add_contact(Constraints *constraints, Body *body1, Body *body2);
+
+/**
+ * Removes every constraint acting on a body marked for removal.
+ * Should be called before such bodies are freed.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ */
+void constraints_prune(Constraints *constraints);
+
+/**
+ * Projects every constraint the given number of times, then corrects
+ * the velocities of the bodies that moved so they match the new positions.
+ *
+ * @param constraints a pointer to a set returned from constraints_init()
+ * @param bodies every body that may be constrained, e.g. the scene's bodies
+ * @param dt the length of the tick that just ran
+ * @param iterations how many times to project each constraint
+ */
+void constraints_solve(
+    Constraints *constraints, BodyPtrArray *bodies, double dt, size_t iterations
+);
+
+#endif // #ifndef __CONSTRAINTS_H__
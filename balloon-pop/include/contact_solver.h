@@ -0,0 +1,130 @@
+#ifndef __CONTACT_SOLVER_H__
+#define __CONTACT_SOLVER_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A sequential-impulse solver for contacts between pairs of bodies.
+ * Each tick it finds which registered pairs are touching, then repeatedly
+ * sweeps over all of them, nudging each contact's impulse so the bodies
+ * stop approaching. The total impulse per contact is clamped so contacts
+ * only ever push, and friction never exceeds friction * normal impulse.
+ * Every contact starts from the impulse it needed last tick (warm starting),
+ * so resting stacks converge in a couple of iterations.
+ *
+ * Scenes own one of these; see scene_add_impulse_contact().
+ */
+typedef struct contact_solver ContactSolver;
+
+/**
+ * Gives the uniform acceleration (e.g. gravity) a body falls in this tick.
+ * The solver adds it to the body's accumulated forces when predicting
+ * the velocity the body would end the tick with.
+ */
+typedef Vector (*FieldFunc)(Body *body, void *aux);
+
+/**
+ * Allocates memory for a solver with no contacts.
+ * Asserts that the required memory was allocated.
+ *
+ * @return a pointer to the newly allocated solver
+ */
+ContactSolver *contact_solver_init(void);
+
+/**
+ * Releases the memory allocated for a solver.
+ * Does not free the bodies it was given.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ */
+void contact_solver_free(ContactSolver *solver);
+
+/**
+ * Gets the number of body pairs the solver checks for contact.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @return the number of pairs added with contact_solver_add()
+ */
+size_t contact_solver_pairs(ContactSolver *solver);
+
+/**
+ * Gets the number of bytes contact_solver_save() writes.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @return the size of the saved pairs
+ */
+size_t contact_solver_save_size(ContactSolver *solver);
+
+/**
+ * Copies out every pair, with the impulses it ended last tick with, which
+ * warm start the next tick. Together with contact_solver_restore() this lets
+ * a scene be rewound and re-run with the same results.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param buf where to write contact_solver_save_size() bytes,
+ *   aligned like memory from malloc()
+ * @return the number of bytes written
+ */
+size_t contact_solver_save(ContactSolver *solver, void *buf);
+
+/**
+ * Replaces the solver's pairs with ones saved by contact_solver_save().
+ * Their bodies must not have been freed since.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param buf the bytes written by contact_solver_save()
+ * @param size the number of bytes contact_solver_save() wrote
+ */
+void contact_solver_restore(ContactSolver *solver, const void *buf, size_t size);
+
+/**
+ * Registers a pair of bodies that should not pass through each other.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution;
+ *   0 is perfectly inelastic and 1 is perfectly elastic
+ * @param friction the Coulomb friction coefficient (0 for frictionless)
+ */
+void contact_solver_add(
+    ContactSolver *solver, Body *body1, Body *body2,
+    double elasticity, double friction
+);
+
+/**
+ * Removes every pair with a body marked for removal.
+ * Should be called before such bodies are freed.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ */
+void contact_solver_prune(ContactSolver *solver);
+
+/**
+ * Gets how far the most deeply overlapping pair of touching bodies
+ * overlapped when contact_solver_solve() last ran, e.g. to tell when
+ * ticks are too long for the contacts to keep up.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @return the largest penetration depth, or 0 if nothing was touching
+ */
+double contact_solver_max_depth(ContactSolver *solver);
+
+/**
+ * Resolves this tick's contacts. Must run after the forces and impulses
+ * for the tick have been accumulated and before the bodies are ticked;
+ * the contact impulses are added to the bodies with body_add_impulse().
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param dt the length of the tick about to run
+ * @param iterations how many sweeps to make over the contacts
+ * @param field gives the acceleration field each body falls in, or NULL
+ * @param aux an auxiliary value to pass to field
+ */
+void contact_solver_solve(
+    ContactSolver *solver, double dt, size_t iterations,
+    FieldFunc field, void *aux
+);
+
+#endif // #ifndef __CONTACT_SOLVER_H__
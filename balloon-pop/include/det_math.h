@@ -0,0 +1,64 @@
+#ifndef __DET_MATH_H__
+#define __DET_MATH_H__
+
+#include <math.h>
+
+/**
+ * Versions of sin(), cos() and atan() that give the same bits on every
+ * compiler and processor, unlike the C library's, whose last bits vary
+ * between platforms. That is what lockstep networking needs: peers that
+ * only exchange inputs must compute identical states. They sum their
+ * series in fixed point, as 64-bit integers with 62 fractional bits, after
+ * reducing the angle with plain double arithmetic, so for angles up to
+ * about a million radians they are as accurate as the C library's.
+ * In particular, right angles still come out (almost) exact, which
+ * sensitive scenes such as resting stacks rely on.
+ * NaNs and infinities behave like the C library's too.
+ *
+ * @param x the angle in radians, or the tangent for det_atan()
+ * @return sin(x), cos(x) or atan(x)
+ */
+double det_sin(double x);
+double det_cos(double x);
+double det_atan(double x);
+
+/*
+ * The transcendental functions the physics engine uses for geometry.
+ * Building with DETERMINISTIC_MATH defined ("make DETERMINISTIC=1") uses the
+ * deterministic versions above; otherwise they are the C library's.
+ * The engine's other arithmetic stays in double: +, -, *, / and sqrt() are
+ * correctly rounded by IEEE 754, so they already agree everywhere as long as
+ * the compiler doesn't fuse multiplies and adds (which the Makefile turns off
+ * in deterministic builds).
+ */
+#ifdef DETERMINISTIC_MATH
+
+static inline double math_sin(double x) {
+    return det_sin(x);
+}
+
+static inline double math_cos(double x) {
+    return det_cos(x);
+}
+
+static inline double math_atan(double x) {
+    return det_atan(x);
+}
+
+#else
+
+static inline double math_sin(double x) {
+    return sin(x);
+}
+
+static inline double math_cos(double x) {
+    return cos(x);
+}
+
+static inline double math_atan(double x) {
+    return atan(x);
+}
+
+#endif
+
+#endif // #ifndef __DET_MATH_H__
@@ -0,0 +1,125 @@
+#ifndef __FIXED_STEP_H__
+#define __FIXED_STEP_H__
+
+#include "scene.h"
+#include "vector.h"
+
+/**
+ * Drives a scene at a fixed tick length, however long each frame takes.
+ * Every frame, the time that has passed is added to an accumulator,
+ * and the scene is ticked by the fixed dt until less than one tick is left.
+ * So physics behaves the same at any frame rate, and each tick costs
+ * the same. If frames get so slow that catching up would take more than
+ * a set number of ticks, the rest of the time is dropped, so a slow frame
+ * can't make the next one slower still.
+ *
+ * The scene is usually partway between two ticks when it is drawn, so the
+ * stepper remembers where each body was before the last tick and can give
+ * a pose in between, for smooth motion when frames and ticks don't line up.
+ */
+typedef struct fixed_step FixedStep;
+
+/**
+ * A function to run after each fixed tick, e.g. game logic that
+ * should run at the physics rate rather than once per frame.
+ *
+ * @param scene the scene that was just ticked
+ * @param dt the length of the tick: the fixed dt, or a multiple of it
+ *   if ticks were merged (see fixed_step_set_max_merge())
+ * @param aux the auxiliary value passed to fixed_step_on_tick()
+ */
+typedef void (*StepFunc)(Scene *scene, double dt, void *aux);
+
+/**
+ * Allocates memory for a stepper that drives a scene.
+ * Asserts that the required memory was allocated.
+ *
+ * @param scene the scene to tick; the stepper does not own it
+ * @param dt the length of each tick
+ * @param max_steps the most ticks to run in one call to fixed_step_advance()
+ * @return a pointer to the newly allocated stepper
+ */
+FixedStep *fixed_step_init(Scene *scene, double dt, size_t max_steps);
+
+/**
+ * Releases the memory allocated for a stepper. Does not free its scene.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ */
+void fixed_step_free(FixedStep *stepper);
+
+/**
+ * Sets a function to call after every tick. Replaces any earlier one.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @param func the function to call, or NULL for none
+ * @param aux an auxiliary value to pass to func
+ */
+void fixed_step_on_tick(FixedStep *stepper, StepFunc func, void *aux);
+
+/**
+ * Lets the stepper run several due ticks as one longer scene_tick()
+ * while the scene is calm, i.e. its last tick wasn't split into substeps.
+ * Use this with scene_set_adaptive_substeps(), which splits a merged tick
+ * back up if it turns out to be too long. Which ticks get merged depends
+ * on how many are due each frame, so merging makes the simulation depend
+ * on the frame rate. By default ticks are never merged.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @param max_merge the most ticks to run as one; 1 turns merging off
+ */
+void fixed_step_set_max_merge(FixedStep *stepper, size_t max_merge);
+
+/**
+ * Adds a frame's worth of time and ticks the scene as many times
+ * as the accumulated time allows, up to the stepper's max_steps.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @param elapsed the time since the last call, e.g. time_since_last_tick()
+ * @return the number of fixed ticks the scene advanced by,
+ *   counting a merged tick once for each tick it covers
+ */
+size_t fixed_step_advance(FixedStep *stepper, double elapsed);
+
+/**
+ * Gets the length of each tick.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @return the dt passed to fixed_step_init()
+ */
+double fixed_step_dt(FixedStep *stepper);
+
+/**
+ * Gets how far the scene's time is past its last tick,
+ * as a fraction of a tick.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @return a number in [0, 1)
+ */
+double fixed_step_alpha(FixedStep *stepper);
+
+/**
+ * Gets the total time fixed_step_advance() has dropped
+ * because it would have taken too many ticks to catch up.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @return the time dropped, in the same units as dt
+ */
+double fixed_step_dropped(FixedStep *stepper);
+
+/**
+ * Maps a point on one of the scene's bodies to where it was partway
+ * between the last two ticks, by fixed_step_alpha(). The body's centroid
+ * and angle are blended between their values before and after the tick.
+ * Bodies added since the last tick have no earlier pose, so their points
+ * are returned unchanged. Indices are as of the last fixed_step_advance();
+ * points on bodies whose index has changed since are also left unchanged.
+ *
+ * @param stepper a pointer to a stepper returned from fixed_step_init()
+ * @param index the body's index in the scene
+ * @param point a point on the body as it is now, e.g. a vertex of its shape
+ * @return where to draw the point
+ */
+Vector fixed_step_point(FixedStep *stepper, size_t index, Vector point);
+
+#endif // #ifndef __FIXED_STEP_H__
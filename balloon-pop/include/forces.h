@@ -14,15 +14,38 @@
 typedef void (*CollisionHandler)
     (Body *body1, Body *body2, Vector axis, void *aux);
 
+/**
+ * A short-range interaction between two bodies, called by a neighbor force
+ * (see create_neighbor_force()) for each pair closer than its cutoff.
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param distance the distance between the bodies' centroids
+ * @param aux the auxiliary value passed to create_neighbor_force()
+ */
+typedef void (*NeighborHandler)
+    (Body *body1, Body *body2, double distance, void *aux);
+
 /**
  * Contain auxiliary information required for forces.
  */
 typedef struct forceAux ForceAux;
 typedef struct elas Elas;
+/**
+ * Contains the scene and quadtree used by Barnes-Hut gravity.
+ */
+typedef struct barnesHutAux BarnesHutAux;
 /**
  * Contain auxiliary information required for collisions.
  */
 typedef struct collisionAux CollisionAux;
+/**
+ * Contains the neighbor list and handler used by neighbor forces.
+ */
+typedef struct neighborAux NeighborAux;
+/**
+ * Contains the scene and grid used by particle-mesh gravity.
+ */
+typedef struct particleMeshAux ParticleMeshAux;
 
 
 /**
@@ -31,6 +54,24 @@ typedef struct collisionAux CollisionAux;
  */
 void addGravityForce(void *aux);
 
+/**
+ * A ForceCreator function for Barnes-Hut gravity over a whole scene.
+ * @param aux auxiliary information including the scene, G and theta
+ */
+void addBarnesHutGravity(void *aux);
+
+/**
+ * A ForceCreator function for particle-mesh gravity over a whole scene.
+ * @param aux auxiliary information including the scene, G and the grid
+ */
+void addParticleMeshGravity(void *aux);
+
+/**
+ * A ForceCreator function for short-range forces between neighbors.
+ * @param aux auxiliary information including the scene and neighbor list
+ */
+void addNeighborForce(void *aux);
+
 /**
  * A ForceCreator function for springs.
  * @param aux auxiliary information including k, body1, body2
@@ -62,6 +103,105 @@ void addCollision(void *aux);
  */
 void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2);
 
+/**
+ * Adds Newtonian gravity between every pair of bodies in a scene
+ * using a single force creator instead of one per pair.
+ * Each tick it builds a Barnes-Hut quadtree over the scene's bodies
+ * (see quadtree.h), which brings the cost from O(N^2) down to O(N log N).
+ * Bodies with infinite mass, such as walls, neither pull nor are pulled.
+ * Bodies added to the scene later are picked up automatically.
+ * Like create_newtonian_gravity(), pairs closer than CLOSENESS are skipped.
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param theta the opening angle; 0 is exact, larger is faster but coarser
+ *   (0.5 is a common choice)
+ */
+void create_barnes_hut_gravity(Scene *scene, double G, double theta);
+
+/**
+ * Adds Newtonian gravity between every pair of bodies in a scene
+ * using a particle-mesh solver (see particle_mesh.h) as a single
+ * force creator. Each tick the bodies' masses are spread onto a grid
+ * fitted around them and the field is found with FFTs, so the cost grows
+ * linearly with the number of bodies; this suits dense scenes of
+ * tens of thousands of bodies or more, where even create_barnes_hut_gravity()
+ * is too slow. Forces between bodies within a cell or two of each other
+ * are smoothed out.
+ * Bodies with infinite mass, such as walls, neither pull nor are pulled.
+ * Bodies added to the scene later are picked up automatically.
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param resolution the number of grid points along each side of the grid;
+ *   must be a power of 2
+ */
+void create_particle_mesh_gravity(Scene *scene, double G, size_t resolution);
+
+/**
+ * Adds a short-range interaction between every pair of bodies in a scene
+ * whose centroids are closer than cutoff, using a single force creator.
+ * Rather than registering every pair up front, it keeps a neighbor list
+ * (see neighbor_list.h) that is only rebuilt once some body has moved
+ * more than half the skin, so a tick costs time linear in the bodies
+ * and their neighbors. Bodies added to the scene later are picked up
+ * automatically, and removed bodies are dropped.
+ *
+ * @param scene the scene containing the bodies
+ * @param cutoff the distance beyond which bodies don't interact
+ * @param skin the extra distance the neighbor list covers
+ *   (a fraction of cutoff is a good start)
+ * @param handler a function to call for each pair closer than cutoff
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void create_neighbor_force(
+    Scene *scene,
+    double cutoff,
+    double skin,
+    NeighborHandler handler,
+    void *aux,
+    FreeFunc freer
+);
+
+/**
+ * Pushes apart every pair of bodies in a scene closer than cutoff,
+ * with a force of k * (cutoff - distance), like a compressed spring.
+ * See create_neighbor_force().
+ *
+ * @param scene the scene containing the bodies
+ * @param k the stiffness of the repulsion
+ * @param cutoff the distance at which the repulsion starts
+ * @param skin the extra distance the neighbor list covers
+ */
+void create_neighbor_repulsion(
+    Scene *scene, double k, double cutoff, double skin
+);
+
+/**
+ * Calls a CollisionHandler each tick any two bodies in a scene collide,
+ * like create_collision() for every pair at once.
+ * Only pairs whose centroids are closer than cutoff are tested,
+ * so cutoff must be at least the largest distance between the centroids
+ * of two touching bodies (e.g. the sum of the two largest radii).
+ * See create_neighbor_force().
+ *
+ * @param scene the scene containing the bodies
+ * @param cutoff the largest centroid distance at which bodies can touch
+ * @param skin the extra distance the neighbor list covers
+ * @param handler a function to call whenever two bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void create_neighbor_collisions(
+    Scene *scene,
+    double cutoff,
+    double skin,
+    CollisionHandler handler,
+    void *aux,
+    FreeFunc freer
+);
+
 /**
  * Adds a Hooke's-Law spring force between two bodies in a scene.
  * See https://en.wikipedia.org/wiki/Hooke%27s_law.
@@ -0,0 +1,107 @@
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A pool of worker threads that run small jobs in parallel.
+ * Every thread has its own deque of jobs: it pushes and pops jobs at one end,
+ * and when it runs out, it steals the oldest job from another thread's deque.
+ * The thread that created the system takes part as well, running jobs
+ * while it waits for them to finish.
+ *
+ * Jobs may be submitted by the thread that created the system
+ * or by running jobs, but not by unrelated threads.
+ */
+typedef struct job_system JobSystem;
+
+/**
+ * A job to run on some thread.
+ *
+ * @param aux the auxiliary value passed to job_system_submit()
+ */
+typedef void (*JobFunc)(void *aux);
+
+/**
+ * The body of a parallel loop, run over one chunk of the iterations.
+ *
+ * @param start the first iteration of the chunk
+ * @param end one past the last iteration of the chunk
+ * @param thread which thread is running the chunk, less than
+ *   job_system_threads(); useful for indexing per-thread scratch space
+ * @param aux the auxiliary value passed to parallel_for()
+ */
+typedef void (*RangeFunc)(size_t start, size_t end, size_t thread, void *aux);
+
+/**
+ * Starts a pool of worker threads.
+ * Asserts that the threads could be started.
+ *
+ * @param workers the number of threads to start besides the calling thread;
+ *   0 uses one fewer than the number of online processors
+ * @return a pointer to the newly allocated job system
+ */
+JobSystem *job_system_init(size_t workers);
+
+/**
+ * Waits for every submitted job to finish, then stops the worker threads
+ * and releases the memory allocated for the job system.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init()
+ */
+void job_system_free(JobSystem *jobs);
+
+/**
+ * Gets the number of threads that run jobs, including the calling thread.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init()
+ * @return one more than the number of worker threads
+ */
+size_t job_system_threads(JobSystem *jobs);
+
+/**
+ * Gets which thread of the job system is calling.
+ * The thread that created the system is thread 0.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init()
+ * @return an index less than job_system_threads()
+ */
+size_t job_system_thread(JobSystem *jobs);
+
+/**
+ * Queues a job on the calling thread's deque.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init()
+ * @param func the job to run
+ * @param aux an auxiliary value to pass to func
+ */
+void job_system_submit(JobSystem *jobs, JobFunc func, void *aux);
+
+/**
+ * Runs jobs until every submitted job has finished,
+ * including any the jobs themselves submitted.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init()
+ */
+void job_system_wait(JobSystem *jobs);
+
+/**
+ * Runs func over the iterations [0, count) in chunks of about grain
+ * iterations, spread over the job system's threads, and waits for them all.
+ * With a NULL job system, runs the whole range on the calling thread.
+ * Chunks run in no particular order, so func must not depend on one.
+ *
+ * @param jobs a pointer to a job system returned from job_system_init(),
+ *   or NULL
+ * @param count the number of iterations
+ * @param grain the number of iterations per chunk; 0 picks one so that
+ *   every thread gets a few chunks
+ * @param func the loop body
+ * @param aux an auxiliary value to pass to func
+ */
+void parallel_for(
+    JobSystem *jobs, size_t count, size_t grain, RangeFunc func, void *aux
+);
+
+#endif // #ifndef __JOB_SYSTEM_H__
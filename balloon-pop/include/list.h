@@ -2,6 +2,7 @@
 #define __LIST_H__
 
 #include <stddef.h>
+#include "arena.h"
 
 /**
  * A growable array of pointers.
@@ -28,6 +29,29 @@ typedef void (*FreeFunc)(void *data);
  */
 List *list_init(size_t initial_size, FreeFunc freer);
 
+/**
+ * Allocates a new list whose storage comes from an arena.
+ * The list, its internal array and any growth of that array are
+ * released by arena_reset(), so the list and its elements are never
+ * freed individually; list_free(), list_remove() and list_set()
+ * do not call a freer on its elements.
+ * If arena is NULL, this behaves exactly like list_init().
+ *
+ * @param initial_size the number of elements to allocate space for
+ * @param freer the freer to use if arena is NULL
+ * @param arena the arena to allocate from, or NULL to use the heap
+ * @return a pointer to the newly allocated list
+ */
+List *list_init_arena(size_t initial_size, FreeFunc freer, Arena *arena);
+
+/**
+ * Gets the arena a list was allocated from.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @return the arena passed to list_init_arena(), or NULL for heap lists
+ */
+Arena *list_get_arena(List *list);
+
 /**
  * Releases the memory allocated for a list.
  *
@@ -0,0 +1,88 @@
+#ifndef __NEIGHBOR_LIST_H__
+#define __NEIGHBOR_LIST_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A Verlet neighbor list: every pair of bodies whose centroids are
+ * within cutoff + skin of each other.
+ * Building the list bins the bodies into a grid of cells, which takes
+ * linear time, and the list is then reused for as many ticks as it stays
+ * valid. It goes stale once some body has moved more than half the skin
+ * since the last build, since two such bodies could have closed the gap,
+ * or when the set of bodies changes.
+ * Short-range forces only need to look at the pairs in the list,
+ * instead of every pair of bodies.
+ */
+typedef struct neighbor_list NeighborList;
+
+/**
+ * Allocates memory for an empty neighbor list.
+ * Asserts that the required memory was allocated.
+ *
+ * @param cutoff the distance beyond which pairs don't interact
+ * @param skin the extra distance to include, so the list lasts longer;
+ *   larger skins mean fewer rebuilds but more pairs to check
+ * @return a pointer to the newly allocated list
+ */
+NeighborList *neighbor_list_init(double cutoff, double skin);
+
+/**
+ * Releases the memory allocated for a neighbor list.
+ * Does not free the bodies it was built over.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ */
+void neighbor_list_free(NeighborList *list);
+
+/**
+ * Rebuilds the list if it is stale for the given bodies.
+ * The bodies must be given in the same order every time;
+ * any change to the array counts as a change to the set of bodies.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ * @param bodies the bodies to find neighbors among
+ * @return whether the list was rebuilt
+ */
+bool neighbor_list_update(NeighborList *list, const BodyPtrArray *bodies);
+
+/**
+ * Gets the number of pairs in the list.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ * @return the number of pairs found by the last rebuild
+ */
+size_t neighbor_list_pairs(NeighborList *list);
+
+/**
+ * Gets a pair of neighboring bodies.
+ * They may have drifted apart since the list was built,
+ * so callers should still check the distance against the cutoff.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ * @param index the index of the pair
+ * @param body1 set to the first body of the pair
+ * @param body2 set to the second body of the pair
+ */
+void neighbor_list_get(
+    NeighborList *list, size_t index, Body **body1, Body **body2
+);
+
+/**
+ * Gets the number of times the list has been rebuilt.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ * @return the number of times neighbor_list_update() returned true
+ */
+size_t neighbor_list_rebuilds(NeighborList *list);
+
+/**
+ * Gets the distance beyond which pairs don't interact.
+ *
+ * @param list a pointer to a list returned from neighbor_list_init()
+ * @return the cutoff passed to neighbor_list_init()
+ */
+double neighbor_list_cutoff(NeighborList *list);
+
+#endif // #ifndef __NEIGHBOR_LIST_H__
@@ -0,0 +1,63 @@
+#ifndef __PARTICLE_MESH_H__
+#define __PARTICLE_MESH_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A particle-mesh gravity solver for scenes with very many bodies.
+ * Each tick the bodies' masses are spread onto a square grid covering them
+ * (cloud-in-cell: each body is shared between the four nearest grid points),
+ * the grid is convolved with the gravitational potential of a point mass
+ * using fast Fourier transforms, and the resulting field is interpolated
+ * back to the bodies the same way. The cost is O(N + R^2 log R) for N bodies
+ * on an R by R grid, however densely the bodies are packed.
+ *
+ * The grid is zero-padded to twice its size, so distant bodies don't wrap
+ * around and pull from the opposite side. Forces between bodies in the same
+ * or neighboring cells are smoothed out, so the grid should be fine enough
+ * that most pairs are several cells apart.
+ */
+typedef struct particle_mesh ParticleMesh;
+
+/**
+ * Allocates memory for a particle-mesh solver.
+ * Asserts that the required memory was allocated.
+ *
+ * @param resolution the number of grid points along each side;
+ *   must be a power of 2, at least 4
+ * @return a pointer to the newly allocated solver
+ */
+ParticleMesh *particle_mesh_init(size_t resolution);
+
+/**
+ * Releases the memory allocated for a particle-mesh solver.
+ * Does not free the bodies it was applied to.
+ *
+ * @param mesh a pointer to a solver returned from particle_mesh_init()
+ */
+void particle_mesh_free(ParticleMesh *mesh);
+
+/**
+ * Gets the number of grid points along each side of the grid.
+ *
+ * @param mesh a pointer to a solver returned from particle_mesh_init()
+ * @return the resolution passed to particle_mesh_init()
+ */
+size_t particle_mesh_resolution(ParticleMesh *mesh);
+
+/**
+ * Adds the Newtonian gravitational force that the bodies exert on each other
+ * to every body, as computed on the grid.
+ * The grid is fitted to the bodies' centroids each time.
+ * Every body must have a finite mass.
+ *
+ * @param mesh a pointer to a solver returned from particle_mesh_init()
+ * @param bodies the bodies to compute gravity between
+ * @param G the gravitational proportionality constant
+ */
+void particle_mesh_apply(
+    ParticleMesh *mesh, const BodyPtrArray *bodies, double G
+);
+
+#endif // #ifndef __PARTICLE_MESH_H__
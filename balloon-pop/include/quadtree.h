@@ -0,0 +1,67 @@
+#ifndef __QUADTREE_H__
+#define __QUADTREE_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A Barnes-Hut quadtree over the centroids of a set of bodies.
+ * Each node stores the total mass and center of mass of the bodies below it,
+ * so a far-away cluster can stand in for all of its bodies at once.
+ * The tree is meant to be rebuilt every tick; its node storage is kept
+ * between builds so rebuilding does not allocate once it has warmed up.
+ */
+typedef struct quadtree QuadTree;
+
+/**
+ * Allocates memory for an empty quadtree.
+ * Asserts that the required memory was allocated.
+ *
+ * @return a pointer to the newly allocated quadtree
+ */
+QuadTree *quadtree_init(void);
+
+/**
+ * Releases the memory allocated for a quadtree.
+ * Does not free the bodies it was built over.
+ *
+ * @param tree a pointer to a quadtree returned from quadtree_init()
+ */
+void quadtree_free(QuadTree *tree);
+
+/**
+ * Rebuilds the tree over the given bodies, discarding the previous contents.
+ * Bodies are placed by their centroids and weighted by their masses,
+ * so every body must have a finite mass.
+ *
+ * @param tree a pointer to a quadtree returned from quadtree_init()
+ * @param bodies the bodies to insert
+ */
+void quadtree_build(QuadTree *tree, const BodyPtrArray *bodies);
+
+/**
+ * Gets the number of nodes in the tree, including internal nodes.
+ *
+ * @param tree a pointer to a quadtree returned from quadtree_init()
+ * @return the node count after the last quadtree_build()
+ */
+size_t quadtree_nodes(QuadTree *tree);
+
+/**
+ * Computes the approximate Newtonian gravitational force that
+ * the bodies in the tree exert on a body.
+ * A node of width s whose center of mass is a distance d away
+ * is treated as a single point mass if s / d < theta;
+ * otherwise its children are visited. theta = 0 gives the exact pairwise sum.
+ * As in is_too_close(), point masses closer than CLOSENESS are ignored,
+ * which also keeps the body from attracting itself.
+ *
+ * @param tree a pointer to a quadtree built with quadtree_build()
+ * @param body the body to compute the force on
+ * @param G the gravitational proportionality constant
+ * @param theta the opening angle
+ * @return the total force on body
+ */
+Vector quadtree_force(QuadTree *tree, Body *body, double G, double theta);
+
+#endif // #ifndef __QUADTREE_H__
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "body.h"
 #include "list.h"
+#include "job_system.h"
 
 /**
  * Enum to specify which wall of the scene a body may hit
@@ -60,6 +61,229 @@ Scene *scene_init(void);
  */
 void scene_free(Scene *scene);
 
+/**
+ * Gets the arena that holds level-lifetime data for this scene.
+ * Bodies, shapes and force creators allocated from it are torn down
+ * together by scene_reset_arena() instead of being freed one by one.
+ * The arena is created the first time this is called.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's arena
+ */
+Arena *scene_get_arena(Scene *scene);
+
+/**
+ * Removes every body allocated from the scene's arena,
+ * along with every force creator that acts on one of them,
+ * then resets the arena so its memory can be reused.
+ * Bodies and force creators on the heap are left untouched.
+ * Snapshots taken before this can't be restored afterwards if they have
+ * any of the arena's bodies or force creators.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ */
+void scene_reset_arena(Scene *scene);
+
+/**
+ * Sets a uniform acceleration field, such as gravity near the ground,
+ * that every body with finite mass falls in during scene_tick().
+ * This is much cheaper than pulling each body towards a huge offscreen mass,
+ * since it needs no force creators or distance computations.
+ * The field starts out as VEC_ZERO.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param gravity the acceleration to apply, e.g. (0, -9.8)
+ */
+void scene_set_gravity(Scene *scene, Vector gravity);
+
+/**
+ * Gets the scene's uniform acceleration field.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the field set by scene_set_gravity()
+ */
+Vector scene_get_gravity(Scene *scene);
+
+/**
+ * Overrides the scene's field for bodies with the given role,
+ * e.g. to make darts fall while balloons float.
+ * Only bodies whose info is a Role are affected; see body_get_role().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param role the role to override the field for
+ * @param gravity the acceleration to apply to bodies with that role
+ */
+void scene_set_role_gravity(Scene *scene, Role role, Vector gravity);
+
+/**
+ * Gets the length of the tick scene_tick() is running,
+ * for force creators that need the step size (e.g. implicit integrators).
+ * Between ticks, this is the length of the last tick.
+ * If the tick is split into substeps, this is the length of a substep.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the dt passed to the current or last scene_tick(), or 0 if none
+ */
+double scene_get_dt(Scene *scene);
+
+/**
+ * Chooses how spring networks in the scene are integrated; see
+ * spring_network.h. Explicit integration (the default) is cheapest per tick
+ * but stiff springs need tiny ticks to stay stable. Implicit integration
+ * (backward Euler) solves a linear system every tick, but stays stable
+ * for any stiffness at the frame rate's dt.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param implicit whether to integrate spring networks implicitly
+ */
+void scene_set_implicit_springs(Scene *scene, bool implicit);
+
+/**
+ * Gets whether spring networks in the scene are integrated implicitly.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the value set by scene_set_implicit_springs(), false by default
+ */
+bool scene_get_implicit_springs(Scene *scene);
+
+/**
+ * How scene_tick() moves bodies by the forces on them; see
+ * scene_set_integrator().
+ */
+typedef enum {
+    // Moves at the average of the old and new velocities (see body_tick())
+    INTEGRATOR_AVERAGE_VELOCITY,
+    // Updates velocity, then moves at it (see body_tick_semi_implicit())
+    INTEGRATOR_SEMI_IMPLICIT_EULER,
+    // Moves, then updates velocity by the forces at the new position
+    // (see body_drift() and body_tick_verlet())
+    INTEGRATOR_VELOCITY_VERLET,
+    // Classic 4th-order Runge-Kutta, running the force creators 4 times
+    INTEGRATOR_RK4
+} Integrator;
+
+/**
+ * Chooses how the scene's bodies are integrated. The average-velocity
+ * update (the default) lets the energy of orbits and springs grow over time.
+ * Semi-implicit Euler and velocity Verlet are symplectic, so energy stays
+ * bounded and larger ticks remain stable; both run the force creators once
+ * per tick. Verlet is second-order accurate, but its forces are added after
+ * the bodies move, and velocity-dependent forces such as drag see the
+ * velocity from before the move. It also needs each body's acceleration
+ * from the tick before, so the first tick after bodies are added runs the
+ * force creators an extra time, keeping only their forces.
+ * RK4 is the most accurate per tick and is meant as a reference to compare
+ * against. It runs the force creators 3 more times per tick at trial
+ * positions, keeping only their forces, so force creators with side effects
+ * (e.g. collisions that remove bodies) shouldn't be used with it.
+ * Impulses and the contact solver only act once per tick either way.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param integrator the integrator to use
+ */
+void scene_set_integrator(Scene *scene, Integrator integrator);
+
+/**
+ * Gets how the scene's bodies are integrated.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the value set by scene_set_integrator(),
+ *   INTEGRATOR_AVERAGE_VELOCITY by default
+ */
+Integrator scene_get_integrator(Scene *scene);
+
+/**
+ * Keeps the centroids of two bodies in the scene a fixed distance apart,
+ * e.g. links in a chain. See constraints.h for how constraints are solved.
+ * The constraint is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param distance the distance to keep between the centroids
+ * @param compliance 0 for a rigid rod, larger for a softer link
+ */
+void scene_add_distance_constraint(
+    Scene *scene, Body *body1, Body *body2, double distance, double compliance
+);
+
+/**
+ * Keeps the centroid of a body in the scene at a fixed point.
+ * The constraint is removed when the body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body the body to pin
+ * @param point where to hold the body's centroid
+ * @param compliance 0 for a rigid pin, larger for a softer one
+ */
+void scene_add_pin_constraint(
+    Scene *scene, Body *body, Vector point, double compliance
+);
+
+/**
+ * Keeps two bodies in the scene from overlapping, e.g. so stacked
+ * or resting bodies stay put without jittering.
+ * The constraint is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void scene_add_contact_constraint(Scene *scene, Body *body1, Body *body2);
+
+/**
+ * Gets the number of constraints in a given scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of constraints that have not been removed
+ */
+size_t scene_constraints_count(Scene *scene);
+
+/**
+ * Sets how many times per tick scene_tick() projects each constraint.
+ * More iterations make constraints stiffer and stacks steadier,
+ * at a proportional cost. The default is 4.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of solver iterations per tick
+ */
+void scene_set_constraint_iterations(Scene *scene, size_t iterations);
+
+/**
+ * Makes two bodies in the scene bounce off each other with a
+ * sequential-impulse contact solver (see contact_solver.h).
+ * Unlike create_physics_collision(), all of the scene's contacts are
+ * solved together and reuse last tick's impulses, so resting contacts
+ * and stacks stay still instead of jittering.
+ * The contact is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution
+ * @param friction the Coulomb friction coefficient (0 for frictionless)
+ */
+void scene_add_impulse_contact(
+    Scene *scene, Body *body1, Body *body2, double elasticity, double friction
+);
+
+/**
+ * Gets the number of impulse contacts in a given scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of contacts that have not been removed
+ */
+size_t scene_impulse_contacts(Scene *scene);
+
+/**
+ * Sets how many sweeps per tick the contact solver makes.
+ * Thanks to warm starting, a few are usually enough. The default is 4.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of solver iterations per tick
+ */
+void scene_set_contact_iterations(Scene *scene, size_t iterations);
+
 /**
  * Gets the number of bodies in a given scene.
  *
@@ -98,6 +322,8 @@ void scene_add_body(Scene *scene, Body *body);
  * @deprecated Use body_remove() instead
  *
  * Removes and frees the body at a given index from a scene.
+ * If a snapshot was taken since the body was added, it is kept instead,
+ * until scene_restore() brings it back or scene_release_removed() frees it.
  * Asserts that the index is valid.
  *
  * @param scene a pointer to a scene returned from scene_init()
@@ -142,6 +368,69 @@ void scene_add_bodies_force_creator(
     Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
 );
 
+/**
+ * Same as scene_add_bodies_force_creator(), but takes the bodies
+ * as a typed array. The scene keeps its own copy of the array,
+ * so the caller may free or reuse it afterwards.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the bodies affected by the force creator, or NULL if none.
+ *   The force creator will be removed if any of these bodies are removed.
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_body_array_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, const BodyPtrArray *bodies,
+    FreeFunc freer
+);
+
+/**
+ * Same as scene_add_body_array_force_creator(), for force creators that
+ * only read the bodies and add forces and impulses to them.
+ * When the scene has a job system (see scene_set_jobs()), such force creators
+ * run on several threads at once, so they must not change anything else
+ * (e.g. remove bodies or write to aux) and must not use the job system.
+ * They also run before the scene's other force creators, so they must not
+ * depend on what those do.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the bodies affected by the force creator, or NULL if none.
+ *   The force creator will be removed if any of these bodies are removed.
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_parallel_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, const BodyPtrArray *bodies,
+    FreeFunc freer
+);
+
+/**
+ * Makes scene_tick() spread its work over a job system's threads:
+ * parallel force creators run concurrently, bodies are integrated in chunks,
+ * and scene-wide forces such as create_barnes_hut_gravity() split their
+ * own loops. Contacts and constraints are still solved on one thread.
+ * Forces are still summed in the order the force creators were added,
+ * so a scene ticks to bit-identical states with or without a job system,
+ * however many threads it has.
+ * The scene does not take ownership of the job system,
+ * so one job system can be shared by many scenes.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param jobs a pointer to a job system returned from job_system_init(),
+ *   or NULL to tick on the calling thread only (the default)
+ */
+void scene_set_jobs(Scene *scene, JobSystem *jobs);
+
+/**
+ * Gets the job system a scene ticks on.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the job system passed to scene_set_jobs(), or NULL
+ */
+JobSystem *scene_get_jobs(Scene *scene);
+
 /**
  * Adds a circle to the scene at a random or given location
  * @param scene      		the scene
@@ -156,12 +445,56 @@ void scene_add_special_body( Scene* scene, RGBColor color, List *points,
     double mass, Vector start_vel, Vector start_acc, Vector elasticity
 );
 
+/**
+ * What the last scene_tick() did; see scene_get_tick_stats().
+ */
+typedef struct {
+    size_t substeps;        // how many steps the tick was split into
+    double max_motion;      // how far the fastest body would have moved
+                            // over the whole tick, in multiples of its size
+    double max_depth;       // the deepest overlap between impulse contacts
+                            // (see contact_solver_max_depth())
+} TickStats;
+
+/**
+ * Lets scene_tick() split a tick into several shorter substeps when one long
+ * step would be inaccurate: when some body would move more than max_motion
+ * times its size (sqrt of its area) in one substep, so it could pass through
+ * things, or when impulse contacts overlapped by more than max_depth last
+ * tick, which doubles the substeps until they don't. Calm ticks take a single
+ * step, so a scene can be ticked with whatever dt its calm parts need.
+ * By default ticks are never split.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param max_motion the most a body may move per substep, as a fraction
+ *   of its size, or 0 to ignore motion
+ * @param max_depth the deepest contacts may overlap before ticks are split
+ *   further, or 0 to ignore overlaps
+ * @param max_substeps the most substeps to split a tick into; 1 turns
+ *   splitting off
+ */
+void scene_set_adaptive_substeps(
+    Scene *scene, double max_motion, double max_depth, size_t max_substeps
+);
+
+/**
+ * Gets what the last scene_tick() did, e.g. how many substeps it took.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the stats of the last tick, or all zeros before the first tick
+ */
+TickStats scene_get_tick_stats(Scene *scene);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
  * and then ticking each body (see body_tick()).
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
+ * Impulse contacts are resolved just before the bodies are ticked.
+ * Finally, the scene's constraints are solved.
+ * With adaptive substeps (see scene_set_adaptive_substeps()), all of this
+ * may be repeated over several shorter steps that add up to dt.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
@@ -177,4 +510,65 @@ void scene_tick(Scene *scene, double dt);
  * @param dt the time elapsed since the last tick, in seconds
  */
 void scene_tick_no_forces(Scene *scene, double dt);
+
+/**
+ * Gets the size of the buffer scene_snapshot() needs for the scene as it is.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of bytes scene_snapshot() would write
+ */
+size_t scene_snapshot_size(Scene *scene);
+
+/**
+ * Saves the state of a scene into a flat buffer, which can be copied with
+ * memcpy() and later passed to scene_restore(), e.g. to roll back and re-run
+ * ticks when late network input arrives, or to rewind while debugging.
+ * The buffer holds every body's vertices, velocity, acceleration, color,
+ * role (if it has one; see body_save_state()) and removal mark, which
+ * bodies and force creators the scene has, and its impulse contacts and
+ * constraints.
+ * Bodies and force creators are recorded by address, so a snapshot can only
+ * be restored into the scene it came from, in the same process; it can't be
+ * written out and loaded elsewhere.
+ * From the first snapshot on, the scene keeps the bodies and force creators
+ * it removes instead of freeing them, so that scene_restore() can bring them
+ * back; see scene_release_removed().
+ * The aux values of force creators are not saved, so force creators that
+ * keep state of their own (e.g. whether two bodies were already touching)
+ * are not rolled back.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param buf where to save the scene, with room for scene_snapshot_size()
+ *   bytes and aligned like memory from malloc()
+ * @return the number of bytes written
+ */
+size_t scene_snapshot(Scene *scene, void *buf);
+
+/**
+ * Puts a scene back into the state saved by scene_snapshot().
+ * Bodies and force creators removed since the snapshot come back, and ones
+ * added since are removed and freed, as are their constraints and impulse
+ * contacts. Snapshots taken after this one can't be restored any more,
+ * but older ones still can.
+ * Asserts that the scene still has every body and force creator in the
+ * snapshot, which it won't if they were released by scene_release_removed()
+ * or scene_reset_arena() after the snapshot was taken.
+ *
+ * @param scene the scene passed to scene_snapshot()
+ * @param buf the buffer written by scene_snapshot(), or a copy of it
+ */
+void scene_restore(Scene *scene, const void *buf);
+
+/**
+ * Frees the bodies and force creators the scene removed before a snapshot
+ * was taken, which only older snapshots could bring back. Call this once
+ * those older snapshots are discarded, e.g. as a rollback window moves on,
+ * or the scene holds on to everything it ever removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param oldest the oldest snapshot that may still be restored,
+ *   or NULL to free everything removed so far
+ */
+void scene_release_removed(Scene *scene, const void *oldest);
+
 #endif // #ifndef __SCENE_H__
@@ -9,6 +9,7 @@
 #include "sprite.h"
 #include "text.h"
 #include "game_info.h"
+#include "fixed_step.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 
@@ -32,6 +33,14 @@ typedef enum {
 } KeyEventType;
 
 void sdl_render_game(GameInfo* game);
+/**
+ * Same as sdl_render_game(), but draws the scene's bodies interpolated
+ * like sdl_render_scene_interpolated().
+ *
+ * @param game the game to draw
+ * @param stepper the stepper that ticks the game's scene, or NULL
+ */
+void sdl_render_game_interpolated(GameInfo* game, FixedStep *stepper);
 SDL_Window* get_window(void);
 SDL_Renderer* get_renderer(void);
 /**
@@ -56,6 +65,13 @@ typedef void (*KeyHandler)(char key, KeyEventType type, double held_time, \
  */
 void sdl_init(Vector min, Vector max);
 
+/**
+ * Initializes the SDL window with the scene's origin at its center.
+ *
+ * @param dimensions the width and height of the scene
+ */
+void initialize_window(Vector dimensions);
+
 /**
  * Processes all SDL events and returns whether the window has been closed.
  * This function must be called in order to handle keypresses.
@@ -94,6 +110,17 @@ void sdl_show(void);
  */
 void sdl_render_scene(Scene *scene);
 
+/**
+ * Same as sdl_render_scene(), but draws each body where it was partway
+ * between the stepper's last two ticks (see fixed_step_point()),
+ * so motion looks smooth when the frame rate isn't the tick rate.
+ *
+ * @param scene the scene to draw
+ * @param stepper the stepper that ticks the scene, or NULL to draw the
+ *   bodies where they are
+ */
+void sdl_render_scene_interpolated(Scene *scene, FixedStep *stepper);
+
 /**
  * Registers a function to be called every time a key is pressed.
  * Overwrites any existing handler.
@@ -124,7 +151,8 @@ void sdl_on_key(KeyHandler handler, void* aux);
 
 /**
  * Gets the amount of time that has passed since the last time
- * this function was called, in seconds.
+ * this function was called, in seconds, by the wall clock (see timing_now()).
+ * To also hold the loop to a frame rate, use a FrameTimer instead.
  *
  * @return the number of seconds that have elapsed
  */
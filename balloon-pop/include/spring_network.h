@@ -0,0 +1,117 @@
+#ifndef __SPRING_NETWORK_H__
+#define __SPRING_NETWORK_H__
+
+#include "body.h"
+#include "scene.h"
+
+/**
+ * A batch of Hooke's-law springs between a fixed set of bodies,
+ * e.g. a rope, a cloth or a soft body.
+ * Springs are stored as parallel arrays (endpoints, stiffness,
+ * rest length, damping) and evaluated together in a single loop,
+ * instead of one force creator and function-pointer call per spring.
+ * Each body may also have its own drag, as in create_drag().
+ *
+ * If the network's scene has implicit springs turned on
+ * (see scene_set_implicit_springs()), the network takes a backward Euler
+ * step instead of adding forces: it solves for the velocity change
+ * its own forces cause at the end of the tick, using conjugate gradient
+ * on the spring Jacobian, and applies that as impulses.
+ * Forces from the rest of the scene are still integrated explicitly.
+ */
+typedef struct spring_network SpringNetwork;
+
+/**
+ * Allocates memory for an empty spring network.
+ * Asserts that the required memory was allocated.
+ *
+ * @param initial_springs the number of springs to reserve space for
+ * @return a pointer to the newly allocated network
+ */
+SpringNetwork *spring_network_init(size_t initial_springs);
+
+/**
+ * Releases the memory allocated for a spring network.
+ * Does not free the bodies it connects.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void spring_network_free(SpringNetwork *network);
+
+/**
+ * Adds a body to the network so springs can be attached to it.
+ * Each body should only be added once.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body the body to add
+ * @return the body's index in the network, for spring_network_add_spring()
+ */
+size_t spring_network_add_body(SpringNetwork *network, Body *body);
+
+/**
+ * Adds a damped spring between two bodies already in the network.
+ * The spring pulls with force k * (distance - rest_length)
+ * along the line between the centroids, plus damping times
+ * the rate at which that distance is changing.
+ * A rest length of 0 behaves like create_spring().
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body1 the index of the first body
+ * @param body2 the index of the second body
+ * @param k the Hooke's constant for the spring
+ * @param rest_length the distance at which the spring exerts no force
+ * @param damping the damping coefficient along the spring (0 for none)
+ * @return the spring's index in the network
+ */
+size_t spring_network_add_spring(
+    SpringNetwork *network, size_t body1, size_t body2,
+    double k, double rest_length, double damping
+);
+
+/**
+ * Sets the drag on one body of the network; see create_drag().
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body the index of the body
+ * @param gamma the proportionality constant between force and velocity
+ */
+void spring_network_set_drag(SpringNetwork *network, size_t body, double gamma);
+
+/**
+ * Gets the number of bodies in the network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @return the number of bodies added with spring_network_add_body()
+ */
+size_t spring_network_bodies(SpringNetwork *network);
+
+/**
+ * Gets the number of springs in the network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @return the number of springs added with spring_network_add_spring()
+ */
+size_t spring_network_springs(SpringNetwork *network);
+
+/**
+ * Adds every spring and drag force in the network to its bodies,
+ * or the equivalent implicit impulses if the scene asks for them.
+ * This is the network's ForceCreator; it is called by scene_tick()
+ * once the network has been added with create_spring_network().
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void spring_network_apply(void *network);
+
+/**
+ * Adds a spring network to a scene as a single force creator.
+ * The scene takes ownership of the network and frees it
+ * when the scene is freed or when any of the network's bodies is removed.
+ * All of the network's bodies must already be in it.
+ *
+ * @param scene the scene containing the bodies
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void create_spring_network(Scene *scene, SpringNetwork *network);
+
+#endif // #ifndef __SPRING_NETWORK_H__
@@ -15,6 +15,8 @@
  * Floating-point math is approximate, so isclose() is preferable to ==.
  * There are some exceptions: ints (<= 53 bits) and fractions whose denominators
  * are powers of 2 (e.g. 0.5 or 0.75) can be represented exactly as a double.
+ * In float builds (see Scalar in vector.h), this and the functions below
+ * also allow a relative error of 1e-4, as vectors are only rounded to floats.
  */
 bool isclose(double d1, double d2);
 
@@ -45,6 +47,19 @@ bool within(double epsilon, double d1, double d2);
  */
 bool vec_within(double epsilon, Vector v1, Vector v2);
 
+/**
+ * A tick short enough for tests that compare a simulation to its exact
+ * solution, and how many of them make a second. Float builds (see Scalar in
+ * vector.h) can't resolve moves that small, so they take bigger ticks.
+ */
+#ifdef SCALAR_FLOAT
+#define TEST_DT 1e-5
+#define TEST_STEPS 100000
+#else
+#define TEST_DT 1e-6
+#define TEST_STEPS 1000000
+#endif
+
 /**
  * Open the file 'filename', read one word into 'testname', and close the file.
  * If the file cannot be found, exit with error.
@@ -0,0 +1,99 @@
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <stddef.h>
+
+/**
+ * Gets the time from a clock that only ever moves forward at a steady rate,
+ * unaffected by changes to the system time or by how busy the process is.
+ * Only differences between two readings are meaningful.
+ *
+ * @return the current time in seconds, with nanosecond resolution
+ */
+double timing_now(void);
+
+/**
+ * Keeps a loop running at a steady frame rate and measures its frames.
+ * Call frame_timer_tick() once at the top of every frame: it sleeps until
+ * the frame is due (without spinning), then reports how long the last frame
+ * took. A frame that runs late pushes back the schedule instead of making
+ * the following frames rush to catch up.
+ */
+typedef struct frame_timer FrameTimer;
+
+/**
+ * Allocates memory for a frame timer.
+ * Asserts that the required memory was allocated.
+ *
+ * @param target_fps how many frames per second to pace the loop to,
+ *   or 0 to measure frames without sleeping
+ * @return a pointer to the newly allocated timer
+ */
+FrameTimer *frame_timer_init(double target_fps);
+
+/**
+ * Releases the memory allocated for a frame timer.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ */
+void frame_timer_free(FrameTimer *timer);
+
+/**
+ * Ends a frame: sleeps until the next frame is due, if the timer paces,
+ * and records how long the frame took.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the seconds since the last call, or 0 the first time
+ */
+double frame_timer_tick(FrameTimer *timer);
+
+/**
+ * Gets how many frames the timer has measured since its stats were reset.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the number of frames
+ */
+size_t frame_timer_frames(FrameTimer *timer);
+
+/**
+ * Gets the mean length of the measured frames.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the mean frame time in seconds, or 0 if none were measured
+ */
+double frame_timer_mean(FrameTimer *timer);
+
+/**
+ * Gets the length of the shortest measured frame.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the minimum frame time in seconds, or 0 if none were measured
+ */
+double frame_timer_min(FrameTimer *timer);
+
+/**
+ * Gets the length of the longest measured frame, e.g. to spot hitches.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the maximum frame time in seconds, or 0 if none were measured
+ */
+double frame_timer_max(FrameTimer *timer);
+
+/**
+ * Gets the mean time per frame spent working rather than sleeping,
+ * i.e. how much of the frame budget the loop actually uses.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the mean busy time per frame in seconds, or 0 if none were measured
+ */
+double frame_timer_busy(FrameTimer *timer);
+
+/**
+ * Forgets the frames measured so far, e.g. once a level has loaded.
+ * Does not change the pacing.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ */
+void frame_timer_reset_stats(FrameTimer *timer);
+
+#endif // #ifndef __TIMING_H__
@@ -5,16 +5,10 @@
 #include "vector.h"
 #include "scene.h"
 #include "comparator.h"
-#include "sdl_wrapper.h"
 #include <stdbool.h>
 
 extern const double CLOSENESS;
 
-/**
- * Initializes/sets coordinates of the window.
- */
-void initialize_window(Vector dimensions);
-
 /**
  * Initializes the scene.
  * @return    the initalized scene
@@ -42,6 +36,13 @@ List* get_arrow_points(Vector pivot, double width, double height, double arrow_l
 */
 List* get_rectangle(Vector center, double width, double height);
 
+/**
+* Same as get_rectangle(), but the list and its vertices come from an arena
+* (or the heap, if arena is NULL)
+*/
+List* get_rectangle_arena(Vector center, double width, double height, \
+    Arena *arena);
+
 /**
  * Returns 1 if the two bodies are too close to one another. This function is
  * used when trying to calculate force of gravity because we do not want
@@ -186,6 +187,13 @@ double max(double a, double b);
 */
 List *get_bloon_points(Vector center, double x_span, double y_span);
 
+/**
+* Same as get_bloon_points(), but the list and its vertices come from an arena
+* (or the heap, if arena is NULL)
+*/
+List *get_bloon_points_arena(Vector center, double x_span, double y_span, \
+    Arena *arena);
+
 /**
 * Gets the points of a dart given a center, length, and thickness
 *
@@ -1,16 +1,39 @@
 #ifndef __VECTOR_H__
 #define __VECTOR_H__
 
+#include "arena.h"
+#include "array.h"
+#include <float.h>
+
+/**
+ * The type of a vector's components, and so of every vertex and position.
+ * Building with SCALAR_FLOAT defined ("make FLOAT=1") makes it float, which
+ * halves the memory that vertex data takes and the bandwidth to stream it;
+ * otherwise it is double. Masses, times and other per-body values stay double.
+ */
+#ifdef SCALAR_FLOAT
+typedef float Scalar;
+#define SCALAR_EPSILON FLT_EPSILON
+#else
+typedef double Scalar;
+#define SCALAR_EPSILON DBL_EPSILON
+#endif
+
 /**
  * A real-valued 2-dimensional vector.
  * Positive x is towards the right; positive y is towards the top.
  * Vector is defined here instead of vector.c because it is passed *by value*.
  */
 typedef struct vector{
-    double x;
-    double y;
+    Scalar x;
+    Scalar y;
 } Vector;
 
+/**
+ * A growable array of vectors stored by value; see DEFINE_ARRAY in array.h.
+ */
+DEFINE_ARRAY(Vector)
+
 /**
  * The zero vector, i.e. (0, 0).
  * "extern" declares this global variable without allocating memory for it.
@@ -25,7 +48,7 @@ extern const Vector VEC_ZERO;
  * @param y the y-component of the new vector
  * @return a new vector that represents <x, y>
  */
-Vector vec_init(double x, double y);
+Vector vec_init(Scalar x, Scalar y);
 
 /**
  * Initializes a pointer to a vector object
@@ -35,6 +58,17 @@ Vector vec_init(double x, double y);
  */
 Vector *create_vector_p(Vector v);
 
+/**
+ * Initializes a pointer to a vector object allocated from an arena.
+ * The vector must not be passed to vector_free(); arena_reset() reclaims it.
+ * If arena is NULL, this behaves exactly like create_vector_p().
+ *
+ * @param v the vector object to create a pointer to
+ * @param arena the arena to allocate from, or NULL to use the heap
+ * @return pointer to a vector with the attributes of v
+ */
+Vector *create_vector_arena(Vector v, Arena *arena);
+
 /**
  * Releases the memory allocated for a vector.
  *
@@ -79,7 +113,7 @@ Vector vec_negate(Vector v);
  * @param v the vector to scale
  * @return scalar * v
  */
-Vector vec_multiply(double scalar, Vector v);
+Vector vec_multiply(Scalar scalar, Vector v);
 
 /**
  * Computes the dot product of two vectors.
@@ -89,7 +123,7 @@ Vector vec_multiply(double scalar, Vector v);
  * @param v2 the second vector
  * @return v1 . v2
  */
-double vec_dot(Vector v1, Vector v2);
+Scalar vec_dot(Vector v1, Vector v2);
 
 /**
  * Computes the cross product of two vectors,
@@ -100,7 +134,7 @@ double vec_dot(Vector v1, Vector v2);
  * @param v2 the second vector
  * @return the z-component of v1 x v2
  */
-double vec_cross(Vector v1, Vector v2);
+Scalar vec_cross(Vector v1, Vector v2);
 
 /**
  * Rotates a vector by an angle around (0, 0).
@@ -137,13 +171,13 @@ Vector vec_unit_vector(Vector v1);
  * @param  v2 vector 2
  * @return    the distance
  */
-double vec_distance(Vector v1, Vector v2);
+Scalar vec_distance(Vector v1, Vector v2);
 
 /**
  * Returns magnitude of a vector
  * @param  v the vector
  * @return   the magnitude
  */
-double vec_magnitude(Vector v);
+Scalar vec_magnitude(Vector v);
 double vec_angle(Vector v);
 #endif // #ifndef __VECTOR_H__
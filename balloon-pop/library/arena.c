@@ -0,0 +1,110 @@
+#include "arena.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+
+#define FRAME_ARENA_CHUNK_SIZE (16 * 1024)
+
+typedef struct chunk {
+    struct chunk *next;
+    size_t capacity;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+} Chunk;
+
+struct arena {
+    Chunk *first;
+    Chunk *current;
+    size_t chunk_size;
+    size_t used;
+};
+
+/* Rounds size up so the next block starts at a max_align_t boundary */
+static size_t align_up(size_t size) {
+    size_t align = alignof(max_align_t);
+    return (size + align - 1) & ~(align - 1);
+}
+
+static Chunk *chunk_init(size_t capacity) {
+    Chunk *chunk = malloc(sizeof(Chunk) + capacity);
+    assert(chunk);
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    return chunk;
+}
+
+Arena *arena_init(size_t chunk_size) {
+    assert(chunk_size > 0);
+    Arena *arena = malloc(sizeof(Arena));
+    assert(arena);
+    arena->chunk_size = align_up(chunk_size);
+    arena->first = chunk_init(arena->chunk_size);
+    arena->current = arena->first;
+    arena->used = 0;
+    return arena;
+}
+
+void arena_free(Arena *arena) {
+    assert(arena);
+    Chunk *chunk = arena->first;
+    while (chunk) {
+        Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    assert(arena);
+    size = align_up(size);
+    Chunk *chunk = arena->current;
+
+    // Walk forward through chunks kept from before the last reset,
+    // chaining on a fresh one once we run out
+    while (chunk->used + size > chunk->capacity) {
+        if (!chunk->next) {
+            size_t capacity = size > arena->chunk_size ? size : arena->chunk_size;
+            chunk->next = chunk_init(capacity);
+        }
+        chunk = chunk->next;
+        chunk->used = 0;
+    }
+    arena->current = chunk;
+
+    void *block = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->used += size;
+    return block;
+}
+
+void arena_reset(Arena *arena) {
+    assert(arena);
+    arena->first->used = 0;
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+size_t arena_used(Arena *arena) {
+    assert(arena);
+    return arena->used;
+}
+
+/**
+ * The per-frame scratch arena, or NULL until frame_arena() is first called.
+ */
+static Arena *scratch = NULL;
+
+Arena *frame_arena(void) {
+    if (!scratch) {
+        scratch = arena_init(FRAME_ARENA_CHUNK_SIZE);
+    }
+    return scratch;
+}
+
+void frame_arena_reset(void) {
+    if (scratch) {
+        arena_reset(scratch);
+    }
+}
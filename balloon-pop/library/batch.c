@@ -0,0 +1,35 @@
+#include "batch.h"
+#include <assert.h>
+
+typedef struct {
+    Scene **scenes;
+    size_t ticks;
+    double dt;
+    BatchCallback callback;
+    void *aux;
+} Batch;
+
+/* Runs a chunk of the batch's scenes to completion */
+static void run_scenes(size_t start, size_t end, size_t thread, void *aux) {
+    Batch *batch = aux;
+    for (size_t i = start; i < end; i++) {
+        Scene *scene = batch->scenes[i];
+        for (size_t tick = 0; tick < batch->ticks; tick++) {
+            scene_tick(scene, batch->dt);
+        }
+        if (batch->callback) {
+            batch->callback(scene, i, batch->aux);
+        }
+    }
+}
+
+void batch_run(
+    JobSystem *jobs, Scene **scenes, size_t count, size_t ticks, double dt,
+    BatchCallback callback, void *aux
+) {
+    assert(scenes || count == 0);
+    Batch batch = {scenes, ticks, dt, callback, aux};
+    // Scenes can take very different times to tick, so hand them out singly
+    // and let idle threads steal the rest
+    parallel_for(jobs, count, 1, run_scenes, &batch);
+}
@@ -5,14 +5,20 @@
 #include "test_util.h"
 #include <stdio.h>
 
+// Slower than this, a body's velocity is rounding noise with no real heading
+#define MIN_HEADING_SPEED 1e-3
+
+// Set by body_record_into() to log this thread's forces and impulses
+static _Thread_local ContributionArray *recording = NULL;
+
 struct body {
     List *points;
-    Vector *velocity;
-    Vector *acceleration;
-    Vector *centroid;
-    Vector *elasticity;
-    Vector *forces;
-    Vector *impulses;
+    Vector velocity;
+    Vector acceleration;
+    Vector centroid;
+    Vector elasticity;
+    Vector forces;
+    Vector impulses;
     void *info;
     FreeFunc info_freer;
     RGBColor color;
@@ -20,11 +26,13 @@ struct body {
     double angle;
     Body* other;
     double time_since_last_collision;
+    Arena *arena;
 };
 
 struct bodyInfo {
     void* info;
     int existence;
+    bool has_role;  // whether info is known to be a Role
 };
 
 Body *body_init(List *shape, double mass, RGBColor color) {
@@ -36,24 +44,52 @@ BodyInfo* body_info_init(void* info) {
     assert(b_i);
     b_i->info = info;
     b_i->existence = NOT_REMOVED;
+    b_i->has_role = false;
     return b_i;
 }
 
 Body *body_init_with_info(
     List *shape, double mass, RGBColor color, void *info, FreeFunc info_freer
+) {
+    return body_init_arena(shape, mass, color, info, info_freer, NULL);
+}
+
+Body *body_init_with_role(List *shape, double mass, RGBColor color, Role role) {
+    Role *info = malloc(sizeof(Role));
+    assert(info);
+    *info = role;
+    Body *body = body_init_with_info(shape, mass, color, info, free);
+    ((BodyInfo *) body->info)->has_role = true;
+    return body;
+}
+
+Body *body_init_arena(
+    List *shape, double mass, RGBColor color, void *info, FreeFunc info_freer,
+    Arena *arena
 ) {
     assert(mass > 0);
-    Body *body = malloc(sizeof(Body));
-    assert(body);
+    Body *body;
+    BodyInfo *b_i;
+    if (arena) {
+        body = arena_alloc(arena, sizeof(Body));
+        b_i = arena_alloc(arena, sizeof(BodyInfo));
+        b_i->info = info;
+        b_i->existence = NOT_REMOVED;
+        b_i->has_role = false;
+    } else {
+        body = malloc(sizeof(Body));
+        assert(body);
+        b_i = body_info_init(info);
+    }
     body->points = shape;
-    body->velocity = create_vector_p(VEC_ZERO);
-    body->acceleration = create_vector_p(VEC_ZERO);
-    body->elasticity = create_vector_p(VEC_ZERO);
-    body->centroid = create_vector_p(body_calculate_centroid(body));
-    body->forces = create_vector_p(VEC_ZERO);
-    body->impulses = create_vector_p(VEC_ZERO);
+    body->velocity = VEC_ZERO;
+    body->acceleration = VEC_ZERO;
+    body->elasticity = VEC_ZERO;
+    body->centroid = body_calculate_centroid(body);
+    body->forces = VEC_ZERO;
+    body->impulses = VEC_ZERO;
     body->other = NULL;
-    BodyInfo* b_i = body_info_init(info);
+    body->arena = arena;
     body->info = b_i;
     body->info_freer = info_freer;
     body->color = color;
@@ -67,18 +103,23 @@ void body_free(void *b) {
     assert(b);
     Body* body = b;
     list_free(body->points);
-    vector_free(body->velocity);
-    vector_free(body->acceleration);
-    vector_free(body->forces);
-    vector_free(body->impulses);
-    vector_free(body->elasticity);
-    vector_free(body->centroid);
     BodyInfo* i = body->info;
-    body->info_freer(i->info);
+    if (body->info_freer) {
+        body->info_freer(i->info);
+    }
+    // The body and its info struct are reclaimed by arena_reset()
+    if (body->arena) {
+        return;
+    }
     free(i);
     free(body);
 }
 
+Arena *body_get_arena(Body *body) {
+    assert(body);
+    return body->arena;
+}
+
 List *body_get_shape(Body *body) {
     assert(body);
     return body->points;
@@ -96,22 +137,22 @@ double body_get_angle(Body *body) {
 
 Vector body_get_elasticity(Body *body) {
     assert(body);
-    return *body->elasticity;
+    return body->elasticity;
 }
 
 Vector body_get_centroid(Body *body) {
     assert(body);
-    return *body->centroid;
+    return body->centroid;
 }
 
 Vector body_get_velocity(Body *body) {
     assert(body);
-    return *body->velocity;
+    return body->velocity;
 }
 
 Vector body_get_acceleration(Body *body) {
     assert(body);
-    return *body->acceleration;
+    return body->acceleration;
 }
 
 double body_get_mass(Body *body) {
@@ -136,29 +177,30 @@ double body_get_time_since_last_collision(Body *body) {
 
 void body_set_centroid(Body *body, Vector new_centroid) {
     assert(body);
-    Vector diff = vec_subtract(new_centroid, *(body->centroid));
+    Vector diff = vec_subtract(new_centroid, body->centroid);
 
-    *(body->centroid) = new_centroid;
+    body->centroid = new_centroid;
 
+    // Move the vertices in place; arena-backed shapes can't swap them out
     for (size_t i = 0; i < list_size(body->points); i++) {
-        list_set(body_get_shape(body), i, create_vector_p(vec_add(diff, \
-            *(Vector *)list_get(body_get_shape(body), i))));
+        Vector *v_i = list_get(body->points, i);
+        *v_i = vec_add(diff, *v_i);
     }
 }
 
 void body_set_elasticity(Body *body, Vector v) {
     assert(body);
-    *(body->elasticity) = v;
+    body->elasticity = v;
 }
 
 void body_set_acceleration(Body *body, Vector v) {
     assert(body);
-    *(body->acceleration) = v;
+    body->acceleration = v;
 }
 
 void body_set_velocity(Body *body, Vector v) {
     assert(body);
-    *(body->velocity) = v;
+    body->velocity = v;
 }
 
 void body_set_rotation_custom(Body *body, double angle, Vector pivot) {
@@ -177,8 +219,7 @@ void body_set_rotation_custom(Body *body, double angle, Vector pivot) {
             */
         Vector v_i_origin = vec_subtract(*v_i, pivot);
         Vector v_i_origin_rotate = vec_rotate(v_i_origin, diff);
-        Vector rotated_vec = vec_add(v_i_origin_rotate, pivot);
-        list_set(points_list, i, create_vector_p(rotated_vec));
+        *v_i = vec_add(v_i_origin_rotate, pivot);
     }
     body->angle = angle;
 }
@@ -189,12 +230,22 @@ void body_set_rotation(Body *body, double angle) {
 
 void body_set_force(Body *body, Vector force) {
     assert(body);
-    *(body->forces) = force;
+    body->forces = force;
 }
 
 void body_set_impulse(Body *body, Vector impulse) {
     assert(body);
-    *(body->impulses)= impulse;
+    body->impulses = impulse;
+}
+
+Vector body_get_force(Body *body) {
+    assert(body);
+    return body->forces;
+}
+
+Vector body_get_impulse(Body *body) {
+    assert(body);
+    return body->impulses;
 }
 
 Body* body_get_colliding_body(Body *body) {
@@ -210,6 +261,7 @@ void body_set_colliding_body(Body *body, Body* other) {
 void body_set_role(Body *body, Role role) {
   assert(body);
   *((Role*)(((BodyInfo*)(body->info))->info)) = role;
+  ((BodyInfo*)(body->info))->has_role = true;
 }
 
 void body_set_color(Body *body, RGBColor color) {
@@ -230,32 +282,36 @@ void body_set_time_since_last_collision(Body *body, double time) {
 
 void body_rotate_with_velocity(Body *body) {
     // Rotate body to be in alignment with its velocity
-    Vector current_vel = *(body->velocity);
-    if (current_vel.x == 0 && current_vel.y == 0) return;
+    Vector current_vel = body->velocity;
+    if (vec_magnitude(current_vel) < MIN_HEADING_SPEED) return;
     body_set_rotation(body, vec_angle(current_vel));
 }
 
 void body_tick(Body *body, double dt) {
+    body_tick_in_field(body, dt, VEC_ZERO);
+}
+
+void body_tick_in_field(Body *body, double dt, Vector field) {
     assert(body);
 
     // If mass is infinity, it should not move
     if (body->mass == INFINITY) {
         return;
     }
-    Vector* start_velocity = body->velocity;
-    // J = F*t = mv_2 - mv_1
-    Vector total_impulses = vec_add(*(body->impulses), \
-        vec_multiply(dt, *(body->forces)));
+    Vector start_velocity = body->velocity;
 
-    Vector velocity_change = vec_multiply(1 / body->mass, total_impulses);
-    Vector end_velocity = vec_add(*start_velocity, velocity_change);
+    // Newton's second law. F = ma --> a = F/m, plus the field's acceleration
+    body->acceleration = vec_add(vec_multiply(1 / body->mass, body->forces), \
+        field);
 
-    // Newton's second law. F = ma --> a = F/m
-    *(body->acceleration) = vec_multiply(1 / body->mass, *(body->forces));
+    // J = F*t = mv_2 - mv_1
+    Vector velocity_change = vec_add(vec_multiply(1 / body->mass, \
+        body->impulses), vec_multiply(dt, body->acceleration));
+    Vector end_velocity = vec_add(start_velocity, velocity_change);
 
     // d = v_(avg) * t
     Vector translate = vec_multiply(dt, vec_multiply(0.5, \
-        vec_add(*start_velocity, end_velocity)));
+        vec_add(start_velocity, end_velocity)));
     body_translate(body, translate);
 
     body_set_velocity(body, end_velocity);
@@ -266,31 +322,153 @@ void body_tick(Body *body, double dt) {
     body_rotate_with_velocity(body);
 }
 
+void body_tick_semi_implicit(Body *body, double dt, Vector field) {
+    assert(body);
+    if (body->mass == INFINITY) {
+        return;
+    }
+    body->acceleration = vec_add(vec_multiply(1 / body->mass, body->forces),
+        field);
+    // v_(n+1) = v_n + J/m + a*t, then d = v_(n+1) * t
+    body->velocity = vec_add(body->velocity, vec_add(
+        vec_multiply(1 / body->mass, body->impulses),
+        vec_multiply(dt, body->acceleration)));
+    body_translate(body, vec_multiply(dt, body->velocity));
+
+    body_set_force(body, VEC_ZERO);
+    body_set_impulse(body, VEC_ZERO);
+    body_rotate_with_velocity(body);
+}
+
+void body_drift(Body *body, double dt) {
+    assert(body);
+    if (body->mass == INFINITY) {
+        return;
+    }
+    // d = vt + at^2/2
+    body_translate(body, vec_add(vec_multiply(dt, body->velocity),
+        vec_multiply(dt * dt * 0.5, body->acceleration)));
+}
+
+void body_tick_verlet(Body *body, double dt, Vector field) {
+    assert(body);
+    if (body->mass == INFINITY) {
+        return;
+    }
+    Vector acceleration = vec_add(vec_multiply(1 / body->mass, body->forces),
+        field);
+    // v_(n+1) = v_n + J/m + (a_n + a_(n+1))/2 * t
+    Vector average = vec_multiply(0.5, vec_add(body->acceleration,
+        acceleration));
+    body->velocity = vec_add(body->velocity, vec_add(
+        vec_multiply(1 / body->mass, body->impulses),
+        vec_multiply(dt, average)));
+    body->acceleration = acceleration;
+
+    body_set_force(body, VEC_ZERO);
+    body_set_impulse(body, VEC_ZERO);
+    body_rotate_with_velocity(body);
+}
+
 void body_tick_no_forces(Body *body, double dt) {
     assert(body);
     // d = vt + at^2/2
-    Vector translate = vec_add(vec_multiply(dt, *(body->velocity)),
-        vec_multiply(dt * dt * 0.5, *(body->acceleration)));
+    Vector translate = vec_add(vec_multiply(dt, body->velocity),
+        vec_multiply(dt * dt * 0.5, body->acceleration));
     body_translate(body, translate);
 
     // v_f = v_i + at
-    body_set_velocity(body, (vec_add(*(body->velocity), \
-        vec_multiply(dt, *(body->acceleration)))));
+    body_set_velocity(body, (vec_add(body->velocity, \
+        vec_multiply(dt, body->acceleration))));
     body_rotate_with_velocity(body);
 
 }
 
 
+void body_save_state(Body *body, BodyState *state, Vector *vertices) {
+    assert(body);
+    assert(state);
+    BodyInfo *info = body->info;
+    *state = (BodyState) {
+        .velocity = body->velocity,
+        .acceleration = body->acceleration,
+        .centroid = body->centroid,
+        .elasticity = body->elasticity,
+        .forces = body->forces,
+        .impulses = body->impulses,
+        .color = body->color,
+        .mass = body->mass,
+        .angle = body->angle,
+        .time_since_last_collision = body->time_since_last_collision,
+        .colliding_body = body->other,
+        .has_role = info->has_role,
+        .role = info->has_role ? body_get_role(body) : 0,
+        .removed = info->existence == REMOVED
+    };
+    for (size_t i = 0; i < list_size(body->points); i++) {
+        vertices[i] = *(Vector *) list_get(body->points, i);
+    }
+}
+
+void body_load_state(
+    Body *body, const BodyState *state, const Vector *vertices
+) {
+    assert(body);
+    assert(state);
+    BodyInfo *info = body->info;
+    body->velocity = state->velocity;
+    body->acceleration = state->acceleration;
+    body->centroid = state->centroid;
+    body->elasticity = state->elasticity;
+    body->forces = state->forces;
+    body->impulses = state->impulses;
+    body->color = state->color;
+    body->mass = state->mass;
+    body->angle = state->angle;
+    body->time_since_last_collision = state->time_since_last_collision;
+    body->other = state->colliding_body;
+    info->has_role = state->has_role;
+    if (info->has_role) {
+        *(Role *) info->info = state->role;
+    }
+    info->existence = state->removed ? REMOVED : NOT_REMOVED;
+    for (size_t i = 0; i < list_size(body->points); i++) {
+        *(Vector *) list_get(body->points, i) = vertices[i];
+    }
+}
+
+void body_record_into(ContributionArray *log) {
+    recording = log;
+}
+
+void body_replay(const ContributionArray *log) {
+    assert(log);
+    for (size_t i = 0; i < Contribution_array_size(log); i++) {
+        Contribution *c = log->data + i;
+        Vector *total = c->impulse ? &c->body->impulses : &c->body->forces;
+        total->x += c->value.x;
+        total->y += c->value.y;
+    }
+}
+
 void body_add_force(Body *body, Vector force) {
     assert(body);
-    body->forces->x += force.x;
-    body->forces->y += force.y;
+    if (recording) {
+        Contribution_array_add(recording, (Contribution) {body, force, false});
+        return;
+    }
+    body->forces.x += force.x;
+    body->forces.y += force.y;
 }
 
 void body_add_impulse(Body *body, Vector impulse) {
     assert(body);
-    body->impulses->x += impulse.x;
-    body->impulses->y += impulse.y;
+    if (recording) {
+        Contribution_array_add(recording, (Contribution) {body, impulse, true});
+        return;
+    }
+    body->impulses.x += impulse.x;
+    body->impulses.y += impulse.y;
 }
 
 double body_area(Body* body) {
@@ -4,18 +4,74 @@
 #include <stdlib.h>
 
 Vector find_collision(List *shape1, List *shape2) {
-  Vector collision_axis;
-  double *overlap1 = (double *)malloc(sizeof(double));
-  double *overlap2 = (double *)malloc(sizeof(double));
-  Vector axis1 = check_shape_axes(shape1, shape2, overlap1);
-  Vector axis2 = check_shape_axes(shape2, shape1, overlap2);
-  if (overlap1 < overlap2) {
-    collision_axis = axis1;
+  double overlap;
+  /*
+   * Only shape2's axes decide the result; this used to compare the addresses
+   * of two malloc'd overlaps and then overwrite the choice with axis2 anyway.
+   */
+  return check_shape_axes(shape2, shape1, &overlap);
+}
+
+/* Projects every vertex of shape onto axis; returns (min, max) */
+static Vector project_shape(List *shape, Vector axis) {
+  double first = vec_dot(*(Vector *) list_get(shape, 0), axis);
+  Vector min_max = {first, first};
+  for (size_t i = 1; i < list_size(shape); i++) {
+    double projection = vec_dot(*(Vector *) list_get(shape, i), axis);
+    min_max.x = min(min_max.x, projection);
+    min_max.y = max(min_max.y, projection);
   }
-  collision_axis = axis2;
-  free(overlap1);
-  free(overlap2);
-  return collision_axis;
+  return min_max;
+}
+
+/* Lowers info->depth to the smallest overlap along shape's edge normals */
+static bool check_edge_normals(
+  List *shape, List *shape1, List *shape2, CollisionInfo *info
+) {
+  size_t j = list_size(shape) - 1;
+  for (size_t i = 0; i < list_size(shape); i++) {
+    Vector edge = vec_subtract(*(Vector *) list_get(shape, i),
+                               *(Vector *) list_get(shape, j));
+    j = i;
+    if (edge.x == 0 && edge.y == 0) {
+      continue;
+    }
+    Vector normal = vec_unit_vector((Vector) {-edge.y, edge.x});
+    Vector min_max1 = project_shape(shape1, normal);
+    Vector min_max2 = project_shape(shape2, normal);
+    double overlaps = min(min_max1.y, min_max2.y) - max(min_max1.x, min_max2.x);
+    if (overlaps <= 0) {
+      return false;
+    }
+    if (overlaps < info->depth) {
+      info->depth = overlaps;
+      info->axis = normal;
+    }
+  }
+  return true;
+}
+
+/* The average of a shape's vertices, which is enough to orient an axis */
+static Vector vertex_average(List *shape) {
+  Vector sum = VEC_ZERO;
+  for (size_t i = 0; i < list_size(shape); i++) {
+    sum = vec_add(sum, *(Vector *) list_get(shape, i));
+  }
+  return vec_multiply(1.0 / list_size(shape), sum);
+}
+
+CollisionInfo find_collision_info(List *shape1, List *shape2) {
+  CollisionInfo info = {.collided = false, .axis = VEC_ZERO, .depth = INFINITY};
+  if (!check_edge_normals(shape1, shape1, shape2, &info) ||
+      !check_edge_normals(shape2, shape1, shape2, &info)) {
+    return info;
+  }
+  info.collided = true;
+  Vector direction = vec_subtract(vertex_average(shape2), vertex_average(shape1));
+  if (vec_dot(direction, info.axis) < 0) {
+    info.axis = vec_multiply(-1, info.axis);
+  }
+  return info;
 }
 
 Vector check_shape_axes(List *shape1, List *shape2, double *min_overlap) {
@@ -56,24 +112,21 @@ double overlap(List *shape1, List *shape2, Vector projection_line) {
                         vec_dot(first_point1, projection_line)};
   Vector projection2 = {vec_dot(first_point2, projection_line), \
                         vec_dot(first_point2, projection_line)};
-  Vector *min_max1 = create_vector_p(projection1);
-  Vector *min_max2 = create_vector_p(projection2);
+  Vector min_max1 = projection1;
+  Vector min_max2 = projection2;
 
-  projection_min_max(shape1, projection_line, min_max1);
-  projection_min_max(shape2, projection_line, min_max2);
+  projection_min_max(shape1, projection_line, &min_max1);
+  projection_min_max(shape2, projection_line, &min_max2);
 
   double overlaps = 0;
 
-  if (is_between(min_max1->x, min_max2) || \
-      is_between(min_max1->y, min_max2) ||
-      is_between(min_max2->x, min_max1) ||
-      is_between(min_max2->y, min_max1)) {
-    overlaps = (min(min_max1->y, min_max2->y) - max(min_max1->x, min_max2->x));
+  if (is_between(min_max1.x, &min_max2) || \
+      is_between(min_max1.y, &min_max2) ||
+      is_between(min_max2.x, &min_max1) ||
+      is_between(min_max2.y, &min_max1)) {
+    overlaps = (min(min_max1.y, min_max2.y) - max(min_max1.x, min_max2.x));
   };
 
-  vector_free(min_max1);
-  vector_free(min_max2);
-
   return overlaps;
 }
 
@@ -0,0 +1,235 @@
+#include "constraints.h"
+#include "array.h"
+#include "collision.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    DISTANCE_CONSTRAINT,
+    PIN_CONSTRAINT,
+    CONTACT_CONSTRAINT
+} ConstraintType;
+
+typedef struct {
+    ConstraintType type;
+    Body *body1;
+    Body *body2;        // NULL for pins
+    Vector point;       // pins only
+    double distance;    // distance constraints only
+    double compliance;
+    double lambda;      // accumulated multiplier, reset every tick
+} Constraint;
+
+DEFINE_ARRAY(Constraint)
+
+struct constraints {
+    ConstraintArray items;
+    VectorArray start_positions;    // scratch, one per body being solved
+};
+
+Constraints *constraints_init(void) {
+    Constraints *constraints = malloc(sizeof(Constraints));
+    assert(constraints);
+    Constraint_array_init(&constraints->items, 0);
+    Vector_array_init(&constraints->start_positions, 0);
+    return constraints;
+}
+
+void constraints_free(Constraints *constraints) {
+    assert(constraints);
+    Constraint_array_free(&constraints->items);
+    Vector_array_free(&constraints->start_positions);
+    free(constraints);
+}
+
+size_t constraints_size(Constraints *constraints) {
+    assert(constraints);
+    return Constraint_array_size(&constraints->items);
+}
+
+size_t constraints_save_size(Constraints *constraints) {
+    assert(constraints);
+    return constraints_size(constraints) * sizeof(Constraint);
+}
+
+size_t constraints_save(Constraints *constraints, void *buf) {
+    size_t size = constraints_save_size(constraints);
+    if (size > 0) {
+        memcpy(buf, constraints->items.data, size);
+    }
+    return size;
+}
+
+void constraints_restore(Constraints *constraints, const void *buf, size_t size) {
+    assert(constraints);
+    assert(size % sizeof(Constraint) == 0);
+    Constraint_array_clear(&constraints->items);
+    Constraint_array_add_all(&constraints->items, buf, size / sizeof(Constraint));
+}
+
+static void constraints_add(Constraints *constraints, Constraint constraint) {
+    assert(constraints);
+    assert(constraint.body1);
+    assert(constraint.compliance >= 0);
+    constraint.lambda = 0;
+    Constraint_array_add(&constraints->items, constraint);
+}
+
+void constraints_add_distance(
+    Constraints *constraints, Body *body1, Body *body2,
+    double distance, double compliance
+) {
+    assert(body2);
+    constraints_add(constraints, (Constraint) {
+        .type = DISTANCE_CONSTRAINT,
+        .body1 = body1,
+        .body2 = body2,
+        .distance = distance,
+        .compliance = compliance
+    });
+}
+
+void constraints_add_pin(
+    Constraints *constraints, Body *body, Vector point, double compliance
+) {
+    constraints_add(constraints, (Constraint) {
+        .type = PIN_CONSTRAINT,
+        .body1 = body,
+        .body2 = NULL,
+        .point = point,
+        .compliance = compliance
+    });
+}
+
+void constraints_add_contact(Constraints *constraints, Body *body1, Body *body2) {
+    assert(body2);
+    constraints_add(constraints, (Constraint) {
+        .type = CONTACT_CONSTRAINT,
+        .body1 = body1,
+        .body2 = body2,
+        .compliance = 0
+    });
+}
+
+void constraints_prune(Constraints *constraints) {
+    assert(constraints);
+    size_t i = 0;
+    while (i < constraints_size(constraints)) {
+        Constraint *c = Constraint_array_at(&constraints->items, i);
+        if (body_is_removed(c->body1) || (c->body2 && body_is_removed(c->body2))) {
+            Constraint_array_remove(&constraints->items, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+static double inverse_mass(Body *body) {
+    double mass = body_get_mass(body);
+    return mass == INFINITY ? 0 : 1 / mass;
+}
+
+/*
+ * Moves the constrained bodies along the constraint gradient (normal points
+ * from body1 towards body2) to reduce the error c, scaled by inverse mass.
+ * Contacts may only push, so their multiplier is clamped to stay non-negative.
+ */
+static void project(
+    Constraint *constraint, double c, Vector normal, double alpha
+) {
+    double w1 = inverse_mass(constraint->body1);
+    double w2 = constraint->body2 ? inverse_mass(constraint->body2) : 0;
+    double denominator = w1 + w2 + alpha;
+    if (denominator == 0) {
+        return;
+    }
+    double delta = (-c - alpha * constraint->lambda) / denominator;
+    if (constraint->type == CONTACT_CONSTRAINT) {
+        double lambda = fmax(constraint->lambda + delta, 0);
+        delta = lambda - constraint->lambda;
+    }
+    constraint->lambda += delta;
+    if (w1 != 0) {
+        body_translate(constraint->body1, vec_multiply(-w1 * delta, normal));
+    }
+    if (w2 != 0) {
+        body_translate(constraint->body2, vec_multiply(w2 * delta, normal));
+    }
+}
+
+static void solve_constraint(Constraint *constraint, double alpha) {
+    switch (constraint->type) {
+        case DISTANCE_CONSTRAINT: {
+            Vector d = vec_subtract(body_get_centroid(constraint->body2),
+                body_get_centroid(constraint->body1));
+            double length = vec_magnitude(d);
+            if (length == 0) {
+                return;
+            }
+            project(constraint, length - constraint->distance,
+                vec_multiply(1 / length, d), alpha);
+            break;
+        }
+        case PIN_CONSTRAINT: {
+            // d points from the body to the pin, so the body moves along it
+            Vector d = vec_subtract(constraint->point,
+                body_get_centroid(constraint->body1));
+            double length = vec_magnitude(d);
+            if (length == 0) {
+                return;
+            }
+            project(constraint, length, vec_multiply(1 / length, d), alpha);
+            break;
+        }
+        case CONTACT_CONSTRAINT: {
+            CollisionInfo info = find_collision_info(
+                body_get_shape(constraint->body1),
+                body_get_shape(constraint->body2));
+            if (!info.collided) {
+                return;
+            }
+            project(constraint, -info.depth, info.axis, 0);
+            break;
+        }
+    }
+}
+
+void constraints_solve(
+    Constraints *constraints, BodyPtrArray *bodies, double dt, size_t iterations
+) {
+    assert(constraints);
+    assert(bodies);
+    size_t m = constraints_size(constraints);
+    if (m == 0 || dt <= 0) {
+        return;
+    }
+    size_t n = BodyPtr_array_size(bodies);
+    VectorArray *start = &constraints->start_positions;
+    Vector_array_clear(start);
+    Vector_array_reserve(start, n);
+    for (size_t b = 0; b < n; b++) {
+        Vector_array_add(start, body_get_centroid(bodies->data[b]));
+    }
+
+    for (size_t i = 0; i < m; i++) {
+        Constraint_array_at(&constraints->items, i)->lambda = 0;
+    }
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+        for (size_t i = 0; i < m; i++) {
+            Constraint *constraint = Constraint_array_at(&constraints->items, i);
+            solve_constraint(constraint, constraint->compliance / (dt * dt));
+        }
+    }
+
+    // Whatever the constraints moved a body by, it moved that fast
+    for (size_t b = 0; b < n; b++) {
+        Body *body = bodies->data[b];
+        Vector moved = vec_subtract(body_get_centroid(body), start->data[b]);
+        if (moved.x != 0 || moved.y != 0) {
+            body_set_velocity(body,
+                vec_add(body_get_velocity(body), vec_multiply(1 / dt, moved)));
+        }
+    }
+}
@@ -0,0 +1,303 @@
+#include "contact_solver.h"
+#include "array.h"
+#include "collision.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Overlap tolerated before contacts start pushing bodies apart
+#define PENETRATION_SLOP 0.01
+// Fraction of the remaining overlap to remove per tick
+#define PENETRATION_BIAS 0.2
+// Closing speeds below this don't bounce, so resting bodies stay at rest
+#define RESTITUTION_THRESHOLD 1.0
+// The slot table is at least this many times the bodies it may hold,
+// so probe runs stay short
+#define SLOT_TABLE_SPARSITY 2
+// Fibonacci hashing: multiplying by 2^64 / golden ratio spreads addresses
+#define POINTER_HASH_MULTIPLIER 11400714819323198485ULL
+
+typedef struct {
+    Body *body1;
+    Body *body2;
+    double elasticity;
+    double friction;
+
+    // Last tick's result, used to warm start; zero if they weren't touching
+    double normal_impulse;
+    double tangent_impulse;
+
+    // This tick's contact, filled in by contact_solver_solve()
+    bool touching;
+    Vector normal;          // from body1 towards body2
+    double target_speed;    // separating speed the normal impulse aims for
+    double normal_mass;     // 1 / (w1 + w2)
+    size_t index1;          // into the solver's velocity scratch
+    size_t index2;
+} Contact;
+
+DEFINE_ARRAY(Contact)
+
+/* Where a body's velocity is in the solver's scratch; NULL body if unused */
+typedef struct {
+    Body *body;
+    size_t slot;
+} SlotEntry;
+
+struct contact_solver {
+    ContactArray contacts;
+    // Per tick scratch: the bodies in touching contacts and their velocities
+    BodyPtrArray bodies;
+    VectorArray velocities;
+    VectorArray start_velocities;
+    // An open-addressed hash table from each of those bodies to its index
+    SlotEntry *slot_table;
+    size_t slot_table_bits;     // the table has 2^bits entries
+    double max_depth;   // deepest overlap found by the last solve
+};
+
+ContactSolver *contact_solver_init(void) {
+    ContactSolver *solver = malloc(sizeof(ContactSolver));
+    assert(solver);
+    Contact_array_init(&solver->contacts, 0);
+    BodyPtr_array_init(&solver->bodies, 0);
+    Vector_array_init(&solver->velocities, 0);
+    Vector_array_init(&solver->start_velocities, 0);
+    solver->slot_table = NULL;
+    solver->slot_table_bits = 0;
+    solver->max_depth = 0;
+    return solver;
+}
+
+void contact_solver_free(ContactSolver *solver) {
+    assert(solver);
+    Contact_array_free(&solver->contacts);
+    BodyPtr_array_free(&solver->bodies);
+    Vector_array_free(&solver->velocities);
+    Vector_array_free(&solver->start_velocities);
+    free(solver->slot_table);
+    free(solver);
+}
+
+size_t contact_solver_pairs(ContactSolver *solver) {
+    assert(solver);
+    return Contact_array_size(&solver->contacts);
+}
+
+void contact_solver_add(
+    ContactSolver *solver, Body *body1, Body *body2,
+    double elasticity, double friction
+) {
+    assert(solver);
+    assert(body1);
+    assert(body2);
+    assert(friction >= 0);
+    Contact contact = {
+        .body1 = body1,
+        .body2 = body2,
+        .elasticity = elasticity,
+        .friction = friction,
+        .normal_impulse = 0,
+        .tangent_impulse = 0,
+        .touching = false
+    };
+    Contact_array_add(&solver->contacts, contact);
+}
+
+double contact_solver_max_depth(ContactSolver *solver) {
+    assert(solver);
+    return solver->max_depth;
+}
+
+size_t contact_solver_save_size(ContactSolver *solver) {
+    assert(solver);
+    return contact_solver_pairs(solver) * sizeof(Contact);
+}
+
+size_t contact_solver_save(ContactSolver *solver, void *buf) {
+    size_t size = contact_solver_save_size(solver);
+    if (size > 0) {
+        memcpy(buf, solver->contacts.data, size);
+    }
+    return size;
+}
+
+void contact_solver_restore(ContactSolver *solver, const void *buf, size_t size) {
+    assert(solver);
+    assert(size % sizeof(Contact) == 0);
+    Contact_array_clear(&solver->contacts);
+    Contact_array_add_all(&solver->contacts, buf, size / sizeof(Contact));
+}
+
+void contact_solver_prune(ContactSolver *solver) {
+    assert(solver);
+    size_t i = 0;
+    while (i < contact_solver_pairs(solver)) {
+        Contact *c = Contact_array_at(&solver->contacts, i);
+        if (body_is_removed(c->body1) || body_is_removed(c->body2)) {
+            Contact_array_remove(&solver->contacts, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+static double inverse_mass(Body *body) {
+    double mass = body_get_mass(body);
+    return mass == INFINITY ? 0 : 1 / mass;
+}
+
+/* Empties the slot table, making it big enough for every pair's bodies */
+static void clear_slot_table(ContactSolver *solver, size_t pairs) {
+    size_t needed = SLOT_TABLE_SPARSITY * 2 * pairs;
+    // At least one bit, so hashing never shifts by the whole 64
+    size_t bits = solver->slot_table_bits > 0 ? solver->slot_table_bits : 1;
+    while (((size_t) 1 << bits) < needed) {
+        bits++;
+    }
+    if (bits != solver->slot_table_bits || !solver->slot_table) {
+        free(solver->slot_table);
+        solver->slot_table = malloc(sizeof(SlotEntry) << bits);
+        assert(solver->slot_table);
+        solver->slot_table_bits = bits;
+    }
+    memset(solver->slot_table, 0, sizeof(SlotEntry) << bits);
+}
+
+/* Gets the body's slot in the velocity scratch, adding it if it's new */
+static size_t body_slot(
+    ContactSolver *solver, Body *body, double dt, FieldFunc field, void *aux
+) {
+    size_t mask = ((size_t) 1 << solver->slot_table_bits) - 1;
+    size_t i = (size_t) (((uintptr_t) body * POINTER_HASH_MULTIPLIER)
+        >> (64 - solver->slot_table_bits)) & mask;
+    while (solver->slot_table[i].body) {
+        if (solver->slot_table[i].body == body) {
+            return solver->slot_table[i].slot;
+        }
+        i = (i + 1) & mask;
+    }
+    // Predict the velocity the body will end the tick with, before contacts
+    Vector velocity = body_get_velocity(body);
+    double w = inverse_mass(body);
+    if (w != 0) {
+        Vector change = vec_add(body_get_impulse(body),
+            vec_multiply(dt, body_get_force(body)));
+        velocity = vec_add(velocity, vec_multiply(w, change));
+        if (field) {
+            velocity = vec_add(velocity, vec_multiply(dt, field(body, aux)));
+        }
+    }
+    size_t slot = BodyPtr_array_size(&solver->bodies);
+    solver->slot_table[i] = (SlotEntry) {body, slot};
+    BodyPtr_array_add(&solver->bodies, body);
+    Vector_array_add(&solver->velocities, velocity);
+    Vector_array_add(&solver->start_velocities, velocity);
+    return slot;
+}
+
+/* Applies an impulse along direction to both bodies of a contact */
+static void apply_impulse(
+    ContactSolver *solver, Contact *contact, Vector direction, double impulse
+) {
+    Vector *velocities = solver->velocities.data;
+    Vector j = vec_multiply(impulse, direction);
+    velocities[contact->index1] = vec_subtract(velocities[contact->index1],
+        vec_multiply(inverse_mass(contact->body1), j));
+    velocities[contact->index2] = vec_add(velocities[contact->index2],
+        vec_multiply(inverse_mass(contact->body2), j));
+}
+
+static Vector relative_velocity(ContactSolver *solver, Contact *contact) {
+    return vec_subtract(solver->velocities.data[contact->index2],
+        solver->velocities.data[contact->index1]);
+}
+
+void contact_solver_solve(
+    ContactSolver *solver, double dt, size_t iterations,
+    FieldFunc field, void *aux
+) {
+    assert(solver);
+    BodyPtr_array_clear(&solver->bodies);
+    Vector_array_clear(&solver->velocities);
+    Vector_array_clear(&solver->start_velocities);
+    solver->max_depth = 0;
+    if (dt <= 0) {
+        return;
+    }
+    size_t m = contact_solver_pairs(solver);
+    clear_slot_table(solver, m);
+
+    // Find this tick's contacts and warm start them with last tick's impulses
+    for (size_t i = 0; i < m; i++) {
+        Contact *contact = Contact_array_at(&solver->contacts, i);
+        double w1 = inverse_mass(contact->body1);
+        double w2 = inverse_mass(contact->body2);
+        CollisionInfo info = find_collision_info(
+            body_get_shape(contact->body1), body_get_shape(contact->body2));
+        contact->touching = info.collided && w1 + w2 > 0;
+        if (!contact->touching) {
+            contact->normal_impulse = 0;
+            contact->tangent_impulse = 0;
+            continue;
+        }
+        contact->normal = info.axis;
+        contact->normal_mass = 1 / (w1 + w2);
+        solver->max_depth = fmax(solver->max_depth, info.depth);
+        contact->index1 = body_slot(solver, contact->body1, dt, field, aux);
+        contact->index2 = body_slot(solver, contact->body2, dt, field, aux);
+
+        double closing = vec_dot(relative_velocity(solver, contact), info.axis);
+        double bounce = closing < -RESTITUTION_THRESHOLD
+            ? -contact->elasticity * closing : 0;
+        double push = PENETRATION_BIAS / dt
+            * fmax(info.depth - PENETRATION_SLOP, 0);
+        contact->target_speed = fmax(bounce, push);
+
+        Vector tangent = {-info.axis.y, info.axis.x};
+        apply_impulse(solver, contact, info.axis, contact->normal_impulse);
+        apply_impulse(solver, contact, tangent, contact->tangent_impulse);
+    }
+
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+        for (size_t i = 0; i < m; i++) {
+            Contact *contact = Contact_array_at(&solver->contacts, i);
+            if (!contact->touching) {
+                continue;
+            }
+            Vector normal = contact->normal;
+            Vector tangent = {-normal.y, normal.x};
+
+            // Friction first, limited by the current normal impulse
+            double slide = vec_dot(relative_velocity(solver, contact), tangent);
+            double limit = contact->friction * contact->normal_impulse;
+            double old_tangent = contact->tangent_impulse;
+            contact->tangent_impulse = fmin(fmax(
+                old_tangent - contact->normal_mass * slide, -limit), limit);
+            apply_impulse(solver, contact, tangent,
+                contact->tangent_impulse - old_tangent);
+
+            // Then the normal impulse, which may only ever push
+            double speed = vec_dot(relative_velocity(solver, contact), normal);
+            double old_normal = contact->normal_impulse;
+            contact->normal_impulse = fmax(old_normal
+                + contact->normal_mass * (contact->target_speed - speed), 0);
+            apply_impulse(solver, contact, normal,
+                contact->normal_impulse - old_normal);
+        }
+    }
+
+    // Hand the net velocity change to each body as an impulse
+    for (size_t b = 0; b < BodyPtr_array_size(&solver->bodies); b++) {
+        Body *body = solver->bodies.data[b];
+        double w = inverse_mass(body);
+        if (w == 0) {
+            continue;
+        }
+        Vector change = vec_subtract(solver->velocities.data[b],
+            solver->start_velocities.data[b]);
+        body_add_impulse(body, vec_multiply(1 / w, change));
+    }
+}
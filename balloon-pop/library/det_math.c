@@ -0,0 +1,146 @@
+#include "det_math.h"
+#include <stdint.h>
+
+/*
+ * The trig functions sum their series in Q2.62: 64-bit integers with
+ * 62 fractional bits, enough for |values| < 2 to about 2e-19.
+ */
+#define Q62_ONE ((int64_t) 1 << 62)
+
+// Constants rounded to the nearest 2^-62
+#define Q62_HALF_PI 7244019458077122842LL
+#define Q62_SIXTH_PI 2414673152692374281LL
+#define Q62_INV_SQRT_3 2662558164157085850LL    // tan(pi / 6)
+#define Q62_TAN_PI_12 1235697544383518257LL     // tan(pi / 12) = 2 - sqrt(3)
+
+// pi/2 split into a part with its low bits clear, so q * PIO2_HI is exact
+// for the quarter turn counts q that come up, and the rest
+#define PIO2_HI 0x1.921fb544p+0
+#define PIO2_LO 0x1.0b4611a626331p-34
+// Past this, angles are brought down with fmod() before being reduced
+#define MAX_REDUCED_ANGLE 0x1p30
+
+// Taylor terms to sum; the last one is below 2^-62 over the reduced ranges
+#define SIN_COS_TERMS 10
+#define ATAN_TERMS 15
+
+static int64_t q62_mul(int64_t a, int64_t b) {
+    __int128 product = (__int128) a * b;
+    return (int64_t) ((product + (Q62_ONE >> 1)) >> 62);
+}
+
+static int64_t q62_div(int64_t a, int64_t b) {
+    return (int64_t) ((__int128) a * Q62_ONE / b);
+}
+
+/* Converts a double with |d| < 2 to Q2.62 */
+static int64_t q62_from_double(double d) {
+    return (int64_t) round(d * Q62_ONE);
+}
+
+static double q62_to_double(int64_t q) {
+    return (double) q / Q62_ONE;
+}
+
+/* sin(x) for |x| <= pi/4, as x(1 - x^2/(2*3)(1 - x^2/(4*5)(...))) */
+static int64_t sin_series(int64_t x) {
+    int64_t x2 = q62_mul(x, x);
+    int64_t sum = Q62_ONE;
+    for (int64_t k = SIN_COS_TERMS; k >= 1; k--) {
+        sum = Q62_ONE - q62_mul(x2, sum) / ((2 * k) * (2 * k + 1));
+    }
+    return q62_mul(x, sum);
+}
+
+/* cos(x) for |x| <= pi/4, as 1 - x^2/(1*2)(1 - x^2/(3*4)(...)) */
+static int64_t cos_series(int64_t x) {
+    int64_t x2 = q62_mul(x, x);
+    int64_t sum = Q62_ONE;
+    for (int64_t k = SIN_COS_TERMS; k >= 1; k--) {
+        sum = Q62_ONE - q62_mul(x2, sum) / ((2 * k - 1) * (2 * k));
+    }
+    return sum;
+}
+
+/*
+ * Writes x as q quarter turns plus r with |r| <= pi/4 (Cody-Waite reduction),
+ * so the series converge fast, then turns the quadrant back
+ */
+static void det_sin_cos(double x, double *sin_out, double *cos_out) {
+    if (!isfinite(x)) {
+        *sin_out = *cos_out = x - x;   // NaN, like sin() and cos()
+        return;
+    }
+    if (fabs(x) > MAX_REDUCED_ANGLE) {
+        x = fmod(x, 4 * PIO2_HI);
+    }
+    double q = round(x / PIO2_HI);
+    double r = (x - q * PIO2_HI) - q * PIO2_LO;
+    double s = q62_to_double(sin_series(q62_from_double(r)));
+    double c = q62_to_double(cos_series(q62_from_double(r)));
+    switch ((int64_t) q & 3) {
+        case 0:
+            *sin_out = s;
+            *cos_out = c;
+            break;
+        case 1:
+            *sin_out = c;
+            *cos_out = -s;
+            break;
+        case 2:
+            *sin_out = -s;
+            *cos_out = -c;
+            break;
+        default:
+            *sin_out = -c;
+            *cos_out = s;
+    }
+}
+
+double det_sin(double x) {
+    double s, c;
+    det_sin_cos(x, &s, &c);
+    return s;
+}
+
+double det_cos(double x) {
+    double s, c;
+    det_sin_cos(x, &s, &c);
+    return c;
+}
+
+/* atan(y) for |y| <= tan(pi/12), as y(1 - y^2(1/3 - y^2(1/5 - ...))) */
+static int64_t atan_series(int64_t y) {
+    int64_t y2 = q62_mul(y, y);
+    int64_t sum = Q62_ONE / (2 * ATAN_TERMS + 1);
+    for (int64_t k = ATAN_TERMS - 1; k >= 0; k--) {
+        sum = Q62_ONE / (2 * k + 1) - q62_mul(y2, sum);
+    }
+    return q62_mul(y, sum);
+}
+
+/* atan(x) for 0 <= x <= 1 */
+static int64_t atan_reduced(int64_t x) {
+    // atan(x) = pi/6 + atan((x - tan(pi/6)) / (1 + x tan(pi/6)))
+    if (x > Q62_TAN_PI_12) {
+        int64_t y = q62_div(x - Q62_INV_SQRT_3,
+            Q62_ONE + q62_mul(x, Q62_INV_SQRT_3));
+        return Q62_SIXTH_PI + atan_series(y);
+    }
+    return atan_series(x);
+}
+
+double det_atan(double x) {
+    if (isnan(x)) {
+        return x;
+    }
+    if (x < 0) {
+        return -det_atan(-x);
+    }
+    // atan(x) = pi/2 - atan(1/x)
+    if (x > 1) {
+        return q62_to_double(Q62_HALF_PI
+            - atan_reduced(q62_from_double(1 / x)));
+    }
+    return q62_to_double(atan_reduced(q62_from_double(x)));
+}
@@ -0,0 +1,173 @@
+#include "fixed_step.h"
+#include <assert.h>
+#include <stdlib.h>
+
+/* Where a body was, and how it was turned */
+typedef struct {
+    Body *body;
+    Vector centroid;
+    double angle;
+} Pose;
+
+DEFINE_ARRAY(Pose)
+
+struct fixed_step {
+    Scene *scene;
+    double dt;
+    size_t max_steps;
+    size_t max_merge;       // see fixed_step_set_max_merge()
+    double accumulator;     // time not yet ticked, less than dt between calls
+    double dropped;
+    StepFunc on_tick;
+    void *on_tick_aux;
+    // The bodies' poses before the last tick, by their index after it
+    PoseArray previous;
+    PoseArray scratch;
+};
+
+FixedStep *fixed_step_init(Scene *scene, double dt, size_t max_steps) {
+    assert(scene);
+    assert(dt > 0);
+    assert(max_steps > 0);
+    FixedStep *stepper = malloc(sizeof(FixedStep));
+    assert(stepper);
+    stepper->scene = scene;
+    stepper->dt = dt;
+    stepper->max_steps = max_steps;
+    stepper->max_merge = 1;
+    stepper->accumulator = 0;
+    stepper->dropped = 0;
+    stepper->on_tick = NULL;
+    stepper->on_tick_aux = NULL;
+    Pose_array_init(&stepper->previous, 0);
+    Pose_array_init(&stepper->scratch, 0);
+    return stepper;
+}
+
+void fixed_step_free(FixedStep *stepper) {
+    assert(stepper);
+    Pose_array_free(&stepper->previous);
+    Pose_array_free(&stepper->scratch);
+    free(stepper);
+}
+
+void fixed_step_on_tick(FixedStep *stepper, StepFunc func, void *aux) {
+    assert(stepper);
+    stepper->on_tick = func;
+    stepper->on_tick_aux = aux;
+}
+
+/* Records every body's pose in the scene, in order */
+static void save_poses(Scene *scene, PoseArray *poses) {
+    Pose_array_clear(poses);
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        Pose_array_add(poses, (Pose) {
+            body, body_get_centroid(body), body_get_angle(body)
+        });
+    }
+}
+
+/*
+ * Lines the saved poses up with the scene's bodies after a tick.
+ * Ticks only remove bodies (keeping the rest in order) or add them at the end,
+ * so each body is found by walking both lists together. Bodies without a
+ * saved pose get their current one.
+ */
+static void match_poses(Scene *scene, PoseArray *saved, PoseArray *matched) {
+    Pose_array_clear(matched);
+    size_t j = 0;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        size_t k = j;
+        while (k < Pose_array_size(saved) && saved->data[k].body != body) {
+            k++;
+        }
+        if (k < Pose_array_size(saved)) {
+            Pose_array_add(matched, saved->data[k]);
+            j = k + 1;
+        } else {
+            Pose_array_add(matched, (Pose) {
+                body, body_get_centroid(body), body_get_angle(body)
+            });
+        }
+    }
+}
+
+void fixed_step_set_max_merge(FixedStep *stepper, size_t max_merge) {
+    assert(stepper);
+    assert(max_merge >= 1);
+    stepper->max_merge = max_merge;
+}
+
+/* How many of the ticks that are due to run as one */
+static size_t ticks_to_merge(FixedStep *stepper, size_t steps) {
+    // Only a scene whose last tick needed no splitting is calm enough
+    if (stepper->max_merge == 1
+        || scene_get_tick_stats(stepper->scene).substeps != 1) {
+        return 1;
+    }
+    size_t due = (size_t) (stepper->accumulator / stepper->dt);
+    size_t merge = stepper->max_steps - steps;
+    merge = due < merge ? due : merge;
+    return stepper->max_merge < merge ? stepper->max_merge : merge;
+}
+
+size_t fixed_step_advance(FixedStep *stepper, double elapsed) {
+    assert(stepper);
+    assert(elapsed >= 0);
+    stepper->accumulator += elapsed;
+    size_t steps = 0;
+    while (stepper->accumulator >= stepper->dt && steps < stepper->max_steps) {
+        size_t merge = ticks_to_merge(stepper, steps);
+        double dt = merge * stepper->dt;
+        save_poses(stepper->scene, &stepper->scratch);
+        scene_tick(stepper->scene, dt);
+        if (stepper->on_tick) {
+            stepper->on_tick(stepper->scene, dt, stepper->on_tick_aux);
+        }
+        stepper->accumulator -= dt;
+        steps += merge;
+    }
+    if (stepper->accumulator >= stepper->dt) {
+        // Too far behind to catch up; keep the fraction of a tick, drop the rest
+        double behind = stepper->accumulator;
+        stepper->accumulator -= stepper->dt * (size_t) (behind / stepper->dt);
+        stepper->dropped += behind - stepper->accumulator;
+    }
+    // Bodies may have come and gone since the last frame, even without a tick
+    match_poses(stepper->scene, &stepper->scratch, &stepper->previous);
+    return steps;
+}
+
+double fixed_step_dt(FixedStep *stepper) {
+    assert(stepper);
+    return stepper->dt;
+}
+
+double fixed_step_alpha(FixedStep *stepper) {
+    assert(stepper);
+    return stepper->accumulator / stepper->dt;
+}
+
+double fixed_step_dropped(FixedStep *stepper) {
+    assert(stepper);
+    return stepper->dropped;
+}
+
+Vector fixed_step_point(FixedStep *stepper, size_t index, Vector point) {
+    assert(stepper);
+    Body *body = scene_get_body(stepper->scene, index);
+    if (index >= Pose_array_size(&stepper->previous)
+        || stepper->previous.data[index].body != body) {
+        return point;
+    }
+    Pose *before = &stepper->previous.data[index];
+    double alpha = fixed_step_alpha(stepper);
+    Vector centroid = body_get_centroid(body);
+    // Blend from the earlier pose towards the current one
+    Vector blended = vec_add(before->centroid,
+        vec_multiply(alpha, vec_subtract(centroid, before->centroid)));
+    double turn = (1 - alpha) * (before->angle - body_get_angle(body));
+    return vec_add(blended, vec_rotate(vec_subtract(point, centroid), turn));
+}
@@ -2,20 +2,60 @@
 #include "utils.h"
 #include "list.h"
 #include "collision.h"
+#include "quadtree.h"
+#include "neighbor_list.h"
+#include "particle_mesh.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+// bodies must stay the first member of both aux structs; aux_freer relies on it
 struct forceAux {
-    List* bodies;
+    BodyPtrArray bodies;
     double constant;    // G or K or gamma
 };
 
 struct collisionAux {
-    List* bodies;
+    BodyPtrArray bodies;
     CollisionHandler handler;
     void* info;
 };
 
+struct barnesHutAux {
+    Scene *scene;
+    double G;
+    double theta;
+    QuadTree *tree;
+    BodyPtrArray bodies;    // reused every tick to collect the participants
+};
+
+struct particleMeshAux {
+    Scene *scene;
+    double G;
+    ParticleMesh *mesh;
+    BodyPtrArray bodies;    // reused every tick to collect the participants
+};
+
+struct neighborAux {
+    Scene *scene;
+    NeighborList *list;
+    BodyPtrArray bodies;    // reused every tick to collect the participants
+    NeighborHandler handler;
+    void *info;
+    FreeFunc info_freer;
+};
+
+typedef struct {
+    double k;
+    double cutoff;
+} Repulsion;
+
+typedef struct {
+    CollisionHandler handler;
+    void *info;
+    FreeFunc info_freer;
+    VectorArray axes;   // each pair's collision axis this tick, or zero
+} NeighborCollision;
+
 struct elas {
     double elasticity;
 };
@@ -97,8 +137,8 @@ void applyDirectionalForce(Body* b1, Body* b2, double magnitude_force) {
 
 void addGravityForce(void *aux) {
     ForceAux* a = aux;
-    Body* b1 = list_get(a->bodies, 0);
-    Body* b2 = list_get(a->bodies, 1);
+    Body* b1 = BodyPtr_array_get(&a->bodies, 0);
+    Body* b2 = BodyPtr_array_get(&a->bodies, 1);
     // Don't apply gravity force if the two bodies are too close
     if (is_too_close(b1, b2)) {
         return;
@@ -110,10 +150,143 @@ void addGravityForce(void *aux) {
     applyDirectionalForce(b1, b2, mag_force);
 }
 
+static void barnes_hut_forces(
+    size_t start, size_t end, size_t thread, void *aux
+) {
+    BarnesHutAux *a = aux;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&a->bodies, i);
+        body_add_force(body, quadtree_force(a->tree, body, a->G, a->theta));
+    }
+}
+
+void addBarnesHutGravity(void *aux) {
+    BarnesHutAux *a = aux;
+    BodyPtr_array_clear(&a->bodies);
+    for (size_t i = 0; i < scene_bodies(a->scene); i++) {
+        Body *body = scene_get_body(a->scene, i);
+        // Walls and other immovable bodies would pull with infinite force
+        if (!body_is_removed(body) && body_get_mass(body) != INFINITY) {
+            BodyPtr_array_add(&a->bodies, body);
+        }
+    }
+    quadtree_build(a->tree, &a->bodies);
+    // Each body's force only reads the tree, so they can be found in parallel
+    parallel_for(scene_get_jobs(a->scene), BodyPtr_array_size(&a->bodies), 0, \
+        barnes_hut_forces, a);
+}
+
+/* Brings a neighbor force's list up to date with the scene's bodies */
+static void neighbor_refresh(NeighborAux *a) {
+    BodyPtr_array_clear(&a->bodies);
+    for (size_t i = 0; i < scene_bodies(a->scene); i++) {
+        Body *body = scene_get_body(a->scene, i);
+        if (!body_is_removed(body)) {
+            BodyPtr_array_add(&a->bodies, body);
+        }
+    }
+    neighbor_list_update(a->list, &a->bodies);
+}
+
+void addNeighborForce(void *aux) {
+    NeighborAux *a = aux;
+    neighbor_refresh(a);
+    double cutoff = neighbor_list_cutoff(a->list);
+    for (size_t i = 0; i < neighbor_list_pairs(a->list); i++) {
+        Body *b1;
+        Body *b2;
+        neighbor_list_get(a->list, i, &b1, &b2);
+        // An earlier pair's handler may have removed one of them
+        if (body_is_removed(b1) || body_is_removed(b2)) {
+            continue;
+        }
+        double distance = vec_distance(body_get_centroid(b1),
+            body_get_centroid(b2));
+        if (distance < cutoff) {
+            a->handler(b1, b2, distance, a->info);
+        }
+    }
+}
+
+static void neighbor_repulsion(
+    Body *body1, Body *body2, double distance, void *aux
+) {
+    Repulsion *r = aux;
+    if (distance == 0) {
+        return;
+    }
+    // A negative attraction pushes the bodies apart
+    applyDirectionalForce(body1, body2, -r->k * (r->cutoff - distance));
+}
+
+/* Tests a chunk of the neighbor pairs for collisions, recording the axes */
+static void detect_neighbor_collisions(
+    size_t start, size_t end, size_t thread, void *aux
+) {
+    NeighborAux *a = aux;
+    NeighborCollision *c = a->info;
+    double cutoff = neighbor_list_cutoff(a->list);
+    for (size_t i = start; i < end; i++) {
+        Body *b1;
+        Body *b2;
+        neighbor_list_get(a->list, i, &b1, &b2);
+        Vector axis = VEC_ZERO;
+        if (vec_distance(body_get_centroid(b1), body_get_centroid(b2)) < cutoff) {
+            axis = find_collision(body_get_shape(b1), body_get_shape(b2));
+        }
+        c->axes.data[i] = axis;
+    }
+}
+
+/*
+ * The ForceCreator for create_neighbor_collisions(). Finding collisions only
+ * reads the bodies, so it's split over the scene's job system; the handlers
+ * may change anything, so they run afterwards, in order, on this thread.
+ */
+static void addNeighborCollisions(void *aux) {
+    NeighborAux *a = aux;
+    NeighborCollision *c = a->info;
+    neighbor_refresh(a);
+    size_t pairs = neighbor_list_pairs(a->list);
+    Vector_array_clear(&c->axes);
+    Vector_array_reserve(&c->axes, pairs);
+    for (size_t i = 0; i < pairs; i++) {
+        Vector_array_add(&c->axes, VEC_ZERO);
+    }
+    parallel_for(scene_get_jobs(a->scene), pairs, 0, \
+        detect_neighbor_collisions, a);
+    for (size_t i = 0; i < pairs; i++) {
+        Vector axis = c->axes.data[i];
+        if (axis.x == 0 && axis.y == 0) {
+            continue;
+        }
+        Body *b1;
+        Body *b2;
+        neighbor_list_get(a->list, i, &b1, &b2);
+        // An earlier pair's handler may have removed one of them
+        if (!body_is_removed(b1) && !body_is_removed(b2)) {
+            c->handler(b1, b2, axis, c->info);
+        }
+    }
+}
+
+void addParticleMeshGravity(void *aux) {
+    ParticleMeshAux *a = aux;
+    BodyPtr_array_clear(&a->bodies);
+    for (size_t i = 0; i < scene_bodies(a->scene); i++) {
+        Body *body = scene_get_body(a->scene, i);
+        // Walls and other immovable bodies would pull with infinite force
+        if (!body_is_removed(body) && body_get_mass(body) != INFINITY) {
+            BodyPtr_array_add(&a->bodies, body);
+        }
+    }
+    particle_mesh_apply(a->mesh, &a->bodies, a->G);
+}
+
 void addSpringForce(void *aux) {
     ForceAux* a = aux;
-    Body* b1 = list_get(a->bodies, 0);
-    Body* b2 = list_get(a->bodies, 1);
+    Body* b1 = BodyPtr_array_get(&a->bodies, 0);
+    Body* b2 = BodyPtr_array_get(&a->bodies, 1);
     double distance = vec_distance(body_get_centroid(b1), body_get_centroid(b2));
     // F = -kx
     double mag_force = a->constant * distance;
@@ -123,7 +296,7 @@ void addSpringForce(void *aux) {
 
 void addDragForce(void *aux) {
     ForceAux* a = aux;
-    Body* body = list_get(a->bodies, 0);
+    Body* body = BodyPtr_array_get(&a->bodies, 0);
     // Drag should be proportional to velocity, and in the opposite direction
     Vector drag_force = vec_multiply(-(a->constant), body_get_velocity(body));
     body_add_force(body, drag_force);
@@ -132,8 +305,8 @@ void addDragForce(void *aux) {
 void addCollision(void *aux) {
     // Should check for collision
     CollisionAux* a = aux;
-    Body* b1 = list_get(a->bodies, 0);
-    Body* b2 = list_get(a->bodies, 1);
+    Body* b1 = BodyPtr_array_get(&a->bodies, 0);
+    Body* b2 = BodyPtr_array_get(&a->bodies, 1);
     Vector collision = find_collision(body_get_shape(b1), body_get_shape(b2));
     if (collision.x != 0 || collision.y != 0) {
         // If bodies are both collided previously, then do not apply again
@@ -153,37 +326,179 @@ void addCollision(void *aux) {
     }
 }
 
+/*
+ * A force that acts on an arena body can't outlive it, so its aux structs
+ * come from the same arena. Returns NULL if the bodies are all on the heap.
+ */
+static Arena *force_arena(Body *body1, Body *body2) {
+    Arena *arena = body_get_arena(body1);
+    if (!arena && body2) {
+        arena = body_get_arena(body2);
+    }
+    return arena;
+}
+
+static void *force_alloc(Arena *arena, size_t size) {
+    if (arena) {
+        return arena_alloc(arena, size);
+    }
+    void *aux = malloc(size);
+    assert(aux);
+    return aux;
+}
+
+static void force_bodies(
+    BodyPtrArray *bodies, Arena *arena, Body *body1, Body *body2
+) {
+    BodyPtr_array_init_arena(bodies, body2 ? 2 : 1, arena);
+    BodyPtr_array_add(bodies, body1);
+    if (body2) {
+        BodyPtr_array_add(bodies, body2);
+    }
+}
+
+static void create_constant_force(
+    Scene *scene, ForceCreator forcer, double constant, Body *body1, Body *body2
+) {
+    Arena *arena = force_arena(body1, body2);
+    ForceAux* aux = force_alloc(arena, sizeof(ForceAux));
+    aux->constant = constant;
+    force_bodies(&aux->bodies, arena, body1, body2);
+    // These only read their bodies and add forces, so they may run in parallel
+    scene_add_parallel_force_creator(scene, forcer, aux, \
+        &aux->bodies, arena ? NULL : aux_freer);
+}
+
 void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2)
 {
-    ForceAux* aux = malloc(sizeof(ForceAux));
+    create_constant_force(scene, addGravityForce, G, body1, body2);
+}
+
+static void barnes_hut_aux_freer(void *aux) {
+    BarnesHutAux *a = aux;
+    quadtree_free(a->tree);
+    BodyPtr_array_free(&a->bodies);
+    free(a);
+}
+
+void create_barnes_hut_gravity(Scene *scene, double G, double theta) {
+    assert(theta >= 0);
+    BarnesHutAux *aux = malloc(sizeof(BarnesHutAux));
     assert(aux);
-    aux->constant = G;
-    aux->bodies = list_init(2, body_free);
-    list_add(aux->bodies, body1);
-    list_add(aux->bodies, body2);
-    scene_add_bodies_force_creator(scene, addGravityForce, aux, \
-        aux->bodies, aux_freer);
+    aux->scene = scene;
+    aux->G = G;
+    aux->theta = theta;
+    aux->tree = quadtree_init();
+    BodyPtr_array_init(&aux->bodies, scene_bodies(scene));
+    // Not tied to any body, so removing bodies never removes this force
+    scene_add_body_array_force_creator(scene, addBarnesHutGravity, aux, \
+        NULL, barnes_hut_aux_freer);
 }
 
-void create_spring(Scene *scene, double k, Body *body1, Body *body2) {
-    ForceAux* aux = malloc(sizeof(ForceAux));
+static void particle_mesh_aux_freer(void *aux) {
+    ParticleMeshAux *a = aux;
+    particle_mesh_free(a->mesh);
+    BodyPtr_array_free(&a->bodies);
+    free(a);
+}
+
+void create_particle_mesh_gravity(Scene *scene, double G, size_t resolution) {
+    ParticleMeshAux *aux = malloc(sizeof(ParticleMeshAux));
     assert(aux);
-    aux->constant = k;
-    aux->bodies = list_init(2, body_free);
-    list_add(aux->bodies, body1);
-    list_add(aux->bodies, body2);
-    scene_add_bodies_force_creator(scene, addSpringForce, aux, \
-        aux->bodies, aux_freer);
+    aux->scene = scene;
+    aux->G = G;
+    aux->mesh = particle_mesh_init(resolution);
+    BodyPtr_array_init(&aux->bodies, scene_bodies(scene));
+    // Not tied to any body, so removing bodies never removes this force
+    scene_add_body_array_force_creator(scene, addParticleMeshGravity, aux, \
+        NULL, particle_mesh_aux_freer);
+}
+
+static void neighbor_aux_freer(void *aux) {
+    NeighborAux *a = aux;
+    if (a->info_freer) {
+        a->info_freer(a->info);
+    }
+    neighbor_list_free(a->list);
+    BodyPtr_array_free(&a->bodies);
+    free(a);
+}
+
+static NeighborAux *neighbor_aux_init(
+    Scene *scene, double cutoff, double skin, NeighborHandler handler,
+    void *aux, FreeFunc freer
+) {
+    NeighborAux *n_aux = malloc(sizeof(NeighborAux));
+    assert(n_aux);
+    n_aux->scene = scene;
+    n_aux->list = neighbor_list_init(cutoff, skin);
+    BodyPtr_array_init(&n_aux->bodies, scene_bodies(scene));
+    n_aux->handler = handler;
+    n_aux->info = aux;
+    n_aux->info_freer = freer;
+    return n_aux;
+}
+
+void create_neighbor_force(
+    Scene *scene,
+    double cutoff,
+    double skin,
+    NeighborHandler handler,
+    void *aux,
+    FreeFunc freer
+) {
+    NeighborAux *n_aux = neighbor_aux_init(scene, cutoff, skin, handler, \
+        aux, freer);
+    // Not tied to any body, so removing bodies never removes this force
+    scene_add_body_array_force_creator(scene, addNeighborForce, n_aux, \
+        NULL, neighbor_aux_freer);
+}
+
+void create_neighbor_repulsion(
+    Scene *scene, double k, double cutoff, double skin
+) {
+    Repulsion *r = malloc(sizeof(Repulsion));
+    assert(r);
+    r->k = k;
+    r->cutoff = cutoff;
+    create_neighbor_force(scene, cutoff, skin, neighbor_repulsion, r, free);
+}
+
+static void neighbor_collision_freer(void *aux) {
+    NeighborCollision *c = aux;
+    if (c->info_freer) {
+        c->info_freer(c->info);
+    }
+    Vector_array_free(&c->axes);
+    free(c);
+}
+
+void create_neighbor_collisions(
+    Scene *scene,
+    double cutoff,
+    double skin,
+    CollisionHandler handler,
+    void *aux,
+    FreeFunc freer
+) {
+    NeighborCollision *c = malloc(sizeof(NeighborCollision));
+    assert(c);
+    c->handler = handler;
+    c->info = aux;
+    c->info_freer = freer;
+    Vector_array_init(&c->axes, 0);
+    NeighborAux *n_aux = neighbor_aux_init(scene, cutoff, skin, NULL, c, \
+        neighbor_collision_freer);
+    scene_add_body_array_force_creator(scene, addNeighborCollisions, n_aux, \
+        NULL, neighbor_aux_freer);
+}
+
+void create_spring(Scene *scene, double k, Body *body1, Body *body2) {
+    create_constant_force(scene, addSpringForce, k, body1, body2);
 }
 
 void create_drag(Scene *scene, double gamma, Body *body) {
-    ForceAux* aux = malloc(sizeof(ForceAux));
-    assert(aux);
-    aux->constant = gamma;
-    aux->bodies = list_init(1, body_free);
-    list_add(aux->bodies, body);
-    scene_add_bodies_force_creator(scene, addDragForce, aux, \
-        aux->bodies, aux_freer);
+    create_constant_force(scene, addDragForce, gamma, body, NULL);
 }
 
 void create_collision(
@@ -194,38 +509,34 @@ void create_collision(
     void *aux,
     FreeFunc freer
 ) {
-    CollisionAux* c_aux = malloc(sizeof(CollisionAux));
-    assert(c_aux);
+    Arena *arena = force_arena(body1, body2);
+    CollisionAux* c_aux = force_alloc(arena, sizeof(CollisionAux));
     c_aux->handler = handler;
     c_aux->info = aux;
-    c_aux->bodies = list_init(2, body_free);
-    list_add(c_aux->bodies, body1);
-    list_add(c_aux->bodies, body2);
-    scene_add_bodies_force_creator(scene, addCollision, c_aux, \
-        c_aux->bodies, freer);
+    force_bodies(&c_aux->bodies, arena, body1, body2);
+    scene_add_body_array_force_creator(scene, addCollision, c_aux, \
+        &c_aux->bodies, arena ? NULL : freer);
 }
 
 void create_physics_collision(
     Scene *scene, double elasticity, Body *body1, Body *body2
 ) {
-    Elas *e = malloc(sizeof(Elas));
-    assert(e);
+    Arena *arena = force_arena(body1, body2);
+    Elas *e = force_alloc(arena, sizeof(Elas));
     e->elasticity = elasticity;
     create_collision(scene, body1, body2, handlePhysicsCollision, e, aux_freer);
 }
 
 void create_destructive_collision(Scene *scene, Body *body1, Body *body2) {
-    CollisionAux* aux = malloc(sizeof(CollisionAux));
-    assert(aux);
+    Arena *arena = force_arena(body1, body2);
+    CollisionAux* aux = force_alloc(arena, sizeof(CollisionAux));
     aux->handler = handleDestructiveCollision;
-    aux->bodies = list_init(2, body_free);
-    list_add(aux->bodies, body1);
-    list_add(aux->bodies, body2);
+    force_bodies(&aux->bodies, arena, body1, body2);
     create_collision(scene, body1, body2, handleDestructiveCollision, aux, aux_freer);
 }
 
 void aux_freer(void *a) {
     ForceAux *aux = a;
-    free(aux->bodies);
+    BodyPtr_array_free(&aux->bodies);
     free(aux);
 }
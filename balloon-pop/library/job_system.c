@@ -0,0 +1,304 @@
+#include "job_system.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define INITIAL_DEQUE_CAPACITY 64
+// parallel_for() with no grain gives each thread about this many chunks
+#define CHUNKS_PER_THREAD 4
+
+typedef struct {
+    JobFunc func;
+    void *aux;
+} Job;
+
+/*
+ * A ring buffer of jobs. The owning thread pushes and pops at the tail,
+ * so it works on its newest (cache-warm) jobs first; thieves take from
+ * the head, where the oldest and usually largest jobs are.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    Job *items;
+    size_t head;
+    size_t size;
+    size_t capacity;
+} Deque;
+
+typedef struct {
+    JobSystem *jobs;
+    size_t thread;
+} Worker;
+
+struct job_system {
+    size_t threads;         // worker threads + the thread that created it
+    Deque *deques;          // one per thread
+    pthread_t *handles;     // one per worker thread
+    Worker *workers;
+    atomic_size_t queued;   // jobs sitting in deques
+    atomic_size_t pending;  // jobs submitted but not finished
+    atomic_bool stopping;
+    // Idle workers sleep on wake; job_system_wait() sleeps on done
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+};
+
+// Which job system, if any, the current thread works for, and as which thread
+static _Thread_local JobSystem *current_jobs = NULL;
+static _Thread_local size_t current_thread = 0;
+
+static void deque_init(Deque *deque) {
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->items = malloc(INITIAL_DEQUE_CAPACITY * sizeof(Job));
+    assert(deque->items);
+    deque->head = 0;
+    deque->size = 0;
+    deque->capacity = INITIAL_DEQUE_CAPACITY;
+}
+
+static void deque_free(Deque *deque) {
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->items);
+}
+
+static void deque_push(Deque *deque, Job job) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->size == deque->capacity) {
+        // Unroll the ring into a buffer twice the size
+        Job *items = malloc(2 * deque->capacity * sizeof(Job));
+        assert(items);
+        for (size_t i = 0; i < deque->size; i++) {
+            items[i] = deque->items[(deque->head + i) % deque->capacity];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->items[(deque->head + deque->size) % deque->capacity] = job;
+    deque->size++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/* Takes the newest job if newest, else the oldest. Returns false if empty. */
+static bool deque_take(Deque *deque, bool newest, Job *job) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->size > 0;
+    if (found) {
+        if (newest) {
+            *job = deque->items[(deque->head + deque->size - 1) % deque->capacity];
+        } else {
+            *job = deque->items[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        deque->size--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/* Runs one job from this thread's deque, or one stolen from another */
+static bool run_one(JobSystem *jobs, size_t thread) {
+    Job job;
+    bool found = deque_take(&jobs->deques[thread], true, &job);
+    for (size_t i = 1; !found && i < jobs->threads; i++) {
+        found = deque_take(&jobs->deques[(thread + i) % jobs->threads],
+            false, &job);
+    }
+    if (!found) {
+        return false;
+    }
+    atomic_fetch_sub(&jobs->queued, 1);
+    job.func(job.aux);
+    if (atomic_fetch_sub(&jobs->pending, 1) == 1) {
+        pthread_mutex_lock(&jobs->lock);
+        pthread_cond_broadcast(&jobs->done);
+        pthread_mutex_unlock(&jobs->lock);
+    }
+    return true;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    JobSystem *jobs = worker->jobs;
+    current_jobs = jobs;
+    current_thread = worker->thread;
+    while (true) {
+        if (run_one(jobs, worker->thread)) {
+            continue;
+        }
+        pthread_mutex_lock(&jobs->lock);
+        while (!atomic_load(&jobs->stopping) && atomic_load(&jobs->queued) == 0) {
+            pthread_cond_wait(&jobs->wake, &jobs->lock);
+        }
+        bool stopping = atomic_load(&jobs->stopping);
+        pthread_mutex_unlock(&jobs->lock);
+        if (stopping) {
+            return NULL;
+        }
+    }
+}
+
+JobSystem *job_system_init(size_t workers) {
+    if (workers == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = processors > 1 ? (size_t) processors - 1 : 0;
+    }
+    JobSystem *jobs = malloc(sizeof(JobSystem));
+    assert(jobs);
+    jobs->threads = workers + 1;
+    jobs->deques = malloc(jobs->threads * sizeof(Deque));
+    assert(jobs->deques);
+    for (size_t i = 0; i < jobs->threads; i++) {
+        deque_init(&jobs->deques[i]);
+    }
+    atomic_init(&jobs->queued, 0);
+    atomic_init(&jobs->pending, 0);
+    atomic_init(&jobs->stopping, false);
+    pthread_mutex_init(&jobs->lock, NULL);
+    pthread_cond_init(&jobs->wake, NULL);
+    pthread_cond_init(&jobs->done, NULL);
+
+    jobs->handles = malloc(workers * sizeof(pthread_t));
+    jobs->workers = malloc(workers * sizeof(Worker));
+    assert(workers == 0 || (jobs->handles && jobs->workers));
+    // The creating thread is thread 0, so it can submit and help
+    current_jobs = jobs;
+    current_thread = 0;
+    for (size_t i = 0; i < workers; i++) {
+        jobs->workers[i] = (Worker) {jobs, i + 1};
+        int error = pthread_create(&jobs->handles[i], NULL, worker_main,
+            &jobs->workers[i]);
+        assert(error == 0);
+    }
+    return jobs;
+}
+
+void job_system_free(JobSystem *jobs) {
+    assert(jobs);
+    job_system_wait(jobs);
+    pthread_mutex_lock(&jobs->lock);
+    atomic_store(&jobs->stopping, true);
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+    for (size_t i = 0; i + 1 < jobs->threads; i++) {
+        pthread_join(jobs->handles[i], NULL);
+    }
+    for (size_t i = 0; i < jobs->threads; i++) {
+        deque_free(&jobs->deques[i]);
+    }
+    pthread_mutex_destroy(&jobs->lock);
+    pthread_cond_destroy(&jobs->wake);
+    pthread_cond_destroy(&jobs->done);
+    if (current_jobs == jobs) {
+        current_jobs = NULL;
+    }
+    free(jobs->deques);
+    free(jobs->handles);
+    free(jobs->workers);
+    free(jobs);
+}
+
+size_t job_system_threads(JobSystem *jobs) {
+    assert(jobs);
+    return jobs->threads;
+}
+
+size_t job_system_thread(JobSystem *jobs) {
+    assert(jobs);
+    return current_jobs == jobs ? current_thread : 0;
+}
+
+void job_system_submit(JobSystem *jobs, JobFunc func, void *aux) {
+    assert(jobs);
+    assert(func);
+    atomic_fetch_add(&jobs->pending, 1);
+    deque_push(&jobs->deques[job_system_thread(jobs)], (Job) {func, aux});
+    atomic_fetch_add(&jobs->queued, 1);
+    // Taking the lock orders this with a worker checking queued before sleeping
+    pthread_mutex_lock(&jobs->lock);
+    pthread_cond_signal(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+}
+
+void job_system_wait(JobSystem *jobs) {
+    assert(jobs);
+    size_t thread = job_system_thread(jobs);
+    while (atomic_load(&jobs->pending) > 0) {
+        if (run_one(jobs, thread)) {
+            continue;
+        }
+        // Everything left is already running on other threads
+        pthread_mutex_lock(&jobs->lock);
+        while (atomic_load(&jobs->pending) > 0 && atomic_load(&jobs->queued) == 0) {
+            pthread_cond_wait(&jobs->done, &jobs->lock);
+        }
+        pthread_mutex_unlock(&jobs->lock);
+    }
+}
+
+typedef struct {
+    RangeFunc func;
+    void *aux;
+    JobSystem *jobs;
+    atomic_size_t *remaining;
+    size_t start;
+    size_t end;
+} Chunk;
+
+static void run_chunk(void *aux) {
+    Chunk *chunk = aux;
+    chunk->func(chunk->start, chunk->end, job_system_thread(chunk->jobs),
+        chunk->aux);
+    atomic_fetch_sub(chunk->remaining, 1);
+}
+
+void parallel_for(
+    JobSystem *jobs, size_t count, size_t grain, RangeFunc func, void *aux
+) {
+    assert(func);
+    if (count == 0) {
+        return;
+    }
+    if (!jobs || jobs->threads == 1) {
+        func(0, count, 0, aux);
+        return;
+    }
+    if (grain == 0) {
+        grain = count / (CHUNKS_PER_THREAD * jobs->threads);
+        grain = grain > 0 ? grain : 1;
+    }
+    size_t chunks = (count + grain - 1) / grain;
+    if (chunks == 1) {
+        func(0, count, job_system_thread(jobs), aux);
+        return;
+    }
+    Chunk *items = malloc(chunks * sizeof(Chunk));
+    assert(items);
+    atomic_size_t remaining;
+    atomic_init(&remaining, chunks);
+    for (size_t i = 0; i < chunks; i++) {
+        size_t end = (i + 1) * grain;
+        items[i] = (Chunk) {
+            .func = func,
+            .aux = aux,
+            .jobs = jobs,
+            .remaining = &remaining,
+            .start = i * grain,
+            .end = end < count ? end : count
+        };
+        job_system_submit(jobs, run_chunk, &items[i]);
+    }
+    // Only wait for this loop's chunks, so loops can nest inside jobs
+    size_t thread = job_system_thread(jobs);
+    while (atomic_load(&remaining) > 0) {
+        if (!run_one(jobs, thread)) {
+            sched_yield();
+        }
+    }
+    free(items);
+}
@@ -9,6 +9,7 @@ struct list {
     size_t size_capacity;
     size_t current_size;
     FreeFunc free;
+    Arena *arena;
 };
 
 List *list_init(size_t initial_size, FreeFunc freer) {
@@ -22,15 +23,41 @@ List *list_init(size_t initial_size, FreeFunc freer) {
     list->size_capacity = initial_size;
     list->current_size = 0;
     list->free = freer;
+    list->arena = NULL;
 
     return list;
 }
 
+List *list_init_arena(size_t initial_size, FreeFunc freer, Arena *arena) {
+    if (!arena) {
+        return list_init(initial_size, freer);
+    }
+    List *list = arena_alloc(arena, sizeof(List));
+    list->list_items = initial_size > 0
+        ? arena_alloc(arena, initial_size * sizeof(void *))
+        : NULL;
+    list->size_capacity = initial_size;
+    list->current_size = 0;
+    // Elements live in the arena too, so they are never freed one by one
+    list->free = NULL;
+    list->arena = arena;
+    return list;
+}
+
+Arena *list_get_arena(List *list) {
+    assert(list);
+    return list->arena;
+}
+
 void list_free(List *list) {
     assert(list);
+    // Arena lists are reclaimed all at once by arena_reset()
+    if (list->arena) {
+        return;
+    }
 
     if (list->current_size > 0) {
-        for (size_t i = 0; i < list->current_size; i++) {
+        for (size_t i = 0; list->free && i < list->current_size; i++) {
             (list->free)(list->list_items[i]);
         }
 
@@ -62,14 +89,18 @@ void list_remove(List *list, size_t index) {
     }
 
     list->current_size--;
-    (list->free)(to_remove);
+    if (list->free) {
+        (list->free)(to_remove);
+    }
 }
 
 void list_set(List *list, size_t index, void *value) {
     assert(list);
     assert(index >=0 && index < list->current_size);
     // Free previously set item
-    list->free(list->list_items[index]);
+    if (list->free) {
+        list->free(list->list_items[index]);
+    }
     list->list_items[index] = value;
 }
 
@@ -78,8 +109,18 @@ void list_add(List* list, void* value) {
     size_t current_capacity = list->size_capacity;
     size_t current_size = list->current_size;
 
+    // Arena lists cannot realloc, so they copy into a new block twice the size
+    if (list->arena && current_capacity == current_size) {
+        size_t new_capacity = current_capacity > 0 ? 2 * current_capacity : 1;
+        void **new = arena_alloc(list->arena, sizeof(void*) * new_capacity);
+        if (current_size > 0) {
+            memcpy(new, list->list_items, sizeof(void*) * current_size);
+        }
+        list->list_items = new;
+        list->size_capacity = new_capacity;
+    }
     // If adding the first item, then simply malloc enough space for 1
-    if (current_capacity == 0) {
+    else if (current_capacity == 0) {
             list->list_items = malloc(sizeof(void*));
             assert(list->list_items);
             list->size_capacity++;
@@ -0,0 +1,232 @@
+#include "neighbor_list.h"
+#include "array.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Caps the grid at this many cells per body, however spread out they are
+#define CELLS_PER_BODY 4
+#define MIN_CELLS 16
+
+typedef struct {
+    size_t body1;
+    size_t body2;
+} NeighborPair;
+
+DEFINE_ARRAY(NeighborPair)
+DEFINE_ARRAY(size_t)
+
+struct neighbor_list {
+    double cutoff;
+    double skin;
+    bool built;
+    size_t rebuilds;
+    // The bodies and their centroids as of the last rebuild
+    BodyPtrArray bodies;
+    VectorArray positions;
+    NeighborPairArray pairs;
+    // Grid scratch: the bodies in cell c are cell_items[cell_start[c]...]
+    size_tArray cell_start;
+    size_tArray cell_next;
+    size_tArray cell_items;
+};
+
+NeighborList *neighbor_list_init(double cutoff, double skin) {
+    assert(cutoff > 0);
+    assert(skin >= 0);
+    NeighborList *list = malloc(sizeof(NeighborList));
+    assert(list);
+    list->cutoff = cutoff;
+    list->skin = skin;
+    list->built = false;
+    list->rebuilds = 0;
+    BodyPtr_array_init(&list->bodies, 0);
+    Vector_array_init(&list->positions, 0);
+    NeighborPair_array_init(&list->pairs, 0);
+    size_t_array_init(&list->cell_start, 0);
+    size_t_array_init(&list->cell_next, 0);
+    size_t_array_init(&list->cell_items, 0);
+    return list;
+}
+
+void neighbor_list_free(NeighborList *list) {
+    assert(list);
+    BodyPtr_array_free(&list->bodies);
+    Vector_array_free(&list->positions);
+    NeighborPair_array_free(&list->pairs);
+    size_t_array_free(&list->cell_start);
+    size_t_array_free(&list->cell_next);
+    size_t_array_free(&list->cell_items);
+    free(list);
+}
+
+size_t neighbor_list_pairs(NeighborList *list) {
+    assert(list);
+    return NeighborPair_array_size(&list->pairs);
+}
+
+void neighbor_list_get(
+    NeighborList *list, size_t index, Body **body1, Body **body2
+) {
+    assert(list);
+    NeighborPair pair = NeighborPair_array_get(&list->pairs, index);
+    *body1 = BodyPtr_array_get(&list->bodies, pair.body1);
+    *body2 = BodyPtr_array_get(&list->bodies, pair.body2);
+}
+
+size_t neighbor_list_rebuilds(NeighborList *list) {
+    assert(list);
+    return list->rebuilds;
+}
+
+double neighbor_list_cutoff(NeighborList *list) {
+    assert(list);
+    return list->cutoff;
+}
+
+static bool neighbor_list_stale(NeighborList *list, const BodyPtrArray *bodies) {
+    size_t n = BodyPtr_array_size(bodies);
+    if (!list->built || n != BodyPtr_array_size(&list->bodies)) {
+        return true;
+    }
+    double limit = list->skin / 2;
+    for (size_t i = 0; i < n; i++) {
+        Body *body = bodies->data[i];
+        if (body != list->bodies.data[i]) {
+            return true;
+        }
+        Vector moved = vec_subtract(body_get_centroid(body),
+            list->positions.data[i]);
+        if (vec_dot(moved, moved) > limit * limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Adds every pair between body i and the bodies in a cell, if close enough */
+static void check_cell(
+    NeighborList *list, size_t i, size_t cell, bool same_cell, double range
+) {
+    Vector position = list->positions.data[i];
+    size_t start = list->cell_start.data[cell];
+    size_t end = list->cell_start.data[cell + 1];
+    for (size_t k = start; k < end; k++) {
+        size_t j = list->cell_items.data[k];
+        // Within a cell, bodies are in index order; only count each pair once
+        if (same_cell && j <= i) {
+            continue;
+        }
+        Vector d = vec_subtract(list->positions.data[j], position);
+        if (vec_dot(d, d) < range * range) {
+            NeighborPair pair = {i, j};
+            NeighborPair_array_add(&list->pairs, pair);
+        }
+    }
+}
+
+static void neighbor_list_rebuild(NeighborList *list, const BodyPtrArray *bodies) {
+    size_t n = BodyPtr_array_size(bodies);
+    BodyPtr_array_clear(&list->bodies);
+    Vector_array_clear(&list->positions);
+    NeighborPair_array_clear(&list->pairs);
+    list->built = true;
+    list->rebuilds++;
+    if (n == 0) {
+        return;
+    }
+    BodyPtr_array_reserve(&list->bodies, n);
+    Vector_array_reserve(&list->positions, n);
+    Vector min = body_get_centroid(bodies->data[0]);
+    Vector max = min;
+    for (size_t i = 0; i < n; i++) {
+        Body *body = bodies->data[i];
+        Vector position = body_get_centroid(body);
+        BodyPtr_array_add(&list->bodies, body);
+        Vector_array_add(&list->positions, position);
+        min.x = fmin(min.x, position.x);
+        min.y = fmin(min.y, position.y);
+        max.x = fmax(max.x, position.x);
+        max.y = fmax(max.y, position.y);
+    }
+
+    // Cells at least as wide as the range, so neighbors are in adjacent cells
+    double range = list->cutoff + list->skin;
+    double cell_size = range;
+    double max_cells = (double) (CELLS_PER_BODY * n + MIN_CELLS);
+    double columns = floor((max.x - min.x) / cell_size) + 1;
+    double rows = floor((max.y - min.y) / cell_size) + 1;
+    while (columns * rows > max_cells) {
+        cell_size *= 2;
+        columns = floor((max.x - min.x) / cell_size) + 1;
+        rows = floor((max.y - min.y) / cell_size) + 1;
+    }
+    size_t nx = (size_t) columns;
+    size_t cells = nx * (size_t) rows;
+
+    // Counting sort of the bodies into cells
+    size_t_array_clear(&list->cell_start);
+    size_t_array_clear(&list->cell_next);
+    size_t_array_clear(&list->cell_items);
+    for (size_t c = 0; c <= cells; c++) {
+        size_t_array_add(&list->cell_start, 0);
+    }
+    size_t_array_reserve(&list->cell_items, n);
+    for (size_t i = 0; i < n; i++) {
+        Vector offset = vec_subtract(list->positions.data[i], min);
+        size_t cell = (size_t) (offset.x / cell_size)
+            + nx * (size_t) (offset.y / cell_size);
+        list->cell_start.data[cell + 1]++;
+        size_t_array_add(&list->cell_items, cell);
+    }
+    for (size_t c = 0; c < cells; c++) {
+        list->cell_start.data[c + 1] += list->cell_start.data[c];
+    }
+    size_t_array_add_all(&list->cell_next, list->cell_start.data, cells);
+    for (size_t i = 0; i < n; i++) {
+        // cell_items held each body's cell; overwrite it in place, in order
+        size_t cell = list->cell_items.data[i];
+        list->cell_items.data[i] = list->cell_next.data[cell]++;
+    }
+    // Now cell_items[i] is where body i goes; invert that permutation
+    size_t_array_clear(&list->cell_next);
+    size_t_array_add_all(&list->cell_next, list->cell_items.data, n);
+    for (size_t i = 0; i < n; i++) {
+        list->cell_items.data[list->cell_next.data[i]] = i;
+    }
+
+    // Each cell checks itself and the four neighbors ahead of it
+    size_t ny = cells / nx;
+    for (size_t cy = 0; cy < ny; cy++) {
+        for (size_t cx = 0; cx < nx; cx++) {
+            size_t cell = cx + nx * cy;
+            for (size_t k = list->cell_start.data[cell];
+                k < list->cell_start.data[cell + 1]; k++) {
+                size_t i = list->cell_items.data[k];
+                check_cell(list, i, cell, true, range);
+                if (cx + 1 < nx) {
+                    check_cell(list, i, cell + 1, false, range);
+                }
+                if (cy + 1 < ny) {
+                    if (cx > 0) {
+                        check_cell(list, i, cell + nx - 1, false, range);
+                    }
+                    check_cell(list, i, cell + nx, false, range);
+                    if (cx + 1 < nx) {
+                        check_cell(list, i, cell + nx + 1, false, range);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool neighbor_list_update(NeighborList *list, const BodyPtrArray *bodies) {
+    assert(list);
+    assert(bodies);
+    if (!neighbor_list_stale(list, bodies)) {
+        return false;
+    }
+    neighbor_list_rebuild(list, bodies);
+    return true;
+}
@@ -0,0 +1,267 @@
+#include "particle_mesh.h"
+#include "det_math.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_RESOLUTION 4
+
+struct particle_mesh {
+    size_t resolution;  // grid points along each side of the grid
+    size_t padded;      // twice that, so the convolution doesn't wrap around
+    // padded * padded complex working grid, row major (rows are y)
+    double *re;
+    double *im;
+    // Transform of the potential of a unit mass, in units of grid cells
+    double *kernel_re;
+    double *kernel_im;
+    double kernel_spacing;  // the cell size the kernel was made for
+    // cos and sin of 2 pi k / padded, for k < padded / 2
+    double *cos_table;
+    double *sin_table;
+    // resolution * resolution gravitational field, per unit mass
+    double *field_x;
+    double *field_y;
+};
+
+static double *grid_alloc(size_t count) {
+    double *grid = calloc(count, sizeof(double));
+    assert(grid);
+    return grid;
+}
+
+/*
+ * In-place iterative radix-2 FFT of padded values, spaced stride apart.
+ * The inverse transform is not scaled by 1 / padded.
+ */
+static void fft(
+    ParticleMesh *mesh, double *re, double *im, size_t stride, bool inverse
+) {
+    size_t n = mesh->padded;
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i * stride];
+            re[i * stride] = re[j * stride];
+            re[j * stride] = t;
+            t = im[i * stride];
+            im[i * stride] = im[j * stride];
+            im[j * stride] = t;
+        }
+    }
+    // Butterflies, doubling the transform length each pass
+    for (size_t length = 2; length <= n; length <<= 1) {
+        size_t half = length / 2;
+        size_t step = n / length;
+        for (size_t start = 0; start < n; start += length) {
+            for (size_t k = 0; k < half; k++) {
+                double w_re = mesh->cos_table[k * step];
+                double w_im = inverse ? mesh->sin_table[k * step]
+                    : -mesh->sin_table[k * step];
+                size_t a = (start + k) * stride;
+                size_t b = (start + k + half) * stride;
+                double t_re = w_re * re[b] - w_im * im[b];
+                double t_im = w_re * im[b] + w_im * re[b];
+                re[b] = re[a] - t_re;
+                im[b] = im[a] - t_im;
+                re[a] += t_re;
+                im[a] += t_im;
+            }
+        }
+    }
+}
+
+/* 2D FFT of a padded * padded grid: every row, then every column */
+static void fft_2d(ParticleMesh *mesh, double *re, double *im, bool inverse) {
+    size_t n = mesh->padded;
+    for (size_t row = 0; row < n; row++) {
+        fft(mesh, re + row * n, im + row * n, 1, inverse);
+    }
+    for (size_t column = 0; column < n; column++) {
+        fft(mesh, re + column, im + column, n, inverse);
+    }
+}
+
+/*
+ * Makes the kernel: the potential -1 / r of a unit mass, in cells,
+ * with displacements past the middle of the padded grid standing for
+ * negative ones. As in is_too_close(), pairs closer than CLOSENESS
+ * don't pull, so the potential is flat inside that distance.
+ */
+static void make_kernel(ParticleMesh *mesh, double spacing) {
+    size_t n = mesh->padded;
+    double closest = CLOSENESS / spacing;
+    for (size_t row = 0; row < n; row++) {
+        double dy = row < mesh->resolution ? (double) row : (double) row - n;
+        for (size_t column = 0; column < n; column++) {
+            double dx = column < mesh->resolution
+                ? (double) column : (double) column - n;
+            double r = sqrt(dx * dx + dy * dy);
+            mesh->kernel_re[row * n + column] = -1 / fmax(r, closest);
+            mesh->kernel_im[row * n + column] = 0;
+        }
+    }
+    fft_2d(mesh, mesh->kernel_re, mesh->kernel_im, false);
+    mesh->kernel_spacing = spacing;
+}
+
+ParticleMesh *particle_mesh_init(size_t resolution) {
+    assert(resolution >= MIN_RESOLUTION);
+    assert((resolution & (resolution - 1)) == 0);
+    ParticleMesh *mesh = malloc(sizeof(ParticleMesh));
+    assert(mesh);
+    size_t n = 2 * resolution;
+    mesh->resolution = resolution;
+    mesh->padded = n;
+    mesh->re = grid_alloc(n * n);
+    mesh->im = grid_alloc(n * n);
+    mesh->kernel_re = grid_alloc(n * n);
+    mesh->kernel_im = grid_alloc(n * n);
+    mesh->cos_table = grid_alloc(n / 2);
+    mesh->sin_table = grid_alloc(n / 2);
+    mesh->field_x = grid_alloc(resolution * resolution);
+    mesh->field_y = grid_alloc(resolution * resolution);
+    for (size_t k = 0; k < n / 2; k++) {
+        mesh->cos_table[k] = math_cos(2 * M_PI * k / n);
+        mesh->sin_table[k] = math_sin(2 * M_PI * k / n);
+    }
+    mesh->kernel_spacing = 0;
+    return mesh;
+}
+
+void particle_mesh_free(ParticleMesh *mesh) {
+    assert(mesh);
+    free(mesh->re);
+    free(mesh->im);
+    free(mesh->kernel_re);
+    free(mesh->kernel_im);
+    free(mesh->cos_table);
+    free(mesh->sin_table);
+    free(mesh->field_x);
+    free(mesh->field_y);
+    free(mesh);
+}
+
+size_t particle_mesh_resolution(ParticleMesh *mesh) {
+    assert(mesh);
+    return mesh->resolution;
+}
+
+/*
+ * The cloud-in-cell stencil of a point: the grid point at its bottom-left
+ * and how far past it the point is, as fractions of a cell.
+ */
+static void cell_of(
+    ParticleMesh *mesh, Vector point, Vector min, double spacing,
+    size_t *column, size_t *row, Vector *fraction
+) {
+    double u = (point.x - min.x) / spacing;
+    double v = (point.y - min.y) / spacing;
+    // The grid spans the bodies with a point to spare, but guard rounding
+    size_t last = mesh->resolution - 2;
+    *column = u < last ? (size_t) u : last;
+    *row = v < last ? (size_t) v : last;
+    fraction->x = u - *column;
+    fraction->y = v - *row;
+}
+
+void particle_mesh_apply(
+    ParticleMesh *mesh, const BodyPtrArray *bodies, double G
+) {
+    assert(mesh);
+    assert(bodies);
+    size_t count = BodyPtr_array_size(bodies);
+    if (count == 0) {
+        return;
+    }
+    size_t res = mesh->resolution;
+    size_t n = mesh->padded;
+
+    // Fit the grid to the bodies
+    Vector min = body_get_centroid(bodies->data[0]);
+    Vector max = min;
+    for (size_t i = 1; i < count; i++) {
+        Vector position = body_get_centroid(bodies->data[i]);
+        min.x = fmin(min.x, position.x);
+        min.y = fmin(min.y, position.y);
+        max.x = fmax(max.x, position.x);
+        max.y = fmax(max.y, position.y);
+    }
+    double extent = fmax(max.x - min.x, max.y - min.y);
+    double spacing = extent > 0 ? extent / (res - 2) : 1;
+
+    // Spread each mass over the four grid points around it
+    memset(mesh->re, 0, n * n * sizeof(double));
+    memset(mesh->im, 0, n * n * sizeof(double));
+    for (size_t i = 0; i < count; i++) {
+        Body *body = bodies->data[i];
+        double mass = body_get_mass(body);
+        assert(mass != INFINITY);
+        size_t column, row;
+        Vector f;
+        cell_of(mesh, body_get_centroid(body), min, spacing, &column, &row, &f);
+        double *cell = mesh->re + row * n + column;
+        cell[0] += mass * (1 - f.x) * (1 - f.y);
+        cell[1] += mass * f.x * (1 - f.y);
+        cell[n] += mass * (1 - f.x) * f.y;
+        cell[n + 1] += mass * f.x * f.y;
+    }
+
+    // Convolve the masses with the potential of a point mass
+    if (spacing != mesh->kernel_spacing) {
+        make_kernel(mesh, spacing);
+    }
+    fft_2d(mesh, mesh->re, mesh->im, false);
+    for (size_t k = 0; k < n * n; k++) {
+        double a_re = mesh->re[k];
+        double a_im = mesh->im[k];
+        mesh->re[k] = a_re * mesh->kernel_re[k] - a_im * mesh->kernel_im[k];
+        mesh->im[k] = a_re * mesh->kernel_im[k] + a_im * mesh->kernel_re[k];
+    }
+    fft_2d(mesh, mesh->re, mesh->im, true);
+    // The kernel is in cells, and the inverse transform is unscaled
+    double scale = G / (spacing * n * n);
+    double *potential = mesh->re;
+
+    // The field is minus the gradient of the potential, by central differences.
+    // Index n - 1 is the point just before 0, which the padding covers.
+    for (size_t row = 0; row < res; row++) {
+        size_t below = (row + n - 1) % n;
+        for (size_t column = 0; column < res; column++) {
+            size_t left = (column + n - 1) % n;
+            double dx = potential[row * n + column + 1]
+                - potential[row * n + left];
+            double dy = potential[(row + 1) * n + column]
+                - potential[below * n + column];
+            mesh->field_x[row * res + column] = -scale * dx / (2 * spacing);
+            mesh->field_y[row * res + column] = -scale * dy / (2 * spacing);
+        }
+    }
+
+    // Gather the field back with the same weights the masses were spread with
+    for (size_t i = 0; i < count; i++) {
+        Body *body = bodies->data[i];
+        size_t column, row;
+        Vector f;
+        cell_of(mesh, body_get_centroid(body), min, spacing, &column, &row, &f);
+        size_t k = row * res + column;
+        double w00 = (1 - f.x) * (1 - f.y);
+        double w10 = f.x * (1 - f.y);
+        double w01 = (1 - f.x) * f.y;
+        double w11 = f.x * f.y;
+        Vector field = {
+            w00 * mesh->field_x[k] + w10 * mesh->field_x[k + 1]
+                + w01 * mesh->field_x[k + res] + w11 * mesh->field_x[k + res + 1],
+            w00 * mesh->field_y[k] + w10 * mesh->field_y[k + 1]
+                + w01 * mesh->field_y[k + res] + w11 * mesh->field_y[k + res + 1]
+        };
+        body_add_force(body, vec_multiply(body_get_mass(body), field));
+    }
+}
@@ -1,6 +1,7 @@
 #include "polygon.h"
 #include "vector.h"
 #include "list.h"
+#include "det_math.h"
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -59,8 +60,8 @@ void polygon_rotate(List *polygon, double angle, Vector point) {
     double n_x = ((Vector*)list_get(polygon, i))->x;
     double n_y = ((Vector*)list_get(polygon, i))->y;
     /* Updating the polygon vectors */
-    double new_x = cos(angle) * (n_x - x) - sin(angle) * (n_y - y) + x;
-    double new_y = cos(angle) * (n_y - y) + sin(angle) * (n_x - x) + y;
+    double new_x = math_cos(angle) * (n_x - x) - math_sin(angle) * (n_y - y) + x;
+    double new_y = math_cos(angle) * (n_y - y) + math_sin(angle) * (n_x - x) + y;
     list_set(polygon, i, create_vector_p((Vector){new_x, new_y}));
   }
 }
@@ -0,0 +1,206 @@
+#include "quadtree.h"
+#include "array.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Bodies at (nearly) the same point would otherwise split forever
+#define MAX_DEPTH 32
+#define NO_CHILD ((size_t) -1)
+
+typedef struct {
+    Vector min;         // bottom-left corner of the square cell
+    double size;        // side length of the cell
+    Vector center_of_mass;
+    double mass;
+    Body *body;         // the only body in a leaf, or NULL
+    size_t children[4]; // indices into the node array, NO_CHILD if empty
+    bool leaf;
+} QuadNode;
+
+DEFINE_ARRAY(QuadNode)
+
+struct quadtree {
+    // Nodes refer to each other by index, since adding one may move the rest
+    QuadNodeArray nodes;
+};
+
+QuadTree *quadtree_init(void) {
+    QuadTree *tree = malloc(sizeof(QuadTree));
+    assert(tree);
+    QuadNode_array_init(&tree->nodes, 0);
+    return tree;
+}
+
+void quadtree_free(QuadTree *tree) {
+    assert(tree);
+    QuadNode_array_free(&tree->nodes);
+    free(tree);
+}
+
+size_t quadtree_nodes(QuadTree *tree) {
+    assert(tree);
+    return QuadNode_array_size(&tree->nodes);
+}
+
+static size_t node_add(QuadTree *tree, Vector min, double size) {
+    QuadNode node = {
+        .min = min,
+        .size = size,
+        .center_of_mass = VEC_ZERO,
+        .mass = 0,
+        .body = NULL,
+        .children = {NO_CHILD, NO_CHILD, NO_CHILD, NO_CHILD},
+        .leaf = true
+    };
+    QuadNode_array_add(&tree->nodes, node);
+    return QuadNode_array_size(&tree->nodes) - 1;
+}
+
+/* Which quarter of the node a point falls in: bit 0 is east, bit 1 north */
+static int node_quadrant(QuadNode *node, Vector point) {
+    double half = node->size / 2;
+    int quadrant = 0;
+    if (point.x >= node->min.x + half) {
+        quadrant |= 1;
+    }
+    if (point.y >= node->min.y + half) {
+        quadrant |= 2;
+    }
+    return quadrant;
+}
+
+static size_t node_child(QuadTree *tree, size_t index, int quadrant) {
+    QuadNode *node = QuadNode_array_at(&tree->nodes, index);
+    if (node->children[quadrant] != NO_CHILD) {
+        return node->children[quadrant];
+    }
+    double half = node->size / 2;
+    Vector min = {
+        node->min.x + (quadrant & 1 ? half : 0),
+        node->min.y + (quadrant & 2 ? half : 0)
+    };
+    size_t child = node_add(tree, min, half);
+    // node_add() may have moved the array, so look the parent up again
+    QuadNode_array_at(&tree->nodes, index)->children[quadrant] = child;
+    return child;
+}
+
+static void node_insert(QuadTree *tree, size_t index, Body *body, int depth) {
+    Vector position = body_get_centroid(body);
+    double mass = body_get_mass(body);
+    QuadNode *node = QuadNode_array_at(&tree->nodes, index);
+
+    // Every node on the way down absorbs the body into its center of mass
+    double total = node->mass + mass;
+    Vector old_moment = vec_multiply(node->mass, node->center_of_mass);
+    Vector moment = vec_add(old_moment, vec_multiply(mass, position));
+    bool was_empty = node->mass == 0 && !node->body;
+    node->center_of_mass = vec_multiply(1 / total, moment);
+    node->mass = total;
+
+    if (node->leaf) {
+        if (was_empty) {
+            node->body = body;
+            return;
+        }
+        if (depth >= MAX_DEPTH) {
+            // Keep piling coincident bodies into this leaf
+            node->body = NULL;
+            return;
+        }
+        // Split: push the resident body down, then fall through for this one
+        Body *resident = node->body;
+        node->leaf = false;
+        node->body = NULL;
+        if (resident) {
+            int quadrant = node_quadrant(node, body_get_centroid(resident));
+            size_t child = node_child(tree, index, quadrant);
+            node_insert(tree, child, resident, depth + 1);
+        }
+        node = QuadNode_array_at(&tree->nodes, index);
+    }
+    int quadrant = node_quadrant(node, position);
+    size_t child = node_child(tree, index, quadrant);
+    node_insert(tree, child, body, depth + 1);
+}
+
+void quadtree_build(QuadTree *tree, const BodyPtrArray *bodies) {
+    assert(tree);
+    assert(bodies);
+    QuadNode_array_clear(&tree->nodes);
+    size_t n = BodyPtr_array_size(bodies);
+    if (n == 0) {
+        return;
+    }
+
+    // The root is the smallest square around every centroid
+    Vector min = body_get_centroid(BodyPtr_array_get(bodies, 0));
+    Vector max = min;
+    for (size_t i = 1; i < n; i++) {
+        Vector c = body_get_centroid(BodyPtr_array_get(bodies, i));
+        min = (Vector) {fmin(min.x, c.x), fmin(min.y, c.y)};
+        max = (Vector) {fmax(max.x, c.x), fmax(max.y, c.y)};
+    }
+    double size = fmax(max.x - min.x, max.y - min.y);
+    // Pad so bodies on the top and right edges still land inside the root
+    size = size > 0 ? size * (1 + 1e-9) : 1;
+    QuadNode_array_reserve(&tree->nodes, 2 * n);
+    node_add(tree, min, size);
+
+    for (size_t i = 0; i < n; i++) {
+        Body *body = BodyPtr_array_get(bodies, i);
+        assert(isfinite(body_get_mass(body)));
+        node_insert(tree, 0, body, 0);
+    }
+}
+
+static bool node_contains(QuadNode *node, Vector point) {
+    return point.x >= node->min.x && point.x < node->min.x + node->size
+        && point.y >= node->min.y && point.y < node->min.y + node->size;
+}
+
+static Vector node_force(
+    QuadTree *tree, size_t index, Body *body, Vector position, double mass,
+    double G, double theta
+) {
+    QuadNode *node = QuadNode_array_at(&tree->nodes, index);
+    if (node->mass == 0 || node->body == body) {
+        return VEC_ZERO;
+    }
+    Vector r = vec_subtract(node->center_of_mass, position);
+    double distance = vec_magnitude(r);
+
+    // A cell holding the body can't stand in for it; always open it
+    bool far = !node_contains(node, position)
+        && node->size < theta * distance;
+    if (node->leaf || far) {
+        if (distance < CLOSENESS) {
+            return VEC_ZERO;
+        }
+        // F = G * m1 * m2 / r^2, pointing at the other mass
+        double magnitude = G * mass * node->mass / (distance * distance);
+        return vec_multiply(magnitude / distance, r);
+    }
+
+    Vector force = VEC_ZERO;
+    for (int i = 0; i < 4; i++) {
+        size_t child = QuadNode_array_at(&tree->nodes, index)->children[i];
+        if (child != NO_CHILD) {
+            force = vec_add(force,
+                node_force(tree, child, body, position, mass, G, theta));
+        }
+    }
+    return force;
+}
+
+Vector quadtree_force(QuadTree *tree, Body *body, double G, double theta) {
+    assert(tree);
+    assert(body);
+    if (QuadNode_array_size(&tree->nodes) == 0) {
+        return VEC_ZERO;
+    }
+    return node_force(tree, 0, body, body_get_centroid(body),
+        body_get_mass(body), G, theta);
+}
@@ -3,137 +3,799 @@
 #include "list.h"
 #include "forces.h"
 #include "utils.h"
+#include "constraints.h"
+#include "contact_solver.h"
+#include "job_system.h"
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #define NUMBER_STARTING_BODIES 5
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define DEFAULT_CONSTRAINT_ITERATIONS 4
+#define DEFAULT_CONTACT_ITERATIONS 4
 
-// A scene is simply a list of bodies and force creators.
+typedef ForceInfo *ForceInfoPtr;
+DEFINE_ARRAY(ForceInfoPtr)
+
+/* A body's state at the start of an RK4 step, and its slopes so far */
+typedef struct {
+    Vector position;
+    Vector velocity;
+    Vector slope_x;     // dx/dt and dv/dt at the latest trial state
+    Vector slope_v;
+    Vector sum_x;       // the slopes summed with weights 1, 2, 2, 1
+    Vector sum_v;
+} Rk4State;
+DEFINE_ARRAY(Rk4State)
+
+/* A body the scene removed, kept while a snapshot may still bring it back */
+typedef struct {
+    Body *body;
+    size_t added;       // how many snapshots the scene had taken when added
+    size_t removed;     // and when removed
+} RemovedBody;
+DEFINE_ARRAY(RemovedBody)
+DEFINE_ARRAY(size_t)
+
+/*
+ * What scene_snapshot() writes: this header, then a BodySnapshot per body,
+ * the force creators' addresses, the impulse contacts and constraints as
+ * their modules save them, and finally every body's vertices, one after
+ * another
+ */
+typedef struct {
+    size_t epoch;       // how many snapshots the scene took before this one
+    size_t bodies;
+    size_t forces;
+    size_t contact_bytes;
+    size_t constraint_bytes;
+    size_t vertices;
+    double dt;
+    TickStats stats;
+    bool verlet_primed;
+} SnapshotHeader;
+
+typedef struct {
+    Body *body;
+    size_t added;
+    size_t vertices;
+    BodyState state;
+} BodySnapshot;
+
+// A scene is simply an array of bodies and an array of force creators.
 struct scene {
-    List* bodies;
-    List* forceInfos;
+    BodyPtrArray bodies;
+    ForceInfoPtrArray forceInfos;
+    Arena* arena;   // created on first use by scene_get_arena()
+    Vector gravity;
+    Vector role_gravity[NUM_ROLES];
+    bool has_role_gravity[NUM_ROLES];
+    bool any_role_gravity;  // lets scene_tick() skip the role lookups
+    double dt;              // length of the tick in progress or last run
+    bool implicit_springs;
+    Constraints *constraints;   // created on first use
+    size_t constraint_iterations;
+    ContactSolver *contacts;    // created on first use
+    size_t contact_iterations;
+    JobSystem *jobs;            // not owned; NULL ticks on one thread
+    // See scene_set_adaptive_substeps()
+    double max_motion;
+    double max_depth;
+    size_t max_substeps;
+    TickStats stats;
+    Integrator integrator;
+    bool verlet_primed;     // whether every body has a Verlet acceleration
+    ForceInfoPtrArray parallel_forces;  // scratch for parallel ticks
+    Rk4StateArray rk4;                  // scratch for RK4 ticks
+    // Bodies and force creators are stamped with how many snapshots had been
+    // taken when they were added and removed, which tells scene_restore()
+    // which of them a snapshot has without looking them up
+    size_t snapshots;
+    size_tArray body_added;     // for each of bodies
+    RemovedBodyArray removed_bodies;
+    ForceInfoPtrArray removed_forces;
 };
 
 struct forceInfo {
     ForceCreator forcer;
     void *aux;
     FreeFunc aux_freer;
-    List* bodies;
+    BodyPtrArray bodies;    // a copy, so scene_tick() can scan it inline
+    Arena* arena;   // non-NULL if this struct lives in the scene's arena
+    bool parallel;  // may run alongside other parallel forces
+    // What a parallel force added during this tick, replayed in order
+    ContributionArray contributions;
+    size_t added;   // like RemovedBody's
+    size_t removed;
 };
 
 Scene *scene_init(void) {
     Scene* scene = malloc(sizeof(Scene));
     assert(scene);
-    scene->bodies = list_init(NUMBER_STARTING_BODIES, body_free);
-    scene->forceInfos = list_init(0, forceInfo_free);
+    BodyPtr_array_init(&scene->bodies, NUMBER_STARTING_BODIES);
+    ForceInfoPtr_array_init(&scene->forceInfos, 0);
+    scene->arena = NULL;
+    scene->gravity = VEC_ZERO;
+    for (size_t i = 0; i < NUM_ROLES; i++) {
+        scene->role_gravity[i] = VEC_ZERO;
+        scene->has_role_gravity[i] = false;
+    }
+    scene->any_role_gravity = false;
+    scene->dt = 0;
+    scene->implicit_springs = false;
+    scene->constraints = NULL;
+    scene->constraint_iterations = DEFAULT_CONSTRAINT_ITERATIONS;
+    scene->contacts = NULL;
+    scene->contact_iterations = DEFAULT_CONTACT_ITERATIONS;
+    scene->jobs = NULL;
+    scene->max_motion = 0;
+    scene->max_depth = 0;
+    scene->max_substeps = 1;
+    scene->stats = (TickStats) {0, 0, 0};
+    scene->integrator = INTEGRATOR_AVERAGE_VELOCITY;
+    scene->verlet_primed = false;
+    ForceInfoPtr_array_init(&scene->parallel_forces, 0);
+    Rk4State_array_init(&scene->rk4, 0);
+    scene->snapshots = 0;
+    size_t_array_init(&scene->body_added, NUMBER_STARTING_BODIES);
+    RemovedBody_array_init(&scene->removed_bodies, 0);
+    ForceInfoPtr_array_init(&scene->removed_forces, 0);
     return scene;
 }
 
 void forceInfo_free(void *force) {
     ForceInfo* f = force;
-    // f->bodies is same as f->aux->bodies so we do not free here
     if (f->aux_freer) {
         f->aux_freer(f->aux);
     }
-    free(f);
+    BodyPtr_array_free(&f->bodies);
+    Contribution_array_free(&f->contributions);
+    if (!f->arena) {
+        free(f);
+    }
 }
 
 void scene_free(Scene *scene) {
     assert(scene);
-    list_free(scene->bodies);
-    list_free(scene->forceInfos);
+    for (size_t i = 0; i < BodyPtr_array_size(&scene->bodies); i++) {
+        body_free(BodyPtr_array_get(&scene->bodies, i));
+    }
+    BodyPtr_array_free(&scene->bodies);
+    for (size_t i = 0; i < ForceInfoPtr_array_size(&scene->forceInfos); i++) {
+        forceInfo_free(ForceInfoPtr_array_get(&scene->forceInfos, i));
+    }
+    ForceInfoPtr_array_free(&scene->forceInfos);
+    scene_release_removed(scene, NULL);
+    size_t_array_free(&scene->body_added);
+    RemovedBody_array_free(&scene->removed_bodies);
+    ForceInfoPtr_array_free(&scene->removed_forces);
+    if (scene->constraints) {
+        constraints_free(scene->constraints);
+    }
+    if (scene->contacts) {
+        contact_solver_free(scene->contacts);
+    }
+    ForceInfoPtr_array_free(&scene->parallel_forces);
+    Rk4State_array_free(&scene->rk4);
+    if (scene->arena) {
+        arena_free(scene->arena);
+    }
     free(scene);
 }
 
+Arena *scene_get_arena(Scene *scene) {
+    assert(scene);
+    if (!scene->arena) {
+        scene->arena = arena_init(ARENA_CHUNK_SIZE);
+    }
+    return scene->arena;
+}
+
+/* Removes the force creator at the given index, freeing it unless
+ * a snapshot taken since it was added may bring it back */
+static void scene_remove_force(Scene *scene, size_t index) {
+    ForceInfo *force = ForceInfoPtr_array_get(&scene->forceInfos, index);
+    ForceInfoPtr_array_remove(&scene->forceInfos, index);
+    if (force->added < scene->snapshots) {
+        force->removed = scene->snapshots;
+        ForceInfoPtr_array_add(&scene->removed_forces, force);
+    } else {
+        forceInfo_free(force);
+    }
+}
+
+/* Whether a force creator was allocated from, or acts on a body from, arena */
+static bool force_uses_arena(ForceInfo *force, Arena *arena) {
+    if (force->arena == arena) {
+        return true;
+    }
+    for (size_t i = 0; i < BodyPtr_array_size(&force->bodies); i++) {
+        if (body_get_arena(BodyPtr_array_get(&force->bodies, i)) == arena) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void scene_reset_arena(Scene *scene) {
+    assert(scene);
+    Arena *arena = scene->arena;
+    if (!arena) {
+        return;
+    }
+    // Drop force creators first, since they may still point at arena bodies
+    size_t i = 0;
+    while (i < scene_forces(scene)) {
+        if (force_uses_arena(scene_get_forces(scene, i), arena)) {
+            scene_remove_force(scene, i);
+        } else {
+            i++;
+        }
+    }
+    i = 0;
+    while (i < scene_bodies(scene)) {
+        if (body_get_arena(scene_get_body(scene, i)) == arena) {
+            scene_remove_body(scene, i);
+        } else {
+            i++;
+        }
+    }
+    // Nothing from the arena can be brought back after this
+    i = 0;
+    while (i < ForceInfoPtr_array_size(&scene->removed_forces)) {
+        ForceInfo *force = ForceInfoPtr_array_get(&scene->removed_forces, i);
+        if (force_uses_arena(force, arena)) {
+            ForceInfoPtr_array_remove(&scene->removed_forces, i);
+            forceInfo_free(force);
+        } else {
+            i++;
+        }
+    }
+    i = 0;
+    while (i < RemovedBody_array_size(&scene->removed_bodies)) {
+        Body *body = RemovedBody_array_get(&scene->removed_bodies, i).body;
+        if (body_get_arena(body) == arena) {
+            RemovedBody_array_remove(&scene->removed_bodies, i);
+            body_free(body);
+        } else {
+            i++;
+        }
+    }
+    arena_reset(arena);
+}
+
 size_t scene_bodies(Scene *scene) {
     assert(scene);
-    return list_size(scene->bodies);
+    return BodyPtr_array_size(&scene->bodies);
 }
 
 size_t scene_forces(Scene *scene) {
     assert(scene);
-    return list_size(scene->forceInfos);
+    return ForceInfoPtr_array_size(&scene->forceInfos);
 }
 
 Body *scene_get_body(Scene *scene, size_t index) {
     assert(scene);
-    assert(0 <= index && index < scene_bodies(scene));
-    return list_get(scene->bodies, index);
+    return BodyPtr_array_get(&scene->bodies, index);
 }
 
 ForceInfo* scene_get_forces(Scene* scene, size_t index) {
     assert(scene);
-    assert(0 <= index && index < scene_forces(scene));
-    return list_get(scene->forceInfos, index);
+    return ForceInfoPtr_array_get(&scene->forceInfos, index);
 }
 
 void scene_add_body(Scene *scene, Body *body) {
     assert(scene);
     assert(body);
-    list_add(scene->bodies, body);
+    BodyPtr_array_add(&scene->bodies, body);
+    size_t_array_add(&scene->body_added, scene->snapshots);
+    scene->verlet_primed = false;
 }
 
 void scene_remove_body(Scene *scene, size_t index) {
     assert(scene);
-    list_remove(scene->bodies, index);
+    Body *body = BodyPtr_array_get(&scene->bodies, index);
+    size_t added = size_t_array_get(&scene->body_added, index);
+    BodyPtr_array_remove(&scene->bodies, index);
+    size_t_array_remove(&scene->body_added, index);
+    // A snapshot taken since the body was added may bring it back
+    if (added < scene->snapshots) {
+        RemovedBody_array_add(&scene->removed_bodies, \
+            (RemovedBody) {body, added, scene->snapshots});
+    } else {
+        body_free(body);
+    }
 }
 
-void scene_tick(Scene *scene, double dt) {
+void scene_set_gravity(Scene *scene, Vector gravity) {
     assert(scene);
+    scene->gravity = gravity;
+}
 
-    // Step 1: Iterate through all forces and apply
-    size_t i;
-    size_t k;
-    for (i = 0; i < scene_forces(scene); i++) {
-        ForceInfo* force = scene_get_forces(scene, i);
+Vector scene_get_gravity(Scene *scene) {
+    assert(scene);
+    return scene->gravity;
+}
+
+void scene_set_role_gravity(Scene *scene, Role role, Vector gravity) {
+    assert(scene);
+    assert(0 <= role && role < NUM_ROLES);
+    scene->role_gravity[role] = gravity;
+    scene->has_role_gravity[role] = true;
+    scene->any_role_gravity = true;
+}
+
+double scene_get_dt(Scene *scene) {
+    assert(scene);
+    return scene->dt;
+}
+
+void scene_set_implicit_springs(Scene *scene, bool implicit) {
+    assert(scene);
+    scene->implicit_springs = implicit;
+}
+
+bool scene_get_implicit_springs(Scene *scene) {
+    assert(scene);
+    return scene->implicit_springs;
+}
+
+void scene_set_integrator(Scene *scene, Integrator integrator) {
+    assert(scene);
+    scene->integrator = integrator;
+    scene->verlet_primed = false;
+}
+
+Integrator scene_get_integrator(Scene *scene) {
+    assert(scene);
+    return scene->integrator;
+}
+
+/* Gets the scene's constraint set, creating it if needed */
+static Constraints *scene_constraints(Scene *scene) {
+    if (!scene->constraints) {
+        scene->constraints = constraints_init();
+    }
+    return scene->constraints;
+}
+
+void scene_add_distance_constraint(
+    Scene *scene, Body *body1, Body *body2, double distance, double compliance
+) {
+    assert(scene);
+    constraints_add_distance(scene_constraints(scene), body1, body2, \
+        distance, compliance);
+}
+
+void scene_add_pin_constraint(
+    Scene *scene, Body *body, Vector point, double compliance
+) {
+    assert(scene);
+    constraints_add_pin(scene_constraints(scene), body, point, compliance);
+}
+
+void scene_add_contact_constraint(Scene *scene, Body *body1, Body *body2) {
+    assert(scene);
+    constraints_add_contact(scene_constraints(scene), body1, body2);
+}
+
+size_t scene_constraints_count(Scene *scene) {
+    assert(scene);
+    return scene->constraints ? constraints_size(scene->constraints) : 0;
+}
+
+void scene_set_constraint_iterations(Scene *scene, size_t iterations) {
+    assert(scene);
+    scene->constraint_iterations = iterations;
+}
+
+void scene_add_impulse_contact(
+    Scene *scene, Body *body1, Body *body2, double elasticity, double friction
+) {
+    assert(scene);
+    if (!scene->contacts) {
+        scene->contacts = contact_solver_init();
+    }
+    contact_solver_add(scene->contacts, body1, body2, elasticity, friction);
+}
+
+size_t scene_impulse_contacts(Scene *scene) {
+    assert(scene);
+    return scene->contacts ? contact_solver_pairs(scene->contacts) : 0;
+}
+
+void scene_set_contact_iterations(Scene *scene, size_t iterations) {
+    assert(scene);
+    scene->contact_iterations = iterations;
+}
+
+/* The acceleration field a body falls in: its role's, if set, else the scene's */
+static Vector scene_body_gravity(Scene *scene, Body *body) {
+    // Bodies made with body_init() have no info, and so no role
+    if (scene->any_role_gravity && body_get_info(body)) {
+        Role role = body_get_role(body);
+        if (0 <= role && role < NUM_ROLES && scene->has_role_gravity[role]) {
+            return scene->role_gravity[role];
+        }
+    }
+    return scene->gravity;
+}
+
+void scene_set_jobs(Scene *scene, JobSystem *jobs) {
+    assert(scene);
+    scene->jobs = jobs;
+}
+
+JobSystem *scene_get_jobs(Scene *scene) {
+    assert(scene);
+    return scene->jobs;
+}
+
+/* scene_body_gravity() as a FieldFunc, for the contact solver */
+static Vector scene_body_field(Body *body, void *scene) {
+    return scene_body_gravity(scene, body);
+}
+
+/* Whether any of the bodies a force creator acts on is marked for removal */
+static bool force_has_removed_body(ForceInfo *force) {
+    for (size_t j = 0; j < BodyPtr_array_size(&force->bodies); j++) {
+        if (body_is_removed(BodyPtr_array_get(&force->bodies, j))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Runs a chunk of the parallel forces, each into its own log */
+static void run_parallel_forces(
+    size_t start, size_t end, size_t thread, void *aux
+) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        ForceInfo *force = ForceInfoPtr_array_get(&scene->parallel_forces, i);
+        Contribution_array_clear(&force->contributions);
+        body_record_into(&force->contributions);
         force->forcer(force->aux);
     }
-    i = 0;
-    k = scene_forces(scene);
+    body_record_into(NULL);
+}
 
-    bool to_remove;
-    // Step 2: Remove forces that have had one of its bodies removed
-    while (i < k) {
-        to_remove = false;
-        ForceInfo* force = scene_get_forces(scene, i);
-        List *bodies = force->bodies;
-        for (size_t j = 0; j < list_size(bodies); j++) {
-            Body* b = list_get(bodies, j);
-            if (body_is_removed(b)) {
-                list_remove(scene->forceInfos, i);
-                k = scene_forces(scene);
-                to_remove = true;
+/*
+ * Runs the force creators on the scene's job system. The parallel ones are
+ * split across the threads first, each logging what it adds. Then every
+ * force creator takes its turn in order on this thread: ordinary ones run,
+ * and parallel ones have their logs replayed. Each body's forces are thus
+ * summed in the same order as in a serial tick, so the results match it
+ * bit for bit, as long as the ordinary force creators don't move the bodies
+ * or change their velocities (the parallel ones have already seen them).
+ */
+static void scene_apply_forces_parallel(Scene *scene) {
+    ForceInfoPtrArray *parallel = &scene->parallel_forces;
+    ForceInfoPtr_array_clear(parallel);
+    for (size_t i = 0; i < scene_forces(scene); i++) {
+        ForceInfo* force = ForceInfoPtr_array_get(&scene->forceInfos, i);
+        if (force->parallel) {
+            ForceInfoPtr_array_add(parallel, force);
+        }
+    }
+    parallel_for(scene->jobs, ForceInfoPtr_array_size(parallel), 0, \
+        run_parallel_forces, scene);
+    for (size_t i = 0; i < scene_forces(scene); i++) {
+        ForceInfo* force = ForceInfoPtr_array_get(&scene->forceInfos, i);
+        if (force->parallel) {
+            body_replay(&force->contributions);
+        } else {
+            force->forcer(force->aux);
+        }
+    }
+}
+
+/* Runs the force creators, on the scene's job system if it has one */
+static void scene_apply_forces(Scene *scene) {
+    if (scene->jobs) {
+        scene_apply_forces_parallel(scene);
+        return;
+    }
+    for (size_t i = 0; i < scene_forces(scene); i++) {
+        ForceInfo* force = ForceInfoPtr_array_get(&scene->forceInfos, i);
+        force->forcer(force->aux);
+    }
+}
+
+/* Integrates a chunk of the scene's bodies over the current tick */
+static void tick_bodies(size_t start, size_t end, size_t thread, void *aux) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        Body *b = BodyPtr_array_get(&scene->bodies, i);
+        Vector field = scene_body_gravity(scene, b);
+        switch (scene->integrator) {
+            case INTEGRATOR_SEMI_IMPLICIT_EULER:
+                body_tick_semi_implicit(b, scene->dt, field);
                 break;
-            }
+            case INTEGRATOR_VELOCITY_VERLET:
+                body_tick_verlet(b, scene->dt, field);
+                break;
+            default:
+                body_tick_in_field(b, scene->dt, field);
         }
-        if (!to_remove) {
+    }
+}
+
+/* The acceleration of a body from its forces and field, clearing them */
+static Vector take_acceleration(Scene *scene, Body *body) {
+    Vector acceleration = vec_add(
+        vec_multiply(1 / body_get_mass(body), body_get_force(body)),
+        scene_body_gravity(scene, body));
+    body_set_force(body, VEC_ZERO);
+    body_set_impulse(body, VEC_ZERO);
+    return acceleration;
+}
+
+/* Sets a chunk of bodies' accelerations to those from their forces */
+static void prime_bodies(size_t start, size_t end, size_t thread, void *aux) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) != INFINITY) {
+            body_set_acceleration(body, take_acceleration(scene, body));
+        }
+    }
+}
+
+/*
+ * Verlet moves bodies by the acceleration from their last tick, which
+ * new bodies (or ones ticked by another integrator) don't have yet.
+ * This runs the force creators once to find it, keeping only their forces.
+ */
+static void scene_prime_verlet(Scene *scene) {
+    scene_apply_forces(scene);
+    parallel_for(scene->jobs, scene_bodies(scene), 0, prime_bodies, scene);
+    scene->verlet_primed = true;
+}
+
+/* Moves a chunk of the scene's bodies for the first half of a Verlet step */
+static void drift_bodies(size_t start, size_t end, size_t thread, void *aux) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        body_drift(BodyPtr_array_get(&scene->bodies, i), scene->dt);
+    }
+}
+
+/* Where RK4 is within a step, for the chunks of each stage */
+typedef struct {
+    Scene *scene;
+    double h;       // how far along the step the trial state is
+    double weight;  // the weight of the slopes found there
+} Rk4Stage;
+
+/* Records a chunk of bodies' states and their slopes at the step's start */
+static void rk4_begin(size_t start, size_t end, size_t thread, void *aux) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) == INFINITY) {
+            continue;
+        }
+        Rk4State *state = Rk4State_array_at(&scene->rk4, i);
+        // Impulses act once, at the start of the step
+        state->position = body_get_centroid(body);
+        state->velocity = vec_add(body_get_velocity(body),
+            vec_multiply(1 / body_get_mass(body), body_get_impulse(body)));
+        state->slope_x = state->velocity;
+        state->slope_v = take_acceleration(scene, body);
+        state->sum_x = state->slope_x;
+        state->sum_v = state->slope_v;
+    }
+}
+
+/* Moves a chunk of bodies to the next trial state along the last slopes */
+static void rk4_move(size_t start, size_t end, size_t thread, void *aux) {
+    Rk4Stage *stage = aux;
+    Scene *scene = stage->scene;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) == INFINITY) {
+            continue;
+        }
+        Rk4State *state = Rk4State_array_at(&scene->rk4, i);
+        body_set_centroid(body, vec_add(state->position,
+            vec_multiply(stage->h, state->slope_x)));
+        body_set_velocity(body, vec_add(state->velocity,
+            vec_multiply(stage->h, state->slope_v)));
+    }
+}
+
+/* Adds the slopes at a chunk of bodies' trial states to their sums */
+static void rk4_measure(size_t start, size_t end, size_t thread, void *aux) {
+    Rk4Stage *stage = aux;
+    Scene *scene = stage->scene;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) == INFINITY) {
+            continue;
+        }
+        Rk4State *state = Rk4State_array_at(&scene->rk4, i);
+        state->slope_x = body_get_velocity(body);
+        state->slope_v = take_acceleration(scene, body);
+        state->sum_x = vec_add(state->sum_x,
+            vec_multiply(stage->weight, state->slope_x));
+        state->sum_v = vec_add(state->sum_v,
+            vec_multiply(stage->weight, state->slope_v));
+    }
+}
+
+/* Moves a chunk of bodies by the weighted average of their slopes */
+static void rk4_finish(size_t start, size_t end, size_t thread, void *aux) {
+    Scene *scene = aux;
+    for (size_t i = start; i < end; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) == INFINITY) {
+            continue;
+        }
+        Rk4State *state = Rk4State_array_at(&scene->rk4, i);
+        body_set_centroid(body, vec_add(state->position,
+            vec_multiply(scene->dt / 6, state->sum_x)));
+        body_set_velocity(body, vec_add(state->velocity,
+            vec_multiply(scene->dt / 6, state->sum_v)));
+        body_set_acceleration(body, vec_multiply(1.0 / 6, state->sum_v));
+        body_rotate_with_velocity(body);
+    }
+}
+
+/*
+ * Integrates the scene's bodies with RK4. The forces from the start of the
+ * step have already been added; the force creators are run again at the
+ * 3 trial states, with the bodies moved there and back.
+ */
+static void scene_tick_rk4(Scene *scene) {
+    size_t n = scene_bodies(scene);
+    Rk4State_array_clear(&scene->rk4);
+    for (size_t i = 0; i < n; i++) {
+        Rk4State_array_add(&scene->rk4, (Rk4State) {0});
+    }
+    parallel_for(scene->jobs, n, 0, rk4_begin, scene);
+    Rk4Stage stages[] = {
+        {scene, scene->dt / 2, 2},
+        {scene, scene->dt / 2, 2},
+        {scene, scene->dt, 1}
+    };
+    for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++) {
+        parallel_for(scene->jobs, n, 0, rk4_move, &stages[s]);
+        scene_apply_forces(scene);
+        parallel_for(scene->jobs, n, 0, rk4_measure, &stages[s]);
+    }
+    parallel_for(scene->jobs, n, 0, rk4_finish, scene);
+}
+
+void scene_set_adaptive_substeps(
+    Scene *scene, double max_motion, double max_depth, size_t max_substeps
+) {
+    assert(scene);
+    assert(max_motion >= 0);
+    assert(max_depth >= 0);
+    assert(max_substeps >= 1);
+    scene->max_motion = max_motion;
+    scene->max_depth = max_depth;
+    scene->max_substeps = max_substeps;
+}
+
+TickStats scene_get_tick_stats(Scene *scene) {
+    assert(scene);
+    return scene->stats;
+}
+
+/*
+ * How far the fastest body would move over dt, in multiples of its size,
+ * going by its velocity and the field it falls in
+ */
+static double scene_max_motion(Scene *scene, double dt) {
+    double max_motion = 0;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        if (body_get_mass(body) == INFINITY || body_is_removed(body)) {
+            continue;
+        }
+        double speed = vec_magnitude(body_get_velocity(body))
+            + vec_magnitude(scene_body_gravity(scene, body)) * dt;
+        double size = sqrt(body_area(body));
+        if (size > 0) {
+            max_motion = fmax(max_motion, speed * dt / size);
+        }
+    }
+    return max_motion;
+}
+
+/* How many substeps to split a tick of length dt into */
+static size_t scene_substeps(Scene *scene, double dt, double *motion) {
+    *motion = 0;
+    if (scene->max_substeps == 1) {
+        return 1;
+    }
+    *motion = scene_max_motion(scene, dt);
+    double substeps = 1;
+    if (scene->max_motion > 0) {
+        substeps = ceil(*motion / scene->max_motion);
+    }
+    // Contacts that sank in too far need shorter steps than last time
+    if (scene->max_depth > 0 && scene->stats.max_depth > scene->max_depth) {
+        substeps = fmax(substeps, 2.0 * scene->stats.substeps);
+    }
+    return (size_t) fmax(1, fmin(substeps, scene->max_substeps));
+}
+
+/* Runs one step of scene_tick() */
+static void scene_step(Scene *scene, double dt) {
+    // Force creators that integrate implicitly need to know the step size
+    scene->dt = dt;
+
+    // Verlet adds the forces at where the bodies move to
+    if (scene->integrator == INTEGRATOR_VELOCITY_VERLET) {
+        if (!scene->verlet_primed) {
+            scene_prime_verlet(scene);
+        }
+        parallel_for(scene->jobs, scene_bodies(scene), 0, drift_bodies, scene);
+    }
+    // Step 1: Iterate through all forces and apply
+    scene_apply_forces(scene);
+
+    // Step 2: Remove forces that have had one of its bodies removed
+    size_t i = 0;
+    while (i < scene_forces(scene)) {
+        if (force_has_removed_body(scene_get_forces(scene, i))) {
+            scene_remove_force(scene, i);
+        } else {
             i++;
         }
     }
-    // Step 3: Removes all bodies that are marked to be removed
+    // Constraints can't outlive their bodies either
+    if (scene->constraints) {
+        constraints_prune(scene->constraints);
+    }
+    // Resolve contacts using the velocities the bodies are about to reach
+    if (scene->contacts) {
+        contact_solver_prune(scene->contacts);
+        contact_solver_solve(scene->contacts, dt, scene->contact_iterations, \
+            scene_body_field, scene);
+    }
+    // Step 3: Removes all bodies that are marked to be removed,
+    // then ticks the rest, in chunks if there is a job system
     i = 0;
-    k = scene_bodies(scene);
-    while (i < k) {
-        Body *b = scene_get_body(scene, i);
-        if (body_is_removed(b)) {
-            // Vector center = body_get_centroid(scene_get_body(scene, i));
+    while (i < scene_bodies(scene)) {
+        if (body_is_removed(BodyPtr_array_get(&scene->bodies, i))) {
             scene_remove_body(scene, i);
-            // List* explosion_points = get_star_points(8, 15, center);
-            // Role *type = malloc(sizeof(Role));
-            // assert(type);
-            // *type = PLAYER;
-            // Body* explosion = body_init_with_info(explosion_points, 1, (RGBColor) {1, 1, 1}, type, free);
-            // scene_add_body(scene, explosion);
-            // scene_remove_body(scene, i);
         } else {
-            body_tick(b, dt);
             i++;
         }
-        k = scene_bodies(scene);
+    }
+    if (scene->integrator == INTEGRATOR_RK4) {
+        scene_tick_rk4(scene);
+    } else {
+        parallel_for(scene->jobs, scene_bodies(scene), 0, tick_bodies, scene);
+    }
+    // Step 4: Move bodies back to satisfy their constraints
+    if (scene->constraints) {
+        constraints_solve(scene->constraints, &scene->bodies, dt, \
+            scene->constraint_iterations);
     }
 }
 
+void scene_tick(Scene *scene, double dt) {
+    assert(scene);
+    double motion;
+    size_t substeps = scene_substeps(scene, dt, &motion);
+    double depth = 0;
+    for (size_t i = 0; i < substeps; i++) {
+        scene_step(scene, dt / substeps);
+        if (scene->contacts) {
+            depth = fmax(depth, contact_solver_max_depth(scene->contacts));
+        }
+    }
+    scene->stats = (TickStats) {substeps, motion, depth};
+}
+
 void scene_tick_no_forces(Scene *scene, double dt) {
     assert(scene);
     // Iterate over bodies
@@ -176,13 +838,250 @@ void scene_add_force_creator(
 
 void scene_add_bodies_force_creator(
     Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
+) {
+    BodyPtrArray array;
+    BodyPtr_array_init(&array, bodies ? list_size(bodies) : 0);
+    for (size_t i = 0; bodies && i < list_size(bodies); i++) {
+        BodyPtr_array_add(&array, list_get(bodies, i));
+    }
+    scene_add_body_array_force_creator(scene, forcer, aux, &array, freer);
+    BodyPtr_array_free(&array);
+}
+
+static void scene_add_force_info(
+    Scene *scene, ForceCreator forcer, void *aux, const BodyPtrArray *bodies,
+    FreeFunc freer, bool parallel
 ) {
     assert(scene);
-    ForceInfo* force_info = malloc(sizeof(ForceInfo));
-    assert(force_info);
+    ForceInfo* force_info;
+    // A force over arena bodies can't outlive them, so it shares their arena
+    Arena *arena = NULL;
+    for (size_t i = 0; scene->arena && bodies && i < bodies->size; i++) {
+        if (body_get_arena(bodies->data[i]) == scene->arena) {
+            arena = scene->arena;
+        }
+    }
+    if (arena) {
+        force_info = arena_alloc(arena, sizeof(ForceInfo));
+    } else {
+        force_info = malloc(sizeof(ForceInfo));
+        assert(force_info);
+    }
+    force_info->arena = arena;
     force_info->forcer = forcer;
     force_info->aux = aux;
     force_info->aux_freer = freer;
-    force_info->bodies = bodies;
-    list_add(scene->forceInfos, force_info);
+    force_info->parallel = parallel;
+    force_info->added = scene->snapshots;
+    force_info->removed = 0;
+    // Reused every tick, so kept off the arena where it couldn't shrink
+    Contribution_array_init(&force_info->contributions, 0);
+    BodyPtr_array_init_arena(&force_info->bodies, bodies ? bodies->size : 0, arena);
+    if (bodies) {
+        BodyPtr_array_add_all(&force_info->bodies, bodies->data, bodies->size);
+    }
+    ForceInfoPtr_array_add(&scene->forceInfos, force_info);
+}
+
+void scene_add_body_array_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, const BodyPtrArray *bodies,
+    FreeFunc freer
+) {
+    scene_add_force_info(scene, forcer, aux, bodies, freer, false);
+}
+
+void scene_add_parallel_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, const BodyPtrArray *bodies,
+    FreeFunc freer
+) {
+    scene_add_force_info(scene, forcer, aux, bodies, freer, true);
+}
+
+/* The size of a snapshot with the given numbers of everything */
+static size_t snapshot_size(
+    size_t bodies, size_t forces, size_t contact_bytes,
+    size_t constraint_bytes, size_t vertices
+) {
+    // Every part is a multiple of 8 bytes long, so the next stays aligned
+    return sizeof(SnapshotHeader) + bodies * sizeof(BodySnapshot) \
+        + forces * sizeof(ForceInfoPtr) + contact_bytes + constraint_bytes \
+        + vertices * sizeof(Vector);
+}
+
+size_t scene_snapshot_size(Scene *scene) {
+    assert(scene);
+    size_t vertices = 0;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        vertices += list_size(body_get_shape(scene_get_body(scene, i)));
+    }
+    return snapshot_size(scene_bodies(scene), scene_forces(scene), \
+        scene->contacts ? contact_solver_save_size(scene->contacts) : 0, \
+        scene->constraints ? constraints_save_size(scene->constraints) : 0, \
+        vertices);
+}
+
+size_t scene_snapshot(Scene *scene, void *buf) {
+    assert(scene);
+    assert(buf);
+    SnapshotHeader *header = buf;
+    *header = (SnapshotHeader) {
+        .epoch = scene->snapshots,
+        .bodies = scene_bodies(scene),
+        .forces = scene_forces(scene),
+        .contact_bytes = 0,
+        .constraint_bytes = 0,
+        .vertices = 0,
+        .dt = scene->dt,
+        .stats = scene->stats,
+        .verlet_primed = scene->verlet_primed
+    };
+    BodySnapshot *bodies = (BodySnapshot *) (header + 1);
+    ForceInfoPtr *forces = (ForceInfoPtr *) (bodies + header->bodies);
+    char *contacts = (char *) (forces + header->forces);
+    memcpy(forces, scene->forceInfos.data, \
+        header->forces * sizeof(ForceInfoPtr));
+    if (scene->contacts) {
+        header->contact_bytes = contact_solver_save(scene->contacts, contacts);
+    }
+    char *constraints = contacts + header->contact_bytes;
+    if (scene->constraints) {
+        header->constraint_bytes = \
+            constraints_save(scene->constraints, constraints);
+    }
+    Vector *vertices = (Vector *) (constraints + header->constraint_bytes);
+
+    for (size_t i = 0; i < header->bodies; i++) {
+        Body *body = BodyPtr_array_get(&scene->bodies, i);
+        bodies[i].body = body;
+        bodies[i].added = size_t_array_get(&scene->body_added, i);
+        bodies[i].vertices = list_size(body_get_shape(body));
+        body_save_state(body, &bodies[i].state, vertices + header->vertices);
+        header->vertices += bodies[i].vertices;
+    }
+    scene->snapshots++;
+    return snapshot_size(header->bodies, header->forces, \
+        header->contact_bytes, header->constraint_bytes, header->vertices);
+}
+
+void scene_restore(Scene *scene, const void *buf) {
+    assert(scene);
+    assert(buf);
+    const SnapshotHeader *header = buf;
+    const BodySnapshot *bodies = (const BodySnapshot *) (header + 1);
+    const ForceInfoPtr *forces = (const ForceInfoPtr *) \
+        (bodies + header->bodies);
+    const char *contacts = (const char *) (forces + header->forces);
+    const char *constraints = contacts + header->contact_bytes;
+    const Vector *vertices = (const Vector *) \
+        (constraints + header->constraint_bytes);
+    size_t epoch = header->epoch;
+    assert(epoch < scene->snapshots);
+
+    // The snapshot has exactly what was added by the time it was taken and
+    // removed after. Anything else added since is freed, force creators
+    // first, since they may point at bodies added since. What was removed
+    // before the snapshot stays kept, for older snapshots.
+    size_t found = 0;
+    for (size_t i = 0; i < scene_forces(scene); i++) {
+        ForceInfo *force = ForceInfoPtr_array_get(&scene->forceInfos, i);
+        if (force->added > epoch) {
+            forceInfo_free(force);
+        } else {
+            found++;
+        }
+    }
+    size_t i = 0;
+    while (i < ForceInfoPtr_array_size(&scene->removed_forces)) {
+        ForceInfo *force = ForceInfoPtr_array_get(&scene->removed_forces, i);
+        if (force->removed <= epoch) {
+            i++;
+            continue;
+        }
+        ForceInfoPtr_array_remove(&scene->removed_forces, i);
+        if (force->added > epoch) {
+            forceInfo_free(force);
+        } else {
+            found++;
+        }
+    }
+    assert(found == header->forces);
+    ForceInfoPtr_array_clear(&scene->forceInfos);
+    ForceInfoPtr_array_add_all(&scene->forceInfos, forces, header->forces);
+
+    found = 0;
+    for (i = 0; i < scene_bodies(scene); i++) {
+        if (size_t_array_get(&scene->body_added, i) > epoch) {
+            body_free(BodyPtr_array_get(&scene->bodies, i));
+        } else {
+            found++;
+        }
+    }
+    i = 0;
+    while (i < RemovedBody_array_size(&scene->removed_bodies)) {
+        RemovedBody removed = RemovedBody_array_get(&scene->removed_bodies, i);
+        if (removed.removed <= epoch) {
+            i++;
+            continue;
+        }
+        RemovedBody_array_remove(&scene->removed_bodies, i);
+        if (removed.added > epoch) {
+            body_free(removed.body);
+        } else {
+            found++;
+        }
+    }
+    assert(found == header->bodies);
+    BodyPtr_array_clear(&scene->bodies);
+    size_t_array_clear(&scene->body_added);
+    for (i = 0; i < header->bodies; i++) {
+        BodyPtr_array_add(&scene->bodies, bodies[i].body);
+        size_t_array_add(&scene->body_added, bodies[i].added);
+    }
+
+    if (scene->contacts) {
+        contact_solver_restore(scene->contacts, contacts, \
+            header->contact_bytes);
+    }
+    if (scene->constraints) {
+        constraints_restore(scene->constraints, constraints, \
+            header->constraint_bytes);
+    }
+    for (i = 0; i < header->bodies; i++) {
+        assert(list_size(body_get_shape(bodies[i].body)) == bodies[i].vertices);
+        body_load_state(bodies[i].body, &bodies[i].state, vertices);
+        vertices += bodies[i].vertices;
+    }
+    scene->dt = header->dt;
+    scene->stats = header->stats;
+    scene->verlet_primed = header->verlet_primed;
+}
+
+void scene_release_removed(Scene *scene, const void *oldest) {
+    assert(scene);
+    // Nothing removed by the time the oldest snapshot was taken is in it,
+    // or in any newer one
+    size_t epoch = scene->snapshots;
+    if (oldest) {
+        epoch = ((const SnapshotHeader *) oldest)->epoch;
+    }
+    size_t i = 0;
+    while (i < ForceInfoPtr_array_size(&scene->removed_forces)) {
+        ForceInfo *force = ForceInfoPtr_array_get(&scene->removed_forces, i);
+        if (force->removed <= epoch) {
+            ForceInfoPtr_array_remove(&scene->removed_forces, i);
+            forceInfo_free(force);
+        } else {
+            i++;
+        }
+    }
+    i = 0;
+    while (i < RemovedBody_array_size(&scene->removed_bodies)) {
+        RemovedBody removed = RemovedBody_array_get(&scene->removed_bodies, i);
+        if (removed.removed <= epoch) {
+            RemovedBody_array_remove(&scene->removed_bodies, i);
+            body_free(removed.body);
+        } else {
+            i++;
+        }
+    }
 }
@@ -1,11 +1,12 @@
 #include "sdl_wrapper.h"
+#include "arena.h"
+#include "timing.h"
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <SDL2/SDL_ttf.h>
-#include <time.h>
 
 #define WINDOW_TITLE "CS 3"
 #define WINDOW_WIDTH 1000
@@ -45,10 +46,10 @@ void* info = NULL;
  */
 uint32_t key_start_timestamp;
 /**
- * The value of clock() when time_since_last_tick() was last called.
- * Initially 0.
+ * The value of timing_now() when time_since_last_tick() was last called.
+ * Initially NAN.
  */
-clock_t last_clock = 0;
+double last_tick = NAN;
 
 /**
  * Converts an SDL key code to a char.
@@ -99,35 +100,40 @@ void sdl_init(Vector min, Vector max) {
     }
 }
 
+void initialize_window(Vector dimensions) {
+    Vector bottom_left = vec_multiply(-0.5, dimensions);
+    Vector top_right = vec_multiply(0.5, dimensions);
+    sdl_init(bottom_left, top_right);
+}
+
 bool sdl_is_done(void) {
-    SDL_Event *event = malloc(sizeof(*event));
-    assert(event);
-    while (SDL_PollEvent(event)) {
-        switch (event->type) {
+    // This is the top of every frame, so last frame's temporaries are dead
+    frame_arena_reset();
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        switch (event.type) {
             case SDL_QUIT:
-                free(event);
                 return true;
             case SDL_KEYDOWN:
             case SDL_KEYUP:
                 // Skip the keypress if no handler is configured
                 // or an unrecognized key was pressed
                 if (!key_handler) break;
-                char key = get_keycode(event->key.keysym.sym);
+                char key = get_keycode(event.key.keysym.sym);
                 if (!key) break;
 
-                double timestamp = event->key.timestamp;
-                if (!event->key.repeat) {
+                double timestamp = event.key.timestamp;
+                if (!event.key.repeat) {
                     key_start_timestamp = timestamp;
                 }
                 KeyEventType type =
-                    event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
+                    event.type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
                 double held_time =
                     (timestamp - key_start_timestamp) / MS_PER_S;
                 key_handler(key, type, held_time, info);
                 break;
         }
     }
-    free(event);
     return false;
 }
 
@@ -139,15 +145,10 @@ void sdl_clear(void) {
 WindowInfo get_scaling_info(void) {
     // Scale scene so it fits entirely in the window,
     // with the center of the scene at the center of the window
-    int *width = malloc(sizeof(*width)),
-        *height = malloc(sizeof(*height));
-    assert(width);
-    assert(height);
-    SDL_GetWindowSize(window, width, height);
-    double center_x = *width / 2.0,
-           center_y = *height / 2.0;
-    free(width);
-    free(height);
+    int width, height;
+    SDL_GetWindowSize(window, &width, &height);
+    double center_x = width / 2.0,
+           center_y = height / 2.0;
     double x_scale = center_x / max_diff.x,
            y_scale = center_y / max_diff.y;
     double scale = x_scale < y_scale ? x_scale : y_scale;
@@ -188,7 +189,13 @@ void sdl_draw_text(Text* text) {
     SDL_RenderCopy(renderer, get_texture_text(text), NULL, &dstrect);
 }
 
-void sdl_draw_polygon(List *points, RGBColor color) {
+/*
+ * Draws a polygon. If stepper is non-NULL, the polygon is the shape of
+ * the scene body at index, and is drawn where the stepper interpolates it.
+ */
+static void draw_polygon(
+    List *points, RGBColor color, FixedStep *stepper, size_t index
+) {
     // Check parameters
     size_t n = list_size(points);
     assert(n >= 3);
@@ -201,14 +208,15 @@ void sdl_draw_polygon(List *points, RGBColor color) {
     double center_y = i.center.y;
     double scale = i.scale;
     // Convert each vertex to a point on screen
-    short *x_points = malloc(sizeof(*x_points) * n),
-          *y_points = malloc(sizeof(*y_points) * n);
-    assert(x_points);
-    assert(y_points);
+    short *x_points = arena_alloc(frame_arena(), sizeof(*x_points) * n),
+          *y_points = arena_alloc(frame_arena(), sizeof(*y_points) * n);
     for (size_t i = 0; i < n; i++) {
-        Vector *vertex = list_get(points, i);
+        Vector vertex = *(Vector *) list_get(points, i);
+        if (stepper) {
+            vertex = fixed_step_point(stepper, index, vertex);
+        }
         Vector pos_from_center =
-            vec_multiply(scale, vec_subtract(*vertex, center));
+            vec_multiply(scale, vec_subtract(vertex, center));
         // Flip y axis since positive y is down on the screen
         x_points[i] = round(center_x + pos_from_center.x);
         y_points[i] = round(center_y - pos_from_center.y);
@@ -220,27 +228,41 @@ void sdl_draw_polygon(List *points, RGBColor color) {
         x_points, y_points, n,
         color.r * 255, color.g * 255, color.b * 255, 255
     );
-    free(x_points);
-    free(y_points);
 }
 
-void sdl_show(void) {
-    SDL_RenderPresent(renderer);
+void sdl_draw_polygon(List *points, RGBColor color) {
+    draw_polygon(points, color, NULL, 0);
 }
 
-void sdl_render_scene(Scene *scene) {
-    sdl_clear();
+/* Draws every body in a scene, interpolated by stepper if it is non-NULL */
+static void draw_bodies(Scene *scene, FixedStep *stepper) {
     size_t body_count = scene_bodies(scene);
     for (size_t i = 0; i < body_count; i++) {
         Body *body = scene_get_body(scene, i);
         List *shape = body_get_shape(body);
-        sdl_draw_polygon(shape, body_get_color(body));
+        draw_polygon(shape, body_get_color(body), stepper, i);
     }
-    sdl_show();
 }
 
+void sdl_show(void) {
+    SDL_RenderPresent(renderer);
+}
+
+void sdl_render_scene(Scene *scene) {
+    sdl_render_scene_interpolated(scene, NULL);
+}
+
+void sdl_render_scene_interpolated(Scene *scene, FixedStep *stepper) {
+    sdl_clear();
+    draw_bodies(scene, stepper);
+    sdl_show();
+}
 
 void sdl_render_game(GameInfo* game) {
+    sdl_render_game_interpolated(game, NULL);
+}
+
+void sdl_render_game_interpolated(GameInfo* game, FixedStep *stepper) {
     assert(game);
     sdl_clear();
 
@@ -257,13 +279,7 @@ void sdl_render_game(GameInfo* game) {
         Sprite* sprite = list_get(sprites, i);
         sdl_draw_sprite(sprite);
     }
-    Scene* scene = get_scene(game);
-    size_t body_count = scene_bodies(scene);
-    for (size_t i = 0; i < body_count; i++) {
-        Body *body = scene_get_body(scene, i);
-        List *shape = body_get_shape(body);
-        sdl_draw_polygon(shape, body_get_color(body));
-    }
+    draw_bodies(get_scene(game), stepper);
     sdl_show();
 }
 
@@ -273,10 +289,12 @@ void sdl_on_key(KeyHandler handler, void* aux) {
 }
 
 double time_since_last_tick(void) {
-    clock_t now = clock();
-    double difference = last_clock
-        ? (double) (now - last_clock) / CLOCKS_PER_SEC
-        : 0.0; // return 0 the first time this is called
-    last_clock = now;
+    // Wall-clock time, not clock()'s CPU time, which stalls while we wait
+    // on the display and races ahead when several threads are working
+    double now = timing_now();
+    double difference = isnan(last_tick)
+        ? 0.0 // return 0 the first time this is called
+        : now - last_tick;
+    last_tick = now;
     return difference;
 }
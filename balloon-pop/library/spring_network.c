@@ -0,0 +1,420 @@
+#include "spring_network.h"
+#include "array.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Implicit solves stop once the residual has shrunk by this factor
+#define CG_TOLERANCE 1e-10
+// Conjugate gradient converges in at most 2n steps in exact arithmetic
+#define CG_EXTRA_ITERATIONS 10
+
+/**
+ * A symmetric 2x2 matrix, e.g. the Jacobian of one spring's force
+ */
+typedef struct {
+    double xx;
+    double xy;
+    double yy;
+} SymMatrix;
+
+DEFINE_ARRAY(size_t)
+DEFINE_ARRAY(double)
+DEFINE_ARRAY(SymMatrix)
+
+struct spring_network {
+    Scene *scene;   // set by create_spring_network()
+    BodyPtrArray bodies;
+    doubleArray drag;       // per body
+
+    // One entry per spring
+    size_tArray first;
+    size_tArray second;
+    doubleArray k;
+    doubleArray rest_length;
+    doubleArray damping;
+
+    // Scratch space, kept between ticks so applying doesn't allocate
+    VectorArray positions;      // per body
+    VectorArray velocities;     // per body
+    VectorArray forces;         // per body
+    VectorArray spring_forces;  // per spring, on the first body
+
+    // Scratch space for implicit ticks
+    doubleArray masses;         // per body; 0 for immovable bodies
+    SymMatrixArray stiffness;   // per spring, d(force on first)/d(second)
+    SymMatrixArray coupling;    // per spring, h * damping + h^2 * stiffness
+    VectorArray rhs;            // per body, and so on for the solver
+    VectorArray dv;
+    VectorArray residual;
+    VectorArray direction;
+    VectorArray product;
+    VectorArray preconditioner;
+};
+
+#define BODY_SCRATCH_ARRAYS 9
+
+/* Collects the per-body Vector scratch arrays, which all grow together */
+static void body_scratch(
+    SpringNetwork *network, VectorArray *arrays[BODY_SCRATCH_ARRAYS]
+) {
+    VectorArray *all[BODY_SCRATCH_ARRAYS] = {
+        &network->positions, &network->velocities, &network->forces,
+        &network->rhs, &network->dv, &network->residual,
+        &network->direction, &network->product, &network->preconditioner
+    };
+    for (size_t i = 0; i < BODY_SCRATCH_ARRAYS; i++) {
+        arrays[i] = all[i];
+    }
+}
+
+SpringNetwork *spring_network_init(size_t initial_springs) {
+    SpringNetwork *network = malloc(sizeof(SpringNetwork));
+    assert(network);
+    network->scene = NULL;
+    BodyPtr_array_init(&network->bodies, 0);
+    double_array_init(&network->drag, 0);
+    size_t_array_init(&network->first, initial_springs);
+    size_t_array_init(&network->second, initial_springs);
+    double_array_init(&network->k, initial_springs);
+    double_array_init(&network->rest_length, initial_springs);
+    double_array_init(&network->damping, initial_springs);
+    VectorArray *scratch[BODY_SCRATCH_ARRAYS];
+    body_scratch(network, scratch);
+    for (size_t i = 0; i < BODY_SCRATCH_ARRAYS; i++) {
+        Vector_array_init(scratch[i], 0);
+    }
+    double_array_init(&network->masses, 0);
+    Vector_array_init(&network->spring_forces, initial_springs);
+    SymMatrix_array_init(&network->stiffness, 0);
+    SymMatrix_array_init(&network->coupling, 0);
+    return network;
+}
+
+void spring_network_free(SpringNetwork *network) {
+    assert(network);
+    BodyPtr_array_free(&network->bodies);
+    double_array_free(&network->drag);
+    size_t_array_free(&network->first);
+    size_t_array_free(&network->second);
+    double_array_free(&network->k);
+    double_array_free(&network->rest_length);
+    double_array_free(&network->damping);
+    VectorArray *scratch[BODY_SCRATCH_ARRAYS];
+    body_scratch(network, scratch);
+    for (size_t i = 0; i < BODY_SCRATCH_ARRAYS; i++) {
+        Vector_array_free(scratch[i]);
+    }
+    double_array_free(&network->masses);
+    Vector_array_free(&network->spring_forces);
+    SymMatrix_array_free(&network->stiffness);
+    SymMatrix_array_free(&network->coupling);
+    free(network);
+}
+
+size_t spring_network_add_body(SpringNetwork *network, Body *body) {
+    assert(network);
+    assert(body);
+    BodyPtr_array_add(&network->bodies, body);
+    double_array_add(&network->drag, 0);
+    // Per-body scratch only needs the right size; apply() overwrites it
+    VectorArray *scratch[BODY_SCRATCH_ARRAYS];
+    body_scratch(network, scratch);
+    for (size_t i = 0; i < BODY_SCRATCH_ARRAYS; i++) {
+        Vector_array_add(scratch[i], VEC_ZERO);
+    }
+    double_array_add(&network->masses, 0);
+    return BodyPtr_array_size(&network->bodies) - 1;
+}
+
+size_t spring_network_add_spring(
+    SpringNetwork *network, size_t body1, size_t body2,
+    double k, double rest_length, double damping
+) {
+    assert(network);
+    assert(body1 < spring_network_bodies(network));
+    assert(body2 < spring_network_bodies(network));
+    assert(body1 != body2);
+    size_t_array_add(&network->first, body1);
+    size_t_array_add(&network->second, body2);
+    double_array_add(&network->k, k);
+    double_array_add(&network->rest_length, rest_length);
+    double_array_add(&network->damping, damping);
+    Vector_array_add(&network->spring_forces, VEC_ZERO);
+    SymMatrix_array_add(&network->stiffness, (SymMatrix) {0, 0, 0});
+    SymMatrix_array_add(&network->coupling, (SymMatrix) {0, 0, 0});
+    return spring_network_springs(network) - 1;
+}
+
+void spring_network_set_drag(SpringNetwork *network, size_t body, double gamma) {
+    assert(network);
+    double_array_set(&network->drag, body, gamma);
+}
+
+size_t spring_network_bodies(SpringNetwork *network) {
+    assert(network);
+    return BodyPtr_array_size(&network->bodies);
+}
+
+size_t spring_network_springs(SpringNetwork *network) {
+    assert(network);
+    return size_t_array_size(&network->first);
+}
+
+/* Computes each body's total spring and drag force into network->forces */
+static void compute_forces(SpringNetwork *network) {
+    size_t n = spring_network_bodies(network);
+    size_t m = spring_network_springs(network);
+    Vector *positions = network->positions.data;
+    Vector *velocities = network->velocities.data;
+    Vector *forces = network->forces.data;
+    const double *drag = network->drag.data;
+
+    // Gather each body's state once, rather than once per spring
+    for (size_t b = 0; b < n; b++) {
+        Body *body = network->bodies.data[b];
+        positions[b] = body_get_centroid(body);
+        velocities[b] = body_get_velocity(body);
+        forces[b] = (Vector) {
+            -drag[b] * velocities[b].x, -drag[b] * velocities[b].y
+        };
+    }
+
+    // Every spring is independent here, so this loop can be vectorized
+    const size_t *first = network->first.data;
+    const size_t *second = network->second.data;
+    const double *k = network->k.data;
+    const double *rest_length = network->rest_length.data;
+    const double *damping = network->damping.data;
+    Vector *spring_forces = network->spring_forces.data;
+    for (size_t s = 0; s < m; s++) {
+        Vector p1 = positions[first[s]], p2 = positions[second[s]];
+        Vector v1 = velocities[first[s]], v2 = velocities[second[s]];
+        double dx = p2.x - p1.x, dy = p2.y - p1.y;
+        double distance = sqrt(dx * dx + dy * dy);
+        // Coincident endpoints have no direction to pull in
+        double inverse = distance > 0 ? 1 / distance : 0;
+        double ux = dx * inverse, uy = dy * inverse;
+        double stretch_rate = (v2.x - v1.x) * ux + (v2.y - v1.y) * uy;
+        double magnitude =
+            k[s] * (distance - rest_length[s]) + damping[s] * stretch_rate;
+        spring_forces[s] = (Vector) {magnitude * ux, magnitude * uy};
+    }
+
+    // Scatter; springs sharing a body would conflict in the loop above
+    for (size_t s = 0; s < m; s++) {
+        forces[first[s]].x += spring_forces[s].x;
+        forces[first[s]].y += spring_forces[s].y;
+        forces[second[s]].x -= spring_forces[s].x;
+        forces[second[s]].y -= spring_forces[s].y;
+    }
+}
+
+static Vector sym_multiply(SymMatrix a, Vector v) {
+    return (Vector) {a.xx * v.x + a.xy * v.y, a.xy * v.x + a.yy * v.y};
+}
+
+/*
+ * Fills in each spring's force Jacobians for a tick of length h.
+ * The stiffness term across the spring is clamped at zero when it is
+ * compressed, which keeps the system positive definite.
+ */
+static void compute_jacobians(SpringNetwork *network, double h) {
+    size_t m = spring_network_springs(network);
+    const Vector *positions = network->positions.data;
+    const size_t *first = network->first.data;
+    const size_t *second = network->second.data;
+    const double *k = network->k.data;
+    const double *rest_length = network->rest_length.data;
+    const double *damping = network->damping.data;
+    SymMatrix *stiffness = network->stiffness.data;
+    SymMatrix *coupling = network->coupling.data;
+    for (size_t s = 0; s < m; s++) {
+        Vector p1 = positions[first[s]], p2 = positions[second[s]];
+        double dx = p2.x - p1.x, dy = p2.y - p1.y;
+        double distance = sqrt(dx * dx + dy * dy);
+        double inverse = distance > 0 ? 1 / distance : 0;
+        double ux = dx * inverse, uy = dy * inverse;
+        double across;
+        if (distance > 0) {
+            across = fmax(0, 1 - rest_length[s] * inverse);
+        } else {
+            // A zero-length spring pulls the same way in every direction
+            across = rest_length[s] == 0 ? 1 : 0;
+        }
+        double along = 1 - across;
+        stiffness[s] = (SymMatrix) {
+            k[s] * (across + along * ux * ux),
+            k[s] * along * ux * uy,
+            k[s] * (across + along * uy * uy)
+        };
+        coupling[s] = (SymMatrix) {
+            h * damping[s] * ux * ux + h * h * stiffness[s].xx,
+            h * damping[s] * ux * uy + h * h * stiffness[s].xy,
+            h * damping[s] * uy * uy + h * h * stiffness[s].yy
+        };
+    }
+}
+
+/*
+ * Computes (M - h D - h^2 K) p, where D and K are the Jacobians of the
+ * network's forces with respect to velocity and position.
+ * Rows for immovable bodies are zero, so they stay put.
+ */
+static void system_multiply(
+    SpringNetwork *network, double h, const Vector *p, Vector *result
+) {
+    size_t n = spring_network_bodies(network);
+    size_t m = spring_network_springs(network);
+    const double *masses = network->masses.data;
+    const double *drag = network->drag.data;
+    for (size_t b = 0; b < n; b++) {
+        double diagonal = masses[b] + h * drag[b];
+        result[b] = (Vector) {diagonal * p[b].x, diagonal * p[b].y};
+    }
+    const size_t *first = network->first.data;
+    const size_t *second = network->second.data;
+    const SymMatrix *coupling = network->coupling.data;
+    for (size_t s = 0; s < m; s++) {
+        Vector d = vec_subtract(p[second[s]], p[first[s]]);
+        Vector q = sym_multiply(coupling[s], d);
+        result[first[s]] = vec_subtract(result[first[s]], q);
+        result[second[s]] = vec_add(result[second[s]], q);
+    }
+    for (size_t b = 0; b < n; b++) {
+        if (masses[b] == 0) {
+            result[b] = VEC_ZERO;
+        }
+    }
+}
+
+static double dot_all(const Vector *a, const Vector *b, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += a[i].x * b[i].x + a[i].y * b[i].y;
+    }
+    return sum;
+}
+
+/*
+ * One backward Euler step for the network's forces:
+ * solves (M - h D - h^2 K) dv = h (f + h K v) with preconditioned
+ * conjugate gradient, then applies M dv to each body as an impulse.
+ */
+static void apply_implicit(SpringNetwork *network, double h) {
+    size_t n = spring_network_bodies(network);
+    size_t m = spring_network_springs(network);
+    double *masses = network->masses.data;
+    for (size_t b = 0; b < n; b++) {
+        double mass = body_get_mass(network->bodies.data[b]);
+        masses[b] = mass == INFINITY ? 0 : mass;
+    }
+    compute_jacobians(network, h);
+
+    // rhs = h * (f + h K v), using the velocities gathered by compute_forces()
+    const Vector *velocities = network->velocities.data;
+    const Vector *forces = network->forces.data;
+    const size_t *first = network->first.data;
+    const size_t *second = network->second.data;
+    const SymMatrix *stiffness = network->stiffness.data;
+    const SymMatrix *coupling = network->coupling.data;
+    Vector *rhs = network->rhs.data;
+    Vector *preconditioner = network->preconditioner.data;
+    for (size_t b = 0; b < n; b++) {
+        rhs[b] = vec_multiply(h, forces[b]);
+        double diagonal = masses[b] + h * network->drag.data[b];
+        preconditioner[b] = (Vector) {diagonal, diagonal};
+    }
+    for (size_t s = 0; s < m; s++) {
+        Vector dv = vec_subtract(velocities[second[s]], velocities[first[s]]);
+        Vector kv = vec_multiply(h * h, sym_multiply(stiffness[s], dv));
+        rhs[first[s]] = vec_add(rhs[first[s]], kv);
+        rhs[second[s]] = vec_subtract(rhs[second[s]], kv);
+        Vector diagonal = {coupling[s].xx, coupling[s].yy};
+        preconditioner[first[s]] = vec_add(preconditioner[first[s]], diagonal);
+        preconditioner[second[s]] = vec_add(preconditioner[second[s]], diagonal);
+    }
+    for (size_t b = 0; b < n; b++) {
+        if (masses[b] == 0) {
+            rhs[b] = VEC_ZERO;
+            preconditioner[b] = (Vector) {0, 0};
+        } else {
+            preconditioner[b] = (Vector) {
+                1 / preconditioner[b].x, 1 / preconditioner[b].y
+            };
+        }
+    }
+
+    // Preconditioned conjugate gradient, starting from dv = 0
+    Vector *x = network->dv.data;
+    Vector *r = network->residual.data;
+    Vector *p = network->direction.data;
+    Vector *ap = network->product.data;
+    for (size_t b = 0; b < n; b++) {
+        x[b] = VEC_ZERO;
+        r[b] = rhs[b];
+        p[b] = (Vector) {
+            preconditioner[b].x * r[b].x, preconditioner[b].y * r[b].y
+        };
+    }
+    double rz = dot_all(r, p, n);
+    double threshold = CG_TOLERANCE * CG_TOLERANCE * dot_all(rhs, rhs, n);
+    size_t max_iterations = 2 * n + CG_EXTRA_ITERATIONS;
+    for (size_t i = 0; i < max_iterations && dot_all(r, r, n) > threshold; i++) {
+        system_multiply(network, h, p, ap);
+        double pap = dot_all(p, ap, n);
+        if (pap <= 0) {
+            break;
+        }
+        double alpha = rz / pap;
+        for (size_t b = 0; b < n; b++) {
+            x[b] = vec_add(x[b], vec_multiply(alpha, p[b]));
+            r[b] = vec_subtract(r[b], vec_multiply(alpha, ap[b]));
+        }
+        // Reuse ap to hold the preconditioned residual
+        Vector *z = ap;
+        for (size_t b = 0; b < n; b++) {
+            z[b] = (Vector) {
+                preconditioner[b].x * r[b].x, preconditioner[b].y * r[b].y
+            };
+        }
+        double rz_next = dot_all(r, z, n);
+        double beta = rz_next / rz;
+        rz = rz_next;
+        for (size_t b = 0; b < n; b++) {
+            p[b] = vec_add(z[b], vec_multiply(beta, p[b]));
+        }
+    }
+
+    for (size_t b = 0; b < n; b++) {
+        if (masses[b] != 0) {
+            body_add_impulse(network->bodies.data[b],
+                vec_multiply(masses[b], x[b]));
+        }
+    }
+}
+
+void spring_network_apply(void *aux) {
+    SpringNetwork *network = aux;
+    compute_forces(network);
+    Scene *scene = network->scene;
+    if (scene && scene_get_implicit_springs(scene) && scene_get_dt(scene) > 0) {
+        apply_implicit(network, scene_get_dt(scene));
+        return;
+    }
+    for (size_t b = 0; b < spring_network_bodies(network); b++) {
+        body_add_force(network->bodies.data[b], network->forces.data[b]);
+    }
+}
+
+static void spring_network_freer(void *network) {
+    spring_network_free(network);
+}
+
+void create_spring_network(Scene *scene, SpringNetwork *network) {
+    assert(scene);
+    assert(network);
+    network->scene = scene;
+    scene_add_body_array_force_creator(scene, spring_network_apply, network, \
+        &network->bodies, spring_network_freer);
+}
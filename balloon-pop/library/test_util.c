@@ -8,6 +8,16 @@
 #include <unistd.h>
 
 #define DEFAULT_EPSILON 1e-7
+/*
+ * Floats round every vector operation to about 1e-7 of its size, which adds
+ * up over a simulation, so float builds also allow this much error relative
+ * to the values compared (absolute for values below 1)
+ */
+#ifdef SCALAR_FLOAT
+#define SCALAR_SLACK 1e-4
+#else
+#define SCALAR_SLACK 0
+#endif
 
 bool isclose(double d1, double d2) {
     return within(DEFAULT_EPSILON, d1, d2);
@@ -22,7 +32,8 @@ bool vec_isclose(Vector v1, Vector v2) {
 }
 
 bool within(double epsilon, double d1, double d2) {
-    return fabs(d1 - d2) < epsilon;
+    double size = fmax(1, fmax(fabs(d1), fabs(d2)));
+    return fabs(d1 - d2) < epsilon + SCALAR_SLACK * size;
 }
 
 bool vec_within(double epsilon, Vector v1, Vector v2) {
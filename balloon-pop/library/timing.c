@@ -0,0 +1,120 @@
+#include "timing.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+struct frame_timer {
+    double period;      // seconds per frame, or 0 to not pace
+    double deadline;    // when the next frame is due
+    double last_tick;   // when frame_timer_tick() last returned, or NAN
+    // Stats since the last reset
+    size_t frames;
+    double total;
+    double min;
+    double max;
+    double busy;
+};
+
+double timing_now(void) {
+    struct timespec now;
+    int error = clock_gettime(CLOCK_MONOTONIC, &now);
+    assert(error == 0);
+    return now.tv_sec + (double) now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+/* Sleeps until the monotonic clock reads time, even if interrupted */
+static void sleep_until(double time) {
+    struct timespec deadline;
+    deadline.tv_sec = (time_t) time;
+    deadline.tv_nsec = (long) ((time - deadline.tv_sec) * NANOSECONDS_PER_SECOND);
+    if (deadline.tv_nsec >= NANOSECONDS_PER_SECOND) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= NANOSECONDS_PER_SECOND;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+        == EINTR) {}
+}
+
+FrameTimer *frame_timer_init(double target_fps) {
+    assert(target_fps >= 0);
+    FrameTimer *timer = malloc(sizeof(FrameTimer));
+    assert(timer);
+    timer->period = target_fps > 0 ? 1 / target_fps : 0;
+    timer->deadline = NAN;
+    timer->last_tick = NAN;
+    frame_timer_reset_stats(timer);
+    return timer;
+}
+
+void frame_timer_free(FrameTimer *timer) {
+    assert(timer);
+    free(timer);
+}
+
+double frame_timer_tick(FrameTimer *timer) {
+    assert(timer);
+    double start = timing_now();
+    if (isnan(timer->last_tick)) {
+        // The first frame starts now; nothing to measure yet
+        timer->last_tick = start;
+        timer->deadline = start + timer->period;
+        return 0;
+    }
+    double busy = start - timer->last_tick;
+    bool late = start >= timer->deadline;
+    if (timer->period > 0 && !late) {
+        sleep_until(timer->deadline);
+    }
+    double now = timing_now();
+    // Running late starts the schedule over, rather than rushing to catch up
+    timer->deadline = late ? now + timer->period
+        : timer->deadline + timer->period;
+    double frame = now - timer->last_tick;
+    timer->last_tick = now;
+
+    timer->frames++;
+    timer->total += frame;
+    timer->busy += busy;
+    timer->min = timer->frames == 1 || frame < timer->min ? frame : timer->min;
+    timer->max = frame > timer->max ? frame : timer->max;
+    return frame;
+}
+
+size_t frame_timer_frames(FrameTimer *timer) {
+    assert(timer);
+    return timer->frames;
+}
+
+double frame_timer_mean(FrameTimer *timer) {
+    assert(timer);
+    return timer->frames > 0 ? timer->total / timer->frames : 0;
+}
+
+double frame_timer_min(FrameTimer *timer) {
+    assert(timer);
+    return timer->min;
+}
+
+double frame_timer_max(FrameTimer *timer) {
+    assert(timer);
+    return timer->max;
+}
+
+double frame_timer_busy(FrameTimer *timer) {
+    assert(timer);
+    return timer->frames > 0 ? timer->busy / timer->frames : 0;
+}
+
+void frame_timer_reset_stats(FrameTimer *timer) {
+    assert(timer);
+    timer->frames = 0;
+    timer->total = 0;
+    timer->min = 0;
+    timer->max = 0;
+    timer->busy = 0;
+}
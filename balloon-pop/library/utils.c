@@ -1,16 +1,11 @@
 #include "utils.h"
 #include "list.h"
+#include "det_math.h"
 #include <math.h>
 #include <stdlib.h>
 
 const double CLOSENESS = 6;
 
-void initialize_window(Vector dimensions) {
-    Vector bottom_left = vec_multiply(-0.5, dimensions);
-    Vector top_right = vec_multiply(0.5, dimensions);
-    sdl_init(bottom_left, top_right);
-}
-
 Scene* initialize_scene(void) {
     Scene* scene = scene_init();
     return scene;
@@ -39,16 +34,21 @@ List* get_arrow_points(Vector pivot, double width, double height, double arrow_l
 }
 
 List* get_rectangle(Vector center, double width, double height) {
+    return get_rectangle_arena(center, width, height, NULL);
+}
+
+List* get_rectangle_arena(Vector center, double width, double height, \
+    Arena *arena) {
     size_t number_pts = 4;
-    List* points = list_init(number_pts, vector_free);
+    List* points = list_init_arena(number_pts, vector_free, arena);
     Vector top_left = (Vector){center.x - width/2, center.y + height/2};
     Vector bottom_left = (Vector){center.x - width/2, center.y - height/2};
     Vector top_right = (Vector){center.x + width/2, center.y + height/2};
     Vector bottom_right = (Vector){center.x + width/2, center.y - height/2};
-    list_add(points, create_vector_p(top_left));
-    list_add(points, create_vector_p(bottom_left));
-    list_add(points, create_vector_p(bottom_right));
-    list_add(points, create_vector_p(top_right));
+    list_add(points, create_vector_arena(top_left, arena));
+    list_add(points, create_vector_arena(bottom_left, arena));
+    list_add(points, create_vector_arena(bottom_right, arena));
+    list_add(points, create_vector_arena(top_right, arena));
     return points;
 }
 
@@ -61,8 +61,8 @@ List* get_partial_circle(double radius, int begin, int end, Vector center) {
     list_add(points, create_vector_p(center));
     for (size_t i = begin * number_pts / circle_sections; \
         i < end * number_pts / circle_sections; i++) {
-        Vector vertex = {center.x + radius * cos(i * angle), center.y + \
-            radius *sin(i * angle)};
+        Vector vertex = {center.x + radius * math_cos(i * angle), center.y + \
+            radius *math_sin(i * angle)};
         list_add(points , create_vector_p(vertex));
     }
     return points;
@@ -75,32 +75,37 @@ List* get_oval_points(Vector center, double x_span, double y_span) {
     double height = y_span / 2;
     double width = x_span / 2;
     for (size_t i = 0; i < number_pts; i++) {
-          Vector vertex = {center.x + width * cos(i * angle), center.y + \
-              height * sin(i * angle)};
+          Vector vertex = {center.x + width * math_cos(i * angle), center.y + \
+              height * math_sin(i * angle)};
           list_add(points , create_vector_p(vertex));
       }
     return points;
 }
 
 List* get_bloon_points(Vector center, double x_span, double y_span) {
+    return get_bloon_points_arena(center, x_span, y_span, NULL);
+}
+
+List* get_bloon_points_arena(Vector center, double x_span, double y_span, \
+    Arena *arena) {
     size_t number_pts = 104;
-    List* points = list_init(number_pts, vector_free);
+    List* points = list_init_arena(number_pts + 1, vector_free, arena);
     double angle = 2 * M_PI / number_pts;
     double height = y_span / 2;
     double width = x_span / 2;
     for (size_t i = 0; i < number_pts; i++) {
       if (i != 78) {
-          Vector vertex = {center.x + width * cos(i * angle), center.y + \
-              height * sin(i * angle)};
-          list_add(points , create_vector_p(vertex));
+          Vector vertex = {center.x + width * math_cos(i * angle), center.y + \
+              height * math_sin(i * angle)};
+          list_add(points , create_vector_arena(vertex, arena));
         }
       else {
-        Vector vertex1 = {center.x + width * cos(i * angle) - (x_span / 8), center.y + \
-            height * sin(i * angle) - (y_span / 10)};
-          list_add(points , create_vector_p(vertex1));
-        Vector vertex2 = {center.x + width * cos(i * angle) + (x_span / 8), center.y + \
-              height * sin(i * angle) - (y_span / 10)};
-            list_add(points , create_vector_p(vertex2));
+        Vector vertex1 = {center.x + width * math_cos(i * angle) - (x_span / 8), center.y + \
+            height * math_sin(i * angle) - (y_span / 10)};
+          list_add(points , create_vector_arena(vertex1, arena));
+        Vector vertex2 = {center.x + width * math_cos(i * angle) + (x_span / 8), center.y + \
+              height * math_sin(i * angle) - (y_span / 10)};
+            list_add(points , create_vector_arena(vertex2, arena));
       }
     }
     return points;
@@ -237,14 +242,14 @@ List *get_star_points(size_t num_of_points, double radius, Vector center) {
   double vertex_shift = M_PI / num_of_points;
 
   for (size_t i = 0; i < num_of_points; i++) {
-    Vector outer_vertex = vec_init(cos(angle), sin(angle));
+    Vector outer_vertex = vec_init(math_cos(angle), math_sin(angle));
     Vector update_vec1 = vec_multiply(radius, outer_vertex);
     /* update_vec2 is the vector that adds the inner vertices. This is
      * accomplished by having update_vec1 and update_vec2 being offset by
      * pi / num_of_points
      */
-    Vector inner_vertex = vec_init(cos(angle + vertex_shift), \
-             sin(angle + vertex_shift));
+    Vector inner_vertex = vec_init(math_cos(angle + vertex_shift), \
+             math_sin(angle + vertex_shift));
     Vector update_vec2 = vec_multiply(2 * radius / num_of_points, inner_vertex);
     /* the vertices are 2 * pi / num_of_points rads apart */
     angle += 2 * M_PI / num_of_points;
@@ -1,4 +1,5 @@
 #include "vector.h"
+#include "det_math.h"
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
@@ -8,7 +9,7 @@ const Vector VEC_ZERO = {
   .y = 0
 };
 
-Vector vec_init(double x, double y) {
+Vector vec_init(Scalar x, Scalar y) {
   Vector vec = {
     .x = x,
     .y = y
@@ -23,20 +24,29 @@ Vector *create_vector_p(Vector v) {
   return new_vec;
 }
 
+Vector *create_vector_arena(Vector v, Arena *arena) {
+  if (!arena) {
+    return create_vector_p(v);
+  }
+  Vector *new_vec = arena_alloc(arena, sizeof(Vector));
+  *new_vec = v;
+  return new_vec;
+}
+
 void vector_free(void *v) {
   assert(v);
   free(v);
 }
 
 Vector vec_add(Vector v1, Vector v2) {
-  double sum_x = v1.x + v2.x;
-  double sum_y = v1.y + v2.y;
+  Scalar sum_x = v1.x + v2.x;
+  Scalar sum_y = v1.y + v2.y;
   return vec_init(sum_x, sum_y);
 }
 
 Vector vec_subtract(Vector v1, Vector v2) {
-  double difference_x = v1.x - v2.x;
-  double difference_y = v1.y - v2.y;
+  Scalar difference_x = v1.x - v2.x;
+  Scalar difference_y = v1.y - v2.y;
   return vec_init(difference_x, difference_y);
 }
 
@@ -44,16 +54,16 @@ Vector vec_negate(Vector v) {
   return vec_init(v.x * -1, v.y * -1);
 }
 
-Vector vec_multiply(double scalar, Vector v) {
+Vector vec_multiply(Scalar scalar, Vector v) {
   return vec_init(v.x * scalar, v.y * scalar);
 }
 
-double vec_dot(Vector v1, Vector v2) {
+Scalar vec_dot(Vector v1, Vector v2) {
   /* The dot product formula is x1 * x2 + y1 * y2 */
   return v1.x * v2.x + v1.y * v2.y;
 }
 
-double vec_cross(Vector v1, Vector v2) {
+Scalar vec_cross(Vector v1, Vector v2) {
   /**
    * The cross product formula for 2D vectors on the same axis is
    * x1 * y2 - y1 * x2
@@ -67,8 +77,8 @@ Vector vec_rotate(Vector v, double angle) {
    * which has the form [[cos(a), -sin(a)], [sin(a), cos(a)]] where a is
    * the desired angle of rotation.
    */
-  double sin_v = sin(angle);
-  double cos_v = cos(angle);
+  double sin_v = math_sin(angle);
+  double cos_v = math_cos(angle);
   return vec_init(cos_v * v.x + -sin_v * v.y, sin_v * v.x + cos_v * v.y);
 }
 
@@ -78,16 +88,16 @@ Vector vec_projection(Vector v1, Vector v2) {
 }
 
 Vector vec_unit_vector(Vector v1) {
-    double magnitude = vec_magnitude(v1);
+    Scalar magnitude = vec_magnitude(v1);
     // Divide each component of the vector by the magnitude
     return vec_multiply(1 / magnitude, v1);
 }
 
-double vec_distance(Vector v1, Vector v2) {
+Scalar vec_distance(Vector v1, Vector v2) {
     return vec_magnitude(vec_subtract(v2, v1));
 }
 
-double vec_magnitude(Vector v) {
+Scalar vec_magnitude(Vector v) {
     return sqrt(v.x * v.x + v.y * v.y);
 }
 
@@ -96,7 +106,7 @@ double vec_angle(Vector v) {
     if (v.y == 0) return v.x > 0 ? 0 : M_PI;
     double tan_theta = v.y/v.x;
     if (v.x < 0) {
-        return M_PI + atan(tan_theta);
+        return M_PI + math_atan(tan_theta);
     }
-    return atan(tan_theta);
+    return math_atan(tan_theta);
 }
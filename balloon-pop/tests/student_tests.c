@@ -34,8 +34,8 @@ double kinetic_energy(Body *body) {
 void test_energy_conservation_with_drag() {
     const double M1 = 4.5, M2 = 7.3;
     const double G = 1e3;
-    const double DT = 1e-6;
-    const int STEPS = 1000000;
+    const double DT = TEST_DT;
+    const int STEPS = TEST_STEPS;
     const double TAU = .4;
     Scene *scene = scene_init();
     Body *mass1 = body_init(make_shape(), M1, (RGBColor) {0, 0, 0});
@@ -53,7 +53,7 @@ void test_energy_conservation_with_drag() {
         double work = vec_magnitude(body_get_velocity(mass1)) * TAU * vec_distance(current_centroid, last_centroid);
         double current_energy = gravity_potential(G, mass1, mass2) +
           kinetic_energy(mass1) + kinetic_energy(mass2);
-        assert(within(1e-4, last_energy-current_energy, work));
+        assert(within(1e-4, current_energy, last_energy - work));
 
         last_energy = current_energy;
         last_centroid = current_centroid;
@@ -61,13 +61,20 @@ void test_energy_conservation_with_drag() {
     scene_free(scene);
 }
 
+// In double, so float builds still see the first, tiny moves
+double centroid_distance(Body *body1, Body *body2) {
+    Vector c1 = body_get_centroid(body1), c2 = body_get_centroid(body2);
+    double dx = (double) c1.x - c2.x, dy = (double) c1.y - c2.y;
+    return sqrt(dx * dx + dy * dy);
+}
+
 void test_newtonian_gravity() {
     const double M1 = 4.5, M2 = 7.3;
-    const double DT = 1e-6;
+    const double DT = TEST_DT;
     const double G = 1e3;
-    const int STEPS1 = 1000000;
-    const int STEPS2 = 1500000;
-    const int STEPS3 = 2000000;
+    const int STEPS1 = TEST_STEPS;
+    const int STEPS2 = 3 * TEST_STEPS / 2;
+    const int STEPS3 = 2 * TEST_STEPS;
     Scene *scene = scene_init();
     Body *mass1 = body_init(make_shape(), M1, (RGBColor) {0, 0, 0});
     body_set_velocity(mass1, VEC_ZERO);
@@ -77,13 +84,13 @@ void test_newtonian_gravity() {
     body_set_centroid(mass2, (Vector) {10, 20});
     body_set_velocity(mass2, VEC_ZERO);
     scene_add_body(scene, mass2);
-    double last_distance = vec_distance(body_get_centroid(mass1), body_get_centroid(mass2));
+    double last_distance = centroid_distance(mass1, mass2);
     create_newtonian_gravity(scene, G, mass1, mass2);
     size_t i = 0;
 
     for (i = 0; i < STEPS1; i++) {
         scene_tick(scene, DT);
-        double current_distance = vec_distance(body_get_centroid(mass1), body_get_centroid(mass2));
+        double current_distance = centroid_distance(mass1, mass2);
         assert(current_distance < last_distance);
         last_distance = current_distance;
     }
@@ -92,10 +99,10 @@ void test_newtonian_gravity() {
         scene_tick(scene, DT);
     }
 
-    last_distance = vec_distance(body_get_centroid(mass1), body_get_centroid(mass2));
+    last_distance = centroid_distance(mass1, mass2);
     while (++i < STEPS3) {
         scene_tick(scene, DT);
-        double current_distance = vec_distance(body_get_centroid(mass1), body_get_centroid(mass2));
+        double current_distance = centroid_distance(mass1, mass2);
         assert(current_distance > last_distance);
         last_distance = current_distance;
     }
@@ -106,8 +113,8 @@ void test_newtonian_gravity() {
 void test_drag() {
     const double M = 10;
     const double A = 3;
-    const double DT = 1e-6;
-    const int STEPS = 1000000;
+    const double DT = TEST_DT;
+    const int STEPS = TEST_STEPS;
     Scene *scene = scene_init();
     Body *mass = body_init(make_shape(), M, (RGBColor) {0, 0, 0});
     body_set_centroid(mass, (Vector) {A, 0});
@@ -128,8 +135,8 @@ void test_drag() {
 void test_zero_drag_no_slow_down() {
     const double M = 10;
     const double A = 3;
-    const double DT = 1e-6;
-    const int STEPS = 1000000;
+    const double DT = TEST_DT;
+    const int STEPS = TEST_STEPS;
     Scene *scene = scene_init();
     Body *mass = body_init(make_shape(), M, (RGBColor) {0, 0, 0});
     body_set_centroid(mass, (Vector) {A, 0});
@@ -148,6 +155,181 @@ void test_zero_drag_no_slow_down() {
     scene_free(scene);
 }
 
+/* Builds two identical scenes of N bodies scattered over a 1000x1000 box */
+void make_cluster_scenes(Scene *scenes[2], size_t n) {
+    srand(3);
+    scenes[0] = scene_init();
+    scenes[1] = scene_init();
+    for (size_t i = 0; i < n; i++) {
+        Vector position = {rand() % 1000, rand() % 1000};
+        double mass = 1 + rand() % 10;
+        for (int s = 0; s < 2; s++) {
+            Body *body = body_init(make_shape(), mass, (RGBColor) {0, 0, 0});
+            body_set_centroid(body, position);
+            scene_add_body(scenes[s], body);
+        }
+    }
+}
+
+void test_barnes_hut_exact_with_zero_theta() {
+    const double G = 1e3;
+    const size_t N = 60;
+    Scene *scenes[2];
+    make_cluster_scenes(scenes, N);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            create_newtonian_gravity(scenes[0], G,
+                scene_get_body(scenes[0], i), scene_get_body(scenes[0], j));
+        }
+    }
+    create_barnes_hut_gravity(scenes[1], G, 0);
+    assert(scene_forces(scenes[1]) == 1);
+    for (int step = 0; step < 10; step++) {
+        scene_tick(scenes[0], 1e-2);
+        scene_tick(scenes[1], 1e-2);
+    }
+    for (size_t i = 0; i < N; i++) {
+        Vector v1 = body_get_velocity(scene_get_body(scenes[0], i));
+        Vector v2 = body_get_velocity(scene_get_body(scenes[1], i));
+        assert(vec_within(1e-9 * (1 + vec_magnitude(v1)), v1, v2));
+    }
+    scene_free(scenes[0]);
+    scene_free(scenes[1]);
+}
+
+void test_barnes_hut_approximation() {
+    const double G = 1e3;
+    const size_t N = 300;
+    Scene *scenes[2];
+    make_cluster_scenes(scenes, N);
+    create_barnes_hut_gravity(scenes[0], G, 0);
+    create_barnes_hut_gravity(scenes[1], G, 0.5);
+    scene_tick(scenes[0], 1e-2);
+    scene_tick(scenes[1], 1e-2);
+    // The approximation should be close in aggregate
+    double error = 0, total = 0;
+    for (size_t i = 0; i < N; i++) {
+        Vector exact = body_get_velocity(scene_get_body(scenes[0], i));
+        Vector approx = body_get_velocity(scene_get_body(scenes[1], i));
+        error += vec_magnitude(vec_subtract(exact, approx));
+        total += vec_magnitude(exact);
+    }
+    assert(total > 0);
+    assert(error / total < 0.05);
+    scene_free(scenes[0]);
+    scene_free(scenes[1]);
+}
+
+void test_barnes_hut_ignores_infinite_mass() {
+    Scene *scene = scene_init();
+    Body *wall = body_init(make_shape(), INFINITY, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, wall);
+    Body *ball = body_init(make_shape(), 1, (RGBColor) {0, 0, 0});
+    body_set_centroid(ball, (Vector) {100, 0});
+    scene_add_body(scene, ball);
+    create_barnes_hut_gravity(scene, 1e3, 0.5);
+    scene_tick(scene, 1);
+    assert(vec_equal(body_get_velocity(ball), VEC_ZERO));
+    scene_free(scene);
+}
+
+void test_particle_mesh_pair() {
+    const double G = 1e3;
+    const double DISTANCE = 500;
+    Scene *scene = scene_init();
+    Body *body1 = body_init(make_shape(), 2, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, body1);
+    Body *body2 = body_init(make_shape(), 3, (RGBColor) {0, 0, 0});
+    body_set_centroid(body2, (Vector) {DISTANCE * 0.6, DISTANCE * 0.8});
+    scene_add_body(scene, body2);
+    create_particle_mesh_gravity(scene, G, 64);
+    assert(scene_forces(scene) == 1);
+    scene_tick(scene, 1);
+    // Momentum is conserved, and well-separated bodies feel G m1 m2 / r^2
+    Vector p1 = vec_multiply(2, body_get_velocity(body1));
+    Vector p2 = vec_multiply(3, body_get_velocity(body2));
+    double expected = G * 2 * 3 / (DISTANCE * DISTANCE);
+    assert(vec_within(1e-9 * expected, vec_add(p1, p2), VEC_ZERO));
+    assert(within(0.01 * expected, vec_magnitude(p1), expected));
+    assert(vec_within(0.01 * expected, p1,
+        (Vector) {0.6 * expected, 0.8 * expected}));
+    scene_free(scene);
+}
+
+void test_particle_mesh_approximation() {
+    const double G = 1e3;
+    const size_t N = 300;
+    Scene *scenes[2];
+    make_cluster_scenes(scenes, N);
+    create_barnes_hut_gravity(scenes[0], G, 0);
+    create_particle_mesh_gravity(scenes[1], G, 512);
+    scene_tick(scenes[0], 1e-2);
+    scene_tick(scenes[1], 1e-2);
+    double error = 0, total = 0;
+    Vector momentum = VEC_ZERO;
+    for (size_t i = 0; i < N; i++) {
+        Body *body = scene_get_body(scenes[1], i);
+        Vector exact = body_get_velocity(scene_get_body(scenes[0], i));
+        Vector approx = body_get_velocity(body);
+        error += vec_magnitude(vec_subtract(exact, approx));
+        total += vec_magnitude(exact);
+        momentum = vec_add(momentum,
+            vec_multiply(body_get_mass(body), approx));
+    }
+    assert(total > 0);
+    assert(error / total < 0.1);
+    // Spreading and gathering with the same weights conserves momentum
+    assert(vec_within(1e-9, momentum, VEC_ZERO));
+    scene_free(scenes[0]);
+    scene_free(scenes[1]);
+}
+
+void test_uniform_gravity() {
+    const double DT = 1e-3;
+    const int STEPS = 1000;
+    const Vector GRAVITY = {0, -9.8};
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    assert(vec_equal(scene_get_gravity(scene), GRAVITY));
+    Body *ball = body_init(make_shape(), 2, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, ball);
+    Body *wall = body_init(make_shape(), INFINITY, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, wall);
+    for (int i = 0; i < STEPS; i++) {
+        scene_tick(scene, DT);
+    }
+    // Constant acceleration is integrated exactly: y = g t^2 / 2
+    double t = DT * STEPS;
+    assert(vec_within(1e-9, body_get_velocity(ball), vec_multiply(t, GRAVITY)));
+    assert(vec_within(1e-9, body_get_centroid(ball),
+        vec_multiply(t * t / 2, GRAVITY)));
+    assert(vec_equal(body_get_centroid(wall), VEC_ZERO));
+    scene_free(scene);
+}
+
+void test_role_gravity() {
+    Scene *scene = scene_init();
+    scene_set_role_gravity(scene, PLAYER, (Vector) {0, -10});
+    Role *role = malloc(sizeof(Role));
+    *role = PLAYER;
+    Body *dart = body_init_with_info(make_shape(), 1, (RGBColor) {0, 0, 0},
+        role, free);
+    scene_add_body(scene, dart);
+    role = malloc(sizeof(Role));
+    *role = REMOVE_ON_COLLISION;
+    Body *balloon = body_init_with_info(make_shape(), 1, (RGBColor) {0, 0, 0},
+        role, free);
+    scene_add_body(scene, balloon);
+    // No info, so no role: falls in the scene-wide field, which is zero
+    Body *bar = body_init(make_shape(), 1, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, bar);
+    scene_tick(scene, 1);
+    assert(vec_isclose(body_get_velocity(dart), (Vector) {0, -10}));
+    assert(vec_equal(body_get_velocity(balloon), VEC_ZERO));
+    assert(vec_equal(body_get_velocity(bar), VEC_ZERO));
+    scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
     // Run all tests if there are no command-line arguments
     bool all_tests = argc == 1;
@@ -161,6 +343,13 @@ int main(int argc, char *argv[]) {
     DO_TEST(test_newtonian_gravity)
     DO_TEST(test_drag)
     DO_TEST(test_zero_drag_no_slow_down)
+    DO_TEST(test_barnes_hut_exact_with_zero_theta)
+    DO_TEST(test_barnes_hut_approximation)
+    DO_TEST(test_barnes_hut_ignores_infinite_mass)
+    DO_TEST(test_particle_mesh_pair)
+    DO_TEST(test_particle_mesh_approximation)
+    DO_TEST(test_uniform_gravity)
+    DO_TEST(test_role_gravity)
 
     puts("forces_test PASS");
     return 0;
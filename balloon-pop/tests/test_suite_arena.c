@@ -0,0 +1,132 @@
+#include "arena.h"
+#include "forces.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+List *make_shape(Arena *arena) {
+    List *shape = list_init_arena(4, free, arena);
+    list_add(shape, create_vector_arena((Vector) {-1, -1}, arena));
+    list_add(shape, create_vector_arena((Vector) {+1, -1}, arena));
+    list_add(shape, create_vector_arena((Vector) {+1, +1}, arena));
+    list_add(shape, create_vector_arena((Vector) {-1, +1}, arena));
+    return shape;
+}
+
+void test_arena_alloc() {
+    Arena *arena = arena_init(64);
+    assert(arena_used(arena) == 0);
+    // Blocks are aligned and don't overlap
+    char *a = arena_alloc(arena, 3);
+    double *b = arena_alloc(arena, sizeof(double));
+    assert((uintptr_t) b % sizeof(double) == 0);
+    assert((char *) b >= a + 3);
+    // Bigger than a chunk still works
+    char *big = arena_alloc(arena, 1000);
+    for (int i = 0; i < 1000; i++) {
+        big[i] = i;
+    }
+    assert(arena_used(arena) >= 1000 + sizeof(double) + 3);
+    arena_free(arena);
+}
+
+void test_arena_reset_reuses_memory() {
+    Arena *arena = arena_init(256);
+    void *first = arena_alloc(arena, 16);
+    for (int i = 0; i < 100; i++) {
+        arena_alloc(arena, 16);
+    }
+    arena_reset(arena);
+    assert(arena_used(arena) == 0);
+    assert(arena_alloc(arena, 16) == first);
+    arena_free(arena);
+}
+
+void test_frame_arena() {
+    Arena *scratch = frame_arena();
+    assert(frame_arena() == scratch);
+    short *xs = arena_alloc(scratch, sizeof(short) * 100);
+    for (int i = 0; i < 100; i++) {
+        xs[i] = i;
+    }
+    assert(arena_used(scratch) >= sizeof(short) * 100);
+    frame_arena_reset();
+    assert(arena_used(scratch) == 0);
+    assert(arena_alloc(scratch, sizeof(short) * 100) == xs);
+    frame_arena_reset();
+}
+
+void test_arena_list_grows() {
+    Arena *arena = arena_init(128);
+    List *list = list_init_arena(0, NULL, arena);
+    assert(list_get_arena(list) == arena);
+    for (int i = 0; i < 100; i++) {
+        list_add(list, create_vector_arena((Vector) {i, -i}, arena));
+    }
+    assert(list_size(list) == 100);
+    for (int i = 0; i < 100; i++) {
+        assert(vec_equal(*(Vector *) list_get(list, i), (Vector) {i, -i}));
+    }
+    list_remove(list, 0);
+    assert(list_size(list) == 99);
+    list_free(list);
+    arena_free(arena);
+}
+
+void test_scene_reset_arena() {
+    Scene *scene = scene_init();
+    Arena *arena = scene_get_arena(scene);
+    assert(scene_get_arena(scene) == arena);
+
+    Body *heap1 = body_init(make_shape(NULL), 1, (RGBColor) {0, 0, 0});
+    Body *heap2 = body_init(make_shape(NULL), 1, (RGBColor) {0, 0, 0});
+    body_set_centroid(heap2, (Vector) {10, 0});
+    scene_add_body(scene, heap1);
+    scene_add_body(scene, heap2);
+    create_newtonian_gravity(scene, 1, heap1, heap2);
+
+    for (int i = 0; i < 10; i++) {
+        Role *role = arena_alloc(arena, sizeof(Role));
+        *role = REMOVE_ON_COLLISION;
+        Body *body = body_init_arena(make_shape(arena), INFINITY,
+            (RGBColor) {0, 0, 0}, role, NULL, arena);
+        assert(body_get_arena(body) == arena);
+        body_set_centroid(body, (Vector) {0, 10 * (i + 1)});
+        scene_add_body(scene, body);
+        create_destructive_collision(scene, body, heap1);
+    }
+    assert(scene_bodies(scene) == 12);
+    assert(scene_forces(scene) == 11);
+    scene_tick(scene, 0.01);
+
+    scene_reset_arena(scene);
+    assert(arena_used(arena) == 0);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_get_body(scene, 0) == heap1);
+    assert(scene_get_body(scene, 1) == heap2);
+    assert(scene_forces(scene) == 1);
+    scene_tick(scene, 0.01);
+    assert(body_get_velocity(heap1).x > 0);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_arena_alloc)
+    DO_TEST(test_arena_reset_reuses_memory)
+    DO_TEST(test_frame_arena)
+    DO_TEST(test_arena_list_grows)
+    DO_TEST(test_scene_reset_arena)
+
+    puts("arena_test PASS");
+    return 0;
+}
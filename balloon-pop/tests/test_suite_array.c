@@ -0,0 +1,94 @@
+#include "body.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+void test_array_add_get() {
+    VectorArray array;
+    Vector_array_init(&array, 0);
+    assert(Vector_array_size(&array) == 0);
+    for (int i = 0; i < 100; i++) {
+        Vector_array_add(&array, (Vector) {i, -i});
+    }
+    assert(Vector_array_size(&array) == 100);
+    assert(array.capacity >= 100);
+    for (int i = 0; i < 100; i++) {
+        assert(vec_equal(Vector_array_get(&array, i), (Vector) {i, -i}));
+    }
+    Vector_array_at(&array, 5)->x = 50;
+    Vector_array_set(&array, 6, (Vector) {60, 60});
+    assert(vec_equal(Vector_array_get(&array, 5), (Vector) {50, -5}));
+    assert(vec_equal(Vector_array_get(&array, 6), (Vector) {60, 60}));
+    Vector_array_free(&array);
+}
+
+void test_array_remove_keeps_order() {
+    VectorArray array;
+    Vector_array_init(&array, 4);
+    for (int i = 0; i < 5; i++) {
+        Vector_array_add(&array, (Vector) {i, 0});
+    }
+    Vector_array_remove(&array, 1);
+    Vector_array_remove(&array, 3);
+    assert(Vector_array_size(&array) == 3);
+    assert(Vector_array_get(&array, 0).x == 0);
+    assert(Vector_array_get(&array, 1).x == 2);
+    assert(Vector_array_get(&array, 2).x == 3);
+    Vector_array_clear(&array);
+    assert(Vector_array_size(&array) == 0);
+    Vector_array_free(&array);
+}
+
+void test_array_reserve_shrink_add_all() {
+    VectorArray array;
+    Vector_array_init(&array, 0);
+    Vector_array_reserve(&array, 10);
+    assert(array.capacity == 10);
+    Vector values[7];
+    for (int i = 0; i < 7; i++) {
+        values[i] = (Vector) {i, i};
+    }
+    Vector_array_add_all(&array, values, 7);
+    Vector_array_add_all(&array, values, 7);
+    assert(Vector_array_size(&array) == 14);
+    assert(array.capacity >= 14);
+    assert(Vector_array_get(&array, 13).x == 6);
+    Vector_array_shrink(&array);
+    assert(array.capacity == 14);
+    Vector_array_free(&array);
+}
+
+void test_array_arena() {
+    Arena *arena = arena_init(64);
+    BodyPtrArray array;
+    BodyPtr_array_init_arena(&array, 1, arena);
+    Body *fake[50];
+    for (int i = 0; i < 50; i++) {
+        fake[i] = (Body *) &fake[i];
+        BodyPtr_array_add(&array, fake[i]);
+    }
+    for (int i = 0; i < 50; i++) {
+        assert(BodyPtr_array_get(&array, i) == fake[i]);
+    }
+    // Storage belongs to the arena, so this must not call free()
+    BodyPtr_array_free(&array);
+    arena_free(arena);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_array_add_get)
+    DO_TEST(test_array_remove_keeps_order)
+    DO_TEST(test_array_reserve_shrink_add_all)
+    DO_TEST(test_array_arena)
+
+    puts("array_test PASS");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "batch.h"
+#include "forces.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t SCENES = 64;
+const size_t TICKS = 500;
+const double DT = 1e-3;
+
+/* A ball dropped from a height that depends on which run this is */
+Scene *make_drop(size_t run) {
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, (Vector) {0, -9.8});
+    Body *ball = body_init(get_rectangle(VEC_ZERO, 1, 1), 2,
+        (RGBColor) {0, 0, 0});
+    body_set_centroid(ball, (Vector) {run, 100 + run});
+    body_set_velocity(ball, (Vector) {1, 0});
+    scene_add_body(scene, ball);
+    create_drag(scene, 0.01 * run, ball);
+    return scene;
+}
+
+typedef struct {
+    Vector *final_positions;
+    size_t *order;
+    size_t finished;
+} Results;
+
+void record(Scene *scene, size_t index, void *aux) {
+    Results *results = aux;
+    results->final_positions[index] = body_get_centroid(scene_get_body(scene, 0));
+}
+
+void record_in_order(Scene *scene, size_t index, void *aux) {
+    Results *results = aux;
+    record(scene, index, aux);
+    results->order[results->finished++] = index;
+}
+
+void test_batch_matches_serial() {
+    Scene *scenes[SCENES];
+    Vector expected[SCENES];
+    for (size_t i = 0; i < SCENES; i++) {
+        Scene *scene = make_drop(i);
+        for (size_t tick = 0; tick < TICKS; tick++) {
+            scene_tick(scene, DT);
+        }
+        expected[i] = body_get_centroid(scene_get_body(scene, 0));
+        scene_free(scene);
+        scenes[i] = make_drop(i);
+    }
+
+    JobSystem *jobs = job_system_init(4);
+    Vector actual[SCENES];
+    Results results = {.final_positions = actual};
+    batch_run(jobs, scenes, SCENES, TICKS, DT, record, &results);
+    // Each scene ticks on a single thread, so it ends up exactly as before
+    for (size_t i = 0; i < SCENES; i++) {
+        assert(vec_equal(actual[i], expected[i]));
+        // Without drag, the first ball falls 1/2 g t^2
+        if (i == 0) {
+            assert(within(1e-2, 100 - actual[i].y, 0.5 * 9.8 * 0.25));
+        }
+        scene_free(scenes[i]);
+    }
+    job_system_free(jobs);
+}
+
+void test_batch_without_jobs() {
+    Scene *scenes[SCENES];
+    for (size_t i = 0; i < SCENES; i++) {
+        scenes[i] = make_drop(i);
+    }
+    Vector positions[SCENES];
+    size_t order[SCENES];
+    Results results = {positions, order, 0};
+    batch_run(NULL, scenes, SCENES, 10, DT, record_in_order, &results);
+    // Scenes run one after another, in order, on this thread
+    assert(results.finished == SCENES);
+    for (size_t i = 0; i < SCENES; i++) {
+        assert(order[i] == i);
+        assert(positions[i].y < 100 + i);
+        scene_free(scenes[i]);
+    }
+    // Nothing to do is fine too
+    batch_run(NULL, NULL, 0, 10, DT, record, &results);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_batch_matches_serial)
+    DO_TEST(test_batch_without_jobs)
+
+    puts("batch_test PASS");
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "forces.h"
+#include "collision.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const Vector GRAVITY = {0, -10};
+const double DT = 1.0 / 60;
+
+Body *make_ball(Scene *scene, Vector center, double radius, double mass) {
+    Body *ball = body_init(get_circle_points(VEC_ZERO, radius), mass,
+        (RGBColor) {0, 0, 0});
+    body_set_centroid(ball, center);
+    scene_add_body(scene, ball);
+    return ball;
+}
+
+void test_collision_info() {
+    List *shape1 = get_rectangle((Vector) {0, 0}, 2, 2);
+    List *shape2 = get_rectangle((Vector) {1.5, 0.2}, 2, 2);
+    CollisionInfo info = find_collision_info(shape1, shape2);
+    assert(info.collided);
+    assert(isclose(info.depth, 0.5));
+    assert(vec_isclose(info.axis, (Vector) {1, 0}));
+    // The axis always points from the first shape to the second
+    info = find_collision_info(shape2, shape1);
+    assert(vec_isclose(info.axis, (Vector) {-1, 0}));
+    list_free(shape2);
+    shape2 = get_rectangle((Vector) {3, 0}, 2, 2);
+    assert(!find_collision_info(shape1, shape2).collided);
+    list_free(shape1);
+    list_free(shape2);
+}
+
+void test_distance_constraint_pendulum() {
+    const double LENGTH = 10;
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *pivot = make_ball(scene, VEC_ZERO, 1, INFINITY);
+    Body *bob = make_ball(scene, (Vector) {LENGTH, 0}, 1, 1);
+    scene_add_distance_constraint(scene, pivot, bob, LENGTH, 0);
+    assert(scene_constraints_count(scene) == 1);
+    double lowest = 0;
+    for (int i = 0; i < 600; i++) {
+        scene_tick(scene, DT);
+        double length = vec_distance(body_get_centroid(pivot),
+            body_get_centroid(bob));
+        assert(within(1e-9, length, LENGTH));
+        lowest = fmin(lowest, body_get_centroid(bob).y);
+    }
+    // It swings through the bottom rather than hanging off to the side
+    assert(lowest < -0.99 * LENGTH);
+    assert(vec_equal(body_get_centroid(pivot), VEC_ZERO));
+    scene_free(scene);
+}
+
+void test_pin_constraint() {
+    const Vector PIN = {3, 4};
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *body = make_ball(scene, PIN, 1, 2);
+    body_set_velocity(body, (Vector) {5, 5});
+    scene_add_pin_constraint(scene, body, PIN, 0);
+    for (int i = 0; i < 100; i++) {
+        scene_tick(scene, DT);
+        assert(vec_within(1e-9, body_get_centroid(body), PIN));
+    }
+    scene_free(scene);
+}
+
+void test_soft_pin_sags() {
+    const Vector PIN = {0, 0};
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *body = make_ball(scene, PIN, 1, 1);
+    scene_add_pin_constraint(scene, body, PIN, 1e-2);
+    scene_set_constraint_iterations(scene, 20);
+    for (int i = 0; i < 2000; i++) {
+        scene_tick(scene, DT);
+    }
+    // A compliant pin acts like a spring of stiffness 1 / compliance
+    double sag = -body_get_centroid(body).y;
+    assert(sag > 0);
+    assert(sag < 0.5);
+    scene_free(scene);
+}
+
+void test_contact_resting_stack() {
+    const double RADIUS = 1;    // half the width of each box
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *ground = body_init(get_rectangle(VEC_ZERO, 100, 2), INFINITY,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, ground);
+    // Boxes, since a stack of round bodies would roll off without friction
+    Body *lower = body_init(get_rectangle((Vector) {0, 1 + RADIUS},
+        2 * RADIUS, 2 * RADIUS), 1, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, lower);
+    Body *upper = body_init(get_rectangle((Vector) {0, 1 + 3 * RADIUS},
+        2 * RADIUS, 2 * RADIUS), 1, (RGBColor) {0, 0, 0});
+    scene_add_body(scene, upper);
+    scene_add_contact_constraint(scene, ground, lower);
+    scene_add_contact_constraint(scene, ground, upper);
+    scene_add_contact_constraint(scene, lower, upper);
+    scene_set_constraint_iterations(scene, 10);
+    for (int i = 0; i < 600; i++) {
+        scene_tick(scene, DT);
+    }
+    // Neither box sinks into what it rests on, or drifts sideways
+    assert(within(0.05, body_get_centroid(lower).y, 1 + RADIUS));
+    assert(within(0.1, body_get_centroid(upper).y, 1 + 3 * RADIUS));
+    assert(within(0.05, body_get_centroid(upper).x, 0));
+    assert(!find_collision_info(body_get_shape(lower),
+        body_get_shape(upper)).collided ||
+        find_collision_info(body_get_shape(lower),
+        body_get_shape(upper)).depth < 0.05);
+    scene_free(scene);
+}
+
+void test_removed_body_removes_constraints() {
+    Scene *scene = scene_init();
+    Body *body1 = make_ball(scene, VEC_ZERO, 1, 1);
+    Body *body2 = make_ball(scene, (Vector) {5, 0}, 1, 1);
+    scene_add_distance_constraint(scene, body1, body2, 5, 0);
+    scene_add_pin_constraint(scene, body2, VEC_ZERO, 0);
+    scene_add_pin_constraint(scene, body1, VEC_ZERO, 0);
+    body_remove(body2);
+    scene_tick(scene, DT);
+    assert(scene_constraints_count(scene) == 1);
+    assert(scene_bodies(scene) == 1);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_collision_info)
+    DO_TEST(test_distance_constraint_pendulum)
+    DO_TEST(test_pin_constraint)
+    DO_TEST(test_soft_pin_sags)
+    DO_TEST(test_contact_resting_stack)
+    DO_TEST(test_removed_body_removes_constraints)
+
+    puts("constraints_test PASS");
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "contact_solver.h"
+#include "scene.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const Vector GRAVITY = {0, -10};
+const double DT = 1.0 / 60;
+
+// Boxes, since body_tick() turns bodies to face their velocity
+Body *make_box(Scene *scene, Vector center, double width, double height,
+    double mass) {
+    Body *box = body_init(get_rectangle(center, width, height), mass,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, box);
+    return box;
+}
+
+void test_elastic_exchange() {
+    Scene *scene = scene_init();
+    // Overlapping by less than the slop, so only the bounce acts
+    Body *left = make_box(scene, (Vector) {-0.999, 0}, 2, 2, 1);
+    Body *right = make_box(scene, (Vector) {0.999, 0}, 2, 2, 1);
+    body_set_velocity(left, (Vector) {5, 0});
+    body_set_velocity(right, (Vector) {-5, 0});
+    scene_add_impulse_contact(scene, left, right, 1, 0);
+    assert(scene_impulse_contacts(scene) == 1);
+    scene_tick(scene, DT);
+    // Equal masses swap velocities in a perfectly elastic collision
+    assert(vec_within(1e-9, body_get_velocity(left), (Vector) {-5, 0}));
+    assert(vec_within(1e-9, body_get_velocity(right), (Vector) {5, 0}));
+    scene_free(scene);
+}
+
+void test_inelastic_stops() {
+    Scene *scene = scene_init();
+    Body *wall = make_box(scene, (Vector) {1, 0}, 2, 10, INFINITY);
+    Body *box = make_box(scene, (Vector) {-0.999, 0}, 2, 2, 3);
+    body_set_velocity(box, (Vector) {4, 0});
+    scene_add_impulse_contact(scene, box, wall, 0, 0);
+    scene_tick(scene, DT);
+    assert(vec_within(1e-9, body_get_velocity(box), VEC_ZERO));
+    assert(vec_equal(body_get_centroid(wall), (Vector) {1, 0}));
+    scene_free(scene);
+}
+
+void test_separating_not_pulled() {
+    Scene *scene = scene_init();
+    Body *left = make_box(scene, (Vector) {-0.999, 0}, 2, 2, 1);
+    Body *right = make_box(scene, (Vector) {0.999, 0}, 2, 2, 1);
+    body_set_velocity(left, (Vector) {-1, 0});
+    body_set_velocity(right, (Vector) {1, 0});
+    scene_add_impulse_contact(scene, left, right, 0.5, 0);
+    scene_tick(scene, DT);
+    // Contacts only push, so bodies already moving apart are left alone
+    assert(vec_equal(body_get_velocity(left), (Vector) {-1, 0}));
+    assert(vec_equal(body_get_velocity(right), (Vector) {1, 0}));
+    scene_free(scene);
+}
+
+void test_resting_stack_few_iterations() {
+    const double SIZE = 2;
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *ground = make_box(scene, VEC_ZERO, 100, 2, INFINITY);
+    Body *boxes[4];
+    for (size_t i = 0; i < 4; i++) {
+        boxes[i] = make_box(scene, (Vector) {0, 1 + SIZE * (i + 0.5)},
+            SIZE, SIZE, 1);
+        scene_add_impulse_contact(scene, i ? boxes[i - 1] : ground, boxes[i],
+            0, 0.5);
+    }
+    // Warm starting carries the stack's weight over between ticks
+    scene_set_contact_iterations(scene, 4);
+    for (int i = 0; i < 600; i++) {
+        scene_tick(scene, DT);
+    }
+    for (size_t i = 0; i < 4; i++) {
+        Vector centroid = body_get_centroid(boxes[i]);
+        assert(within(0.05, centroid.x, 0));
+        assert(within(0.05, centroid.y, 1 + SIZE * (i + 0.5)));
+        assert(vec_within(1e-3, body_get_velocity(boxes[i]), VEC_ZERO));
+    }
+    scene_free(scene);
+}
+
+void test_friction_decelerates() {
+    const double FRICTION = 0.5;
+    const double SPEED = 5;
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, GRAVITY);
+    Body *ground = make_box(scene, VEC_ZERO, 100, 2, INFINITY);
+    Body *box = make_box(scene, (Vector) {0, 1.999}, 2, 2, 1);
+    body_set_velocity(box, (Vector) {SPEED, 0});
+    scene_add_impulse_contact(scene, ground, box, 0, FRICTION);
+    for (int i = 0; i < 30; i++) {
+        scene_tick(scene, DT);
+    }
+    // Sliding friction decelerates at friction * g
+    double expected = SPEED - FRICTION * -GRAVITY.y * 30 * DT;
+    assert(within(1e-6, body_get_velocity(box).x, expected));
+    assert(within(1e-6, body_get_centroid(box).y, 1.999));
+    scene_free(scene);
+}
+
+void test_removed_body_removes_contacts() {
+    Scene *scene = scene_init();
+    Body *body1 = make_box(scene, VEC_ZERO, 1, 1, 1);
+    Body *body2 = make_box(scene, (Vector) {5, 0}, 1, 1, 1);
+    Body *body3 = make_box(scene, (Vector) {10, 0}, 1, 1, 1);
+    scene_add_impulse_contact(scene, body1, body2, 1, 0);
+    scene_add_impulse_contact(scene, body2, body3, 1, 0);
+    scene_add_impulse_contact(scene, body1, body3, 1, 0);
+    body_remove(body2);
+    scene_tick(scene, DT);
+    assert(scene_impulse_contacts(scene) == 1);
+    assert(scene_bodies(scene) == 2);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_elastic_exchange)
+    DO_TEST(test_inelastic_stops)
+    DO_TEST(test_separating_not_pulled)
+    DO_TEST(test_resting_stack_few_iterations)
+    DO_TEST(test_friction_decelerates)
+    DO_TEST(test_removed_body_removes_contacts)
+
+    puts("contact_solver_test PASS");
+    return 0;
+}
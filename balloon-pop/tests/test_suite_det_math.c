@@ -0,0 +1,68 @@
+#include "det_math.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+
+// What the deterministic functions give, which the C library's last bits
+// may not match on every machine
+const double SIN_ONE = 0x1.aed548f090ceep-1;
+const double COS_ONE = 0x1.14a280fb5068cp-1;
+const double ATAN_HALF = 0x1.dac670561bb4fp-2;
+
+void test_accuracy() {
+    for (double x = -20; x <= 20; x += 0.01) {
+        // As close as the C library's
+        assert(fabs(det_sin(x) - sin(x)) < 1e-15);
+        assert(fabs(det_cos(x) - cos(x)) < 1e-15);
+        assert(fabs(det_atan(x) - atan(x)) < 1e-15);
+    }
+    assert(det_atan(1e30) == M_PI / 2);
+    assert(det_atan(-1e-30) == 0);
+}
+
+void test_special_values() {
+    // Right angles come out as exactly as sin() and cos() give them
+    assert(det_sin(M_PI / 2) == 1);
+    assert(det_sin(-M_PI / 2) == -1);
+    assert(fabs(det_cos(M_PI / 2)) < 1e-16);
+    assert(fabs(det_sin(M_PI)) < 1e-15);
+    assert(det_sin(-1.25) == -det_sin(1.25));
+    assert(det_cos(-1.25) == det_cos(1.25));
+    assert(isnan(det_sin(NAN)));
+    assert(isnan(det_cos(INFINITY)));
+    assert(isnan(det_atan(NAN)));
+    assert(det_atan(INFINITY) == M_PI / 2);
+    // Huge angles lose accuracy, but still give a sine
+    assert(fabs(det_sin(1e12)) <= 1);
+}
+
+void test_same_bits_everywhere() {
+    // Integer math, so these hold on any machine
+    assert(det_sin(1) == SIN_ONE);
+    assert(det_cos(1) == COS_ONE);
+    assert(det_atan(0.5) == ATAN_HALF);
+#ifdef DETERMINISTIC_MATH
+    assert(math_sin(1) == det_sin(1));
+    assert(math_atan(0.5) == det_atan(0.5));
+#else
+    assert(math_sin(1) == sin(1));
+    assert(math_atan(0.5) == atan(0.5));
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_accuracy)
+    DO_TEST(test_special_values)
+    DO_TEST(test_same_bits_everywhere)
+
+    puts("det_math_test PASS");
+    return 0;
+}
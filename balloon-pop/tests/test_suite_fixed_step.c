@@ -0,0 +1,168 @@
+#include "fixed_step.h"
+#include "forces.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const double DT = 0.25;
+
+/* A scene with one box sliding right at unit speed */
+Scene *make_slider(void) {
+    Scene *scene = scene_init();
+    Body *box = body_init(get_rectangle(VEC_ZERO, 2, 2), 1,
+        (RGBColor) {0, 0, 0});
+    body_set_velocity(box, (Vector) {1, 0});
+    scene_add_body(scene, box);
+    return scene;
+}
+
+void test_accumulates_time() {
+    Scene *scene = make_slider();
+    FixedStep *stepper = fixed_step_init(scene, DT, 10);
+    assert(fixed_step_dt(stepper) == DT);
+    // Frames shorter than a tick don't tick until enough time has built up
+    assert(fixed_step_advance(stepper, 0.125) == 0);
+    assert(fixed_step_alpha(stepper) == 0.5);
+    assert(fixed_step_advance(stepper, 0.5) == 2);
+    assert(fixed_step_alpha(stepper) == 0.5);
+    assert(fixed_step_advance(stepper, 0.125) == 1);
+    assert(fixed_step_alpha(stepper) == 0);
+    assert(vec_isclose(body_get_centroid(scene_get_body(scene, 0)),
+        (Vector) {0.75, 0}));
+    assert(fixed_step_dropped(stepper) == 0);
+    fixed_step_free(stepper);
+    scene_free(scene);
+}
+
+void test_caps_catch_up() {
+    Scene *scene = make_slider();
+    FixedStep *stepper = fixed_step_init(scene, DT, 4);
+    // A 10 s hitch only runs 4 ticks; the rest is dropped
+    assert(fixed_step_advance(stepper, 10.125) == 4);
+    assert(fixed_step_alpha(stepper) == 0.5);
+    assert(fixed_step_dropped(stepper) == 9);
+    // and the next frame is back to normal
+    assert(fixed_step_advance(stepper, 0.25) == 1);
+    assert(vec_isclose(body_get_centroid(scene_get_body(scene, 0)),
+        (Vector) {1.25, 0}));
+    fixed_step_free(stepper);
+    scene_free(scene);
+}
+
+void test_frame_rate_independent() {
+    const size_t FRAMES = 1000;
+    Scene *scenes[2];
+    FixedStep *steppers[2];
+    for (int s = 0; s < 2; s++) {
+        scenes[s] = make_slider();
+        Body *anchor = body_init(get_rectangle((Vector) {10, 10}, 1, 1),
+            INFINITY, (RGBColor) {0, 0, 0});
+        scene_add_body(scenes[s], anchor);
+        create_spring(scenes[s], 3, scene_get_body(scenes[s], 0), anchor);
+        steppers[s] = fixed_step_init(scenes[s], 1.0 / 64, 100);
+    }
+    // Steady frames on one, erratic ones on the other, same total time
+    srand(3);
+    double elapsed = 0;
+    for (size_t i = 0; i < FRAMES; i++) {
+        fixed_step_advance(steppers[0], 1.0 / 32);
+        double frame = (rand() % 8) / 128.0;
+        fixed_step_advance(steppers[1], frame);
+        elapsed += frame;
+    }
+    // Catch up in frames short enough not to hit the cap
+    for (double left = FRAMES / 32.0 - elapsed; left > 0; left -= 1.0 / 32) {
+        fixed_step_advance(steppers[1], fmin(left, 1.0 / 32));
+    }
+    // The ticks were all the same, so the states are too
+    assert(vec_equal(body_get_centroid(scene_get_body(scenes[0], 0)),
+        body_get_centroid(scene_get_body(scenes[1], 0))));
+    for (int s = 0; s < 2; s++) {
+        fixed_step_free(steppers[s]);
+        scene_free(scenes[s]);
+    }
+}
+
+void count_ticks(Scene *scene, double dt, void *aux) {
+    assert(dt == DT);
+    (*(size_t *) aux)++;
+}
+
+void test_on_tick() {
+    Scene *scene = make_slider();
+    FixedStep *stepper = fixed_step_init(scene, DT, 10);
+    size_t ticks = 0;
+    fixed_step_on_tick(stepper, count_ticks, &ticks);
+    fixed_step_advance(stepper, 1.1);
+    assert(ticks == 4);
+    fixed_step_on_tick(stepper, NULL, NULL);
+    fixed_step_advance(stepper, 1);
+    assert(ticks == 4);
+    fixed_step_free(stepper);
+    scene_free(scene);
+}
+
+/* Turns the scene's second body a quarter turn every tick */
+void spin(Scene *scene, double dt, void *aux) {
+    Body *spinner = scene_get_body(scene, 1);
+    body_set_rotation(spinner, body_get_angle(spinner) + M_PI / 2);
+}
+
+void test_interpolates_poses() {
+    Scene *scene = make_slider();
+    Body *spinner = body_init(get_rectangle((Vector) {0, 5}, 2, 2), 1,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, spinner);
+    FixedStep *stepper = fixed_step_init(scene, DT, 10);
+    fixed_step_on_tick(stepper, spin, NULL);
+    // Before any tick, there's nothing to blend with
+    assert(vec_equal(fixed_step_point(stepper, 0, (Vector) {1, 1}),
+        (Vector) {1, 1}));
+
+    fixed_step_advance(stepper, 0.25 + 0.0625);
+    // A quarter of a tick past it, the slider is drawn a quarter of the way
+    // from its last pose to its current one: centroid 0.0625, not 0.25
+    Vector corner = fixed_step_point(stepper, 0, (Vector) {1.25, 1});
+    assert(vec_isclose(corner, (Vector) {0.0625 + 1, 1}));
+    // and the spinner is turned back 3/4 of the quarter turn it just made
+    Vector drawn = fixed_step_point(stepper, 1, (Vector) {1, 6});
+    Vector expected = vec_add((Vector) {0, 5},
+        vec_rotate((Vector) {1, 1}, -0.75 * M_PI / 2));
+    assert(vec_isclose(drawn, expected));
+
+    // A body added since the last tick is drawn where it is
+    Body *added = body_init(get_rectangle((Vector) {7, 7}, 1, 1), 1,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, added);
+    assert(vec_equal(fixed_step_point(stepper, 2, (Vector) {7, 7}),
+        (Vector) {7, 7}));
+    // After removing the slider, the spinner keeps its earlier pose
+    scene_remove_body(scene, 0);
+    fixed_step_on_tick(stepper, NULL, NULL);
+    assert(fixed_step_advance(stepper, 0) == 0);
+    assert(vec_isclose(fixed_step_point(stepper, 0, (Vector) {1, 6}),
+        expected));
+    fixed_step_free(stepper);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_accumulates_time)
+    DO_TEST(test_caps_catch_up)
+    DO_TEST(test_frame_rate_independent)
+    DO_TEST(test_on_tick)
+    DO_TEST(test_interpolates_poses)
+
+    puts("fixed_step_test PASS");
+    return 0;
+}
@@ -36,8 +36,8 @@ void test_spring_sinusoid() {
     const double M = 10;
     const double K = 2;
     const double A = 3;
-    const double DT = 1e-6;
-    const int STEPS = 1000000;
+    const double DT = TEST_DT;
+    const int STEPS = TEST_STEPS;
     Scene *scene = scene_init();
     Body *mass = body_init(make_shape(), M, (RGBColor) {0, 0, 0});
     body_set_centroid(mass, (Vector) {A, 0});
@@ -59,8 +59,8 @@ void test_spring_sinusoid() {
 void test_energy_conservation() {
     const double M1 = 4.5, M2 = 7.3;
     const double G = 1e3;
-    const double DT = 1e-6;
-    const int STEPS = 1000000;
+    const double DT = TEST_DT;
+    const int STEPS = TEST_STEPS;
     Scene *scene = scene_init();
     Body *mass1 = body_init(make_shape(), M1, (RGBColor) {0, 0, 0});
     scene_add_body(scene, mass1);
@@ -0,0 +1,150 @@
+#include "forces.h"
+#include "scene.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const Integrator INTEGRATORS[] = {
+    INTEGRATOR_AVERAGE_VELOCITY,
+    INTEGRATOR_SEMI_IMPLICIT_EULER,
+    INTEGRATOR_VELOCITY_VERLET,
+    INTEGRATOR_RK4
+};
+const size_t NUM_INTEGRATORS = sizeof(INTEGRATORS) / sizeof(INTEGRATORS[0]);
+
+/*
+ * A unit-mass box on a unit spring to an anchor at the origin,
+ * starting at (1, 0) at rest, so it oscillates with period 2 pi
+ */
+Scene *make_oscillator(Integrator integrator) {
+    Scene *scene = scene_init();
+    scene_set_integrator(scene, integrator);
+    Body *mass = body_init(get_rectangle((Vector) {1, 0}, 0.1, 0.1), 1,
+        (RGBColor) {0, 0, 0});
+    Body *anchor = body_init(get_rectangle(VEC_ZERO, 0.1, 0.1), INFINITY,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, mass);
+    scene_add_body(scene, anchor);
+    create_spring(scene, 1, mass, anchor);
+    return scene;
+}
+
+double oscillator_energy(Scene *scene) {
+    Body *mass = scene_get_body(scene, 0);
+    Vector x = body_get_centroid(mass);
+    Vector v = body_get_velocity(mass);
+    return 0.5 * vec_dot(v, v) + 0.5 * vec_dot(x, x);
+}
+
+void test_default_integrator() {
+    Scene *scene = scene_init();
+    assert(scene_get_integrator(scene) == INTEGRATOR_AVERAGE_VELOCITY);
+    scene_set_integrator(scene, INTEGRATOR_RK4);
+    assert(scene_get_integrator(scene) == INTEGRATOR_RK4);
+    scene_free(scene);
+}
+
+void test_uniform_field() {
+    // Every integrator is exact for constant acceleration...
+    const double DT = 0.1;
+    for (size_t i = 0; i < NUM_INTEGRATORS; i++) {
+        Scene *scene = scene_init();
+        scene_set_integrator(scene, INTEGRATORS[i]);
+        scene_set_gravity(scene, (Vector) {0, -10});
+        Body *box = body_init(get_rectangle(VEC_ZERO, 1, 1), 1,
+            (RGBColor) {0, 0, 0});
+        body_set_velocity(box, (Vector) {2, 0});
+        scene_add_body(scene, box);
+        for (int t = 0; t < 10; t++) {
+            scene_tick(scene, DT);
+        }
+        assert(vec_isclose(body_get_velocity(box), (Vector) {2, -10}));
+        Vector x = body_get_centroid(box);
+        assert(isclose(x.x, 2));
+        // ...except semi-implicit Euler, which falls a step ahead
+        if (INTEGRATORS[i] == INTEGRATOR_SEMI_IMPLICIT_EULER) {
+            assert(isclose(x.y, -5 - 0.5 * 10 * DT));
+        } else {
+            assert(isclose(x.y, -5));
+        }
+        scene_free(scene);
+    }
+}
+
+void test_energy_bounded() {
+    // 100 periods at 20 ticks per period
+    const double DT = 2 * M_PI / 20;
+    const size_t TICKS = 2000;
+    double drift[NUM_INTEGRATORS];
+    for (size_t i = 0; i < NUM_INTEGRATORS; i++) {
+        Scene *scene = make_oscillator(INTEGRATORS[i]);
+        double start = oscillator_energy(scene);
+        drift[i] = 0;
+        for (size_t t = 0; t < TICKS; t++) {
+            scene_tick(scene, DT);
+            drift[i] = fmax(drift[i],
+                fabs(oscillator_energy(scene) - start) / start);
+        }
+        scene_free(scene);
+    }
+    // The average-velocity update gains energy every tick
+    assert(drift[0] > 1);
+    // The symplectic ones oscillate around the true energy
+    assert(drift[1] < 0.25);
+    assert(drift[2] < 0.05);
+    // and RK4 loses it slowly
+    assert(drift[3] < 0.05);
+}
+
+void test_rk4_accuracy() {
+    // One period at 20 ticks per period brings the mass back to its start
+    const size_t TICKS = 20;
+    Scene *scene = make_oscillator(INTEGRATORS[3]);
+    for (size_t t = 0; t < TICKS; t++) {
+        scene_tick(scene, 2 * M_PI / TICKS);
+    }
+    Vector x = body_get_centroid(scene_get_body(scene, 0));
+    assert(fabs(x.x - 1) < 1e-3);
+    assert(fabs(x.y) < 1e-3);
+    scene_free(scene);
+}
+
+void test_parallel_matches_serial() {
+    for (size_t i = 0; i < NUM_INTEGRATORS; i++) {
+        Scene *serial = make_oscillator(INTEGRATORS[i]);
+        Scene *parallel = make_oscillator(INTEGRATORS[i]);
+        JobSystem *jobs = job_system_init(3);
+        scene_set_jobs(parallel, jobs);
+        for (int t = 0; t < 50; t++) {
+            scene_tick(serial, 0.1);
+            scene_tick(parallel, 0.1);
+        }
+        assert(vec_equal(body_get_centroid(scene_get_body(serial, 0)),
+            body_get_centroid(scene_get_body(parallel, 0))));
+        scene_free(serial);
+        scene_free(parallel);
+        job_system_free(jobs);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_default_integrator)
+    DO_TEST(test_uniform_field)
+    DO_TEST(test_energy_bounded)
+    DO_TEST(test_rk4_accuracy)
+    DO_TEST(test_parallel_matches_serial)
+
+    puts("integrators_test PASS");
+    return 0;
+}
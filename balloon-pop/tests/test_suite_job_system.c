@@ -0,0 +1,256 @@
+#include "job_system.h"
+#include "forces.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+const size_t WORKERS = 4;
+
+typedef struct {
+    atomic_int *visits;
+    size_t *thread_sums;
+    size_t threads;
+} CountAux;
+
+void count_range(size_t start, size_t end, size_t thread, void *aux) {
+    CountAux *a = aux;
+    assert(thread < a->threads);
+    for (size_t i = start; i < end; i++) {
+        atomic_fetch_add(&a->visits[i], 1);
+        a->thread_sums[thread] += i;
+    }
+}
+
+void test_parallel_for_covers_range() {
+    const size_t N = 100000;
+    JobSystem *jobs = job_system_init(WORKERS);
+    assert(job_system_threads(jobs) == WORKERS + 1);
+    assert(job_system_thread(jobs) == 0);
+    CountAux aux = {
+        .visits = calloc(N, sizeof(atomic_int)),
+        .thread_sums = calloc(WORKERS + 1, sizeof(size_t)),
+        .threads = WORKERS + 1
+    };
+    assert(aux.visits && aux.thread_sums);
+    for (size_t grain = 0; grain < 3000; grain += 1000) {
+        parallel_for(jobs, N, grain, count_range, &aux);
+    }
+    size_t total = 0;
+    for (size_t t = 0; t <= WORKERS; t++) {
+        total += aux.thread_sums[t];
+    }
+    // Every iteration ran exactly once per loop
+    for (size_t i = 0; i < N; i++) {
+        assert(aux.visits[i] == 3);
+    }
+    assert(total == 3 * N * (N - 1) / 2);
+    // Without a job system, the loop runs inline
+    parallel_for(NULL, N, 0, count_range, &aux);
+    assert(aux.visits[N - 1] == 4);
+    free(aux.visits);
+    free(aux.thread_sums);
+    job_system_free(jobs);
+}
+
+typedef struct {
+    JobSystem *jobs;
+    atomic_size_t *counter;
+} NestedAux;
+
+void add_range(size_t start, size_t end, size_t thread, void *aux) {
+    atomic_fetch_add((atomic_size_t *) aux, end - start);
+}
+
+void nested_job(void *aux) {
+    NestedAux *a = aux;
+    // Loops inside jobs wait only for their own chunks
+    parallel_for(a->jobs, 1000, 10, add_range, a->counter);
+}
+
+void test_submit_and_nested_loops() {
+    const size_t JOBS = 64;
+    JobSystem *jobs = job_system_init(WORKERS);
+    atomic_size_t counter;
+    atomic_init(&counter, 0);
+    NestedAux aux = {jobs, &counter};
+    for (size_t i = 0; i < JOBS; i++) {
+        job_system_submit(jobs, nested_job, &aux);
+    }
+    job_system_wait(jobs);
+    assert(atomic_load(&counter) == JOBS * 1000);
+    job_system_free(jobs);
+}
+
+/* An ordinary force creator that nudges each body against its velocity */
+void kick(void *aux) {
+    Scene *scene = aux;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        body_add_impulse(body, vec_multiply(-1e-3, body_get_velocity(body)));
+    }
+}
+
+/*
+ * Builds a scene of N bodies joined by gravity, springs and drag,
+ * with kicks in between if kicks is set
+ */
+Scene *make_scene(size_t n, bool kicks) {
+    srand(11);
+    Scene *scene = scene_init();
+    for (size_t i = 0; i < n; i++) {
+        Body *body = body_init(get_rectangle(VEC_ZERO, 1, 1), 1 + rand() % 5,
+            (RGBColor) {0, 0, 0});
+        body_set_centroid(body, (Vector) {rand() % 500, rand() % 500});
+        scene_add_body(scene, body);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Body *body = scene_get_body(scene, i);
+        for (size_t j = i + 1; j < n; j++) {
+            create_newtonian_gravity(scene, 100, body, scene_get_body(scene, j));
+        }
+        create_spring(scene, 0.5, body, scene_get_body(scene, (i + 1) % n));
+        create_drag(scene, 0.1, body);
+        if (kicks && i % 5 == 0) {
+            scene_add_body_array_force_creator(scene, kick, scene, NULL, NULL);
+        }
+    }
+    return scene;
+}
+
+/* Whether two scenes' bodies are in exactly the same states */
+bool scenes_identical(Scene *scene1, Scene *scene2) {
+    if (scene_bodies(scene1) != scene_bodies(scene2)) {
+        return false;
+    }
+    for (size_t i = 0; i < scene_bodies(scene1); i++) {
+        Body *body1 = scene_get_body(scene1, i);
+        Body *body2 = scene_get_body(scene2, i);
+        if (!vec_equal(body_get_centroid(body1), body_get_centroid(body2))
+            || !vec_equal(body_get_velocity(body1), body_get_velocity(body2))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_parallel_tick_matches_serial() {
+    const size_t N = 60;
+    JobSystem *jobs = job_system_init(WORKERS);
+    Scene *serial = make_scene(N, false);
+    Scene *parallel = make_scene(N, false);
+    scene_set_jobs(parallel, jobs);
+    assert(scene_get_jobs(parallel) == jobs);
+    for (int i = 0; i < 100; i++) {
+        scene_tick(serial, 1e-2);
+        scene_tick(parallel, 1e-2);
+    }
+    // Forces are summed in the order they were added, whichever thread ran them
+    assert(scenes_identical(serial, parallel));
+    scene_free(serial);
+    scene_free(parallel);
+    job_system_free(jobs);
+}
+
+void test_parallel_tick_deterministic() {
+    const size_t N = 40;
+    const size_t RUNS = 4;
+    // Ordinary force creators in between the parallel ones keep their turn
+    Scene *serial = make_scene(N, true);
+    for (int i = 0; i < 50; i++) {
+        scene_tick(serial, 1e-2);
+    }
+    // Replays on any number of threads, scheduled any way, end up the same
+    for (size_t run = 0; run < RUNS; run++) {
+        JobSystem *jobs = job_system_init(run + 1);
+        Scene *parallel = make_scene(N, true);
+        scene_set_jobs(parallel, jobs);
+        for (int i = 0; i < 50; i++) {
+            scene_tick(parallel, 1e-2);
+        }
+        assert(scenes_identical(serial, parallel));
+        scene_free(parallel);
+        job_system_free(jobs);
+    }
+    scene_free(serial);
+}
+
+void test_parallel_barnes_hut() {
+    const size_t N = 500;
+    JobSystem *jobs = job_system_init(WORKERS);
+    Scene *scenes[2];
+    for (int s = 0; s < 2; s++) {
+        srand(5);
+        scenes[s] = scene_init();
+        for (size_t i = 0; i < N; i++) {
+            Body *body = body_init(get_rectangle(VEC_ZERO, 1, 1), 1,
+                (RGBColor) {0, 0, 0});
+            body_set_centroid(body, (Vector) {rand() % 1000, rand() % 1000});
+            scene_add_body(scenes[s], body);
+        }
+        create_barnes_hut_gravity(scenes[s], 1e3, 0.5);
+    }
+    scene_set_jobs(scenes[1], jobs);
+    for (int i = 0; i < 10; i++) {
+        scene_tick(scenes[0], 1e-2);
+        scene_tick(scenes[1], 1e-2);
+    }
+    // Each body's force is found by one thread, the same way as before
+    assert(scenes_identical(scenes[0], scenes[1]));
+    scene_free(scenes[0]);
+    scene_free(scenes[1]);
+    job_system_free(jobs);
+}
+
+void remove_both(Body *body1, Body *body2, Vector axis, void *aux) {
+    body_remove(body1);
+    body_remove(body2);
+}
+
+void test_parallel_neighbor_collisions() {
+    const size_t N = 400;
+    JobSystem *jobs = job_system_init(WORKERS);
+    Scene *scenes[2];
+    for (int s = 0; s < 2; s++) {
+        srand(9);
+        scenes[s] = scene_init();
+        for (size_t i = 0; i < N; i++) {
+            Body *body = body_init(get_rectangle(VEC_ZERO, 2, 2), 1,
+                (RGBColor) {0, 0, 0});
+            body_set_centroid(body, (Vector) {rand() % 100, rand() % 100});
+            scene_add_body(scenes[s], body);
+        }
+        create_neighbor_collisions(scenes[s], 3, 1, remove_both, NULL, NULL);
+    }
+    scene_set_jobs(scenes[1], jobs);
+    scene_tick(scenes[0], 1e-2);
+    scene_tick(scenes[1], 1e-2);
+    // Handlers still run in the same order, so the same bodies survive
+    assert(scene_bodies(scenes[0]) < N);
+    assert(scenes_identical(scenes[0], scenes[1]));
+    scene_free(scenes[0]);
+    scene_free(scenes[1]);
+    job_system_free(jobs);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_parallel_for_covers_range)
+    DO_TEST(test_submit_and_nested_loops)
+    DO_TEST(test_parallel_tick_matches_serial)
+    DO_TEST(test_parallel_tick_deterministic)
+    DO_TEST(test_parallel_barnes_hut)
+    DO_TEST(test_parallel_neighbor_collisions)
+
+    puts("job_system_test PASS");
+    return 0;
+}
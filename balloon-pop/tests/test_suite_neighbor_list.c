@@ -0,0 +1,178 @@
+#include "neighbor_list.h"
+#include "forces.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const double DT = 1.0 / 60;
+
+Body *make_ball(Vector center, double radius) {
+    Body *ball = body_init(get_circle_points(VEC_ZERO, radius), 1,
+        (RGBColor) {0, 0, 0});
+    body_set_centroid(ball, center);
+    return ball;
+}
+
+/* Whether the list holds the pair, in either order */
+bool has_pair(NeighborList *list, Body *body1, Body *body2) {
+    for (size_t i = 0; i < neighbor_list_pairs(list); i++) {
+        Body *a;
+        Body *b;
+        neighbor_list_get(list, i, &a, &b);
+        if ((a == body1 && b == body2) || (a == body2 && b == body1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void free_bodies(BodyPtrArray *bodies) {
+    for (size_t i = 0; i < BodyPtr_array_size(bodies); i++) {
+        body_free(BodyPtr_array_get(bodies, i));
+    }
+    BodyPtr_array_free(bodies);
+}
+
+void test_matches_brute_force() {
+    const size_t N = 300;
+    const double RANGE = 3;
+    srand(7);
+    BodyPtrArray bodies;
+    BodyPtr_array_init(&bodies, N);
+    for (size_t i = 0; i < N; i++) {
+        Vector center = {rand() % 1000 / 10.0, rand() % 500 / 10.0};
+        BodyPtr_array_add(&bodies, make_ball(center, 0.1));
+    }
+    NeighborList *list = neighbor_list_init(2, 1);
+    assert(neighbor_list_update(list, &bodies));
+    size_t expected = 0;
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            Body *body1 = BodyPtr_array_get(&bodies, i);
+            Body *body2 = BodyPtr_array_get(&bodies, j);
+            bool close = vec_distance(body_get_centroid(body1),
+                body_get_centroid(body2)) < RANGE;
+            assert(has_pair(list, body1, body2) == close);
+            expected += close;
+        }
+    }
+    assert(neighbor_list_pairs(list) == expected);
+    neighbor_list_free(list);
+    free_bodies(&bodies);
+}
+
+void test_spread_out_bodies() {
+    // Far more grid cells than bodies; the grid must coarsen instead
+    BodyPtrArray bodies;
+    BodyPtr_array_init(&bodies, 3);
+    Body *near1 = make_ball((Vector) {0, 0}, 1);
+    Body *near2 = make_ball((Vector) {0.5, 0}, 1);
+    Body *far = make_ball((Vector) {1e9, -1e9}, 1);
+    BodyPtr_array_add(&bodies, near1);
+    BodyPtr_array_add(&bodies, near2);
+    BodyPtr_array_add(&bodies, far);
+    NeighborList *list = neighbor_list_init(1, 0.5);
+    neighbor_list_update(list, &bodies);
+    assert(neighbor_list_pairs(list) == 1);
+    assert(has_pair(list, near1, near2));
+    neighbor_list_free(list);
+    free_bodies(&bodies);
+}
+
+void test_rebuilds_only_when_stale() {
+    const double SKIN = 1;
+    BodyPtrArray bodies;
+    BodyPtr_array_init(&bodies, 2);
+    Body *body1 = make_ball((Vector) {0, 0}, 1);
+    Body *body2 = make_ball((Vector) {10, 0}, 1);
+    BodyPtr_array_add(&bodies, body1);
+    BodyPtr_array_add(&bodies, body2);
+    NeighborList *list = neighbor_list_init(2, SKIN);
+    assert(neighbor_list_update(list, &bodies));
+    assert(neighbor_list_pairs(list) == 0);
+    // Moving less than half the skin keeps the list
+    body_set_centroid(body1, (Vector) {0.4 * SKIN, 0});
+    assert(!neighbor_list_update(list, &bodies));
+    assert(!neighbor_list_update(list, &bodies));
+    body_set_centroid(body1, (Vector) {0.6 * SKIN, 0});
+    assert(neighbor_list_update(list, &bodies));
+    assert(neighbor_list_rebuilds(list) == 2);
+    // So does any change to the set of bodies
+    Body *body3 = make_ball((Vector) {11, 0}, 1);
+    BodyPtr_array_add(&bodies, body3);
+    assert(neighbor_list_update(list, &bodies));
+    assert(has_pair(list, body2, body3));
+    assert(neighbor_list_rebuilds(list) == 3);
+    neighbor_list_free(list);
+    free_bodies(&bodies);
+}
+
+void test_neighbor_repulsion() {
+    const double K = 10;
+    const double CUTOFF = 2;
+    Scene *scene = scene_init();
+    Body *body1 = make_ball((Vector) {0, 0}, 0.1);
+    Body *body2 = make_ball((Vector) {1.5, 0}, 0.1);
+    Body *far = make_ball((Vector) {10, 0}, 0.1);
+    scene_add_body(scene, body1);
+    scene_add_body(scene, body2);
+    scene_add_body(scene, far);
+    create_neighbor_repulsion(scene, K, CUTOFF, 0.5);
+    assert(scene_forces(scene) == 1);
+    scene_tick(scene, DT);
+    // Each gets k * (cutoff - distance) away from the other
+    double speed = K * (CUTOFF - 1.5) * DT;
+    assert(vec_isclose(body_get_velocity(body1), (Vector) {-speed, 0}));
+    assert(vec_isclose(body_get_velocity(body2), (Vector) {speed, 0}));
+    assert(vec_equal(body_get_velocity(far), VEC_ZERO));
+    // Bodies added later are picked up, and removals don't drop the force
+    Body *body3 = make_ball((Vector) {10, 1}, 0.1);
+    scene_add_body(scene, body3);
+    body_remove(body1);
+    scene_tick(scene, DT);
+    assert(scene_forces(scene) == 1);
+    assert(body_get_velocity(body3).y > 0);
+    assert(body_get_velocity(far).y < 0);
+    scene_free(scene);
+}
+
+void remove_both(Body *body1, Body *body2, Vector axis, void *aux) {
+    body_remove(body1);
+    body_remove(body2);
+}
+
+void test_neighbor_destructive_collisions() {
+    Scene *scene = scene_init();
+    Body *body1 = make_ball((Vector) {0, 0}, 1);
+    Body *body2 = make_ball((Vector) {1.5, 0}, 1);
+    Body *body3 = make_ball((Vector) {10, 0}, 1);
+    scene_add_body(scene, body1);
+    scene_add_body(scene, body2);
+    scene_add_body(scene, body3);
+    create_neighbor_collisions(scene, 2, 1, remove_both, NULL, NULL);
+    scene_tick(scene, DT);
+    assert(scene_bodies(scene) == 1);
+    assert(scene_get_body(scene, 0) == body3);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_matches_brute_force)
+    DO_TEST(test_spread_out_bodies)
+    DO_TEST(test_rebuilds_only_when_stale)
+    DO_TEST(test_neighbor_repulsion)
+    DO_TEST(test_neighbor_destructive_collisions)
+
+    puts("neighbor_list_test PASS");
+    return 0;
+}
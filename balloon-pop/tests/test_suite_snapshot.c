@@ -0,0 +1,309 @@
+#include "forces.h"
+#include "scene.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const RGBColor BLACK = {0, 0, 0};
+
+/* A box with a role */
+Body *make_box(Vector center, Role role) {
+    return body_init_with_role(get_rectangle(center, 1, 1), 1, BLACK, role);
+}
+
+/* Two boxes orbiting each other under Newtonian gravity */
+Scene *make_orbit(void) {
+    Scene *scene = scene_init();
+    Body *left = make_box((Vector) {-5, 0}, PLAYER);
+    Body *right = make_box((Vector) {5, 0}, ENEMY);
+    body_set_velocity(left, (Vector) {0, -2});
+    body_set_velocity(right, (Vector) {0, 2});
+    scene_add_body(scene, left);
+    scene_add_body(scene, right);
+    create_newtonian_gravity(scene, 100, left, right);
+    return scene;
+}
+
+/* Takes a snapshot into a new buffer */
+void *snapshot(Scene *scene) {
+    size_t size = scene_snapshot_size(scene);
+    void *buf = malloc(size);
+    assert(buf);
+    assert(scene_snapshot(scene, buf) == size);
+    return buf;
+}
+
+/* Whether every body's vertices and velocity are exactly the same */
+bool same_bodies(Scene *scene, Scene *other) {
+    if (scene_bodies(scene) != scene_bodies(other)) {
+        return false;
+    }
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *a = scene_get_body(scene, i);
+        Body *b = scene_get_body(other, i);
+        List *shape_a = body_get_shape(a);
+        List *shape_b = body_get_shape(b);
+        for (size_t j = 0; j < list_size(shape_a); j++) {
+            if (!vec_equal(*(Vector *) list_get(shape_a, j),
+                    *(Vector *) list_get(shape_b, j))) {
+                return false;
+            }
+        }
+        if (!vec_equal(body_get_velocity(a), body_get_velocity(b))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_restore_replays_exactly() {
+    const double DT = 1e-2;
+    Scene *scene = make_orbit();
+    Scene *reference = make_orbit();
+    for (int i = 0; i < 10; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    void *buf = snapshot(scene);
+    for (int i = 0; i < 100; i++) {
+        scene_tick(scene, DT);
+    }
+    assert(!same_bodies(scene, reference));
+    scene_restore(scene, buf);
+    assert(same_bodies(scene, reference));
+    assert(scene_get_dt(scene) == DT);
+    // Running the same ticks again gives the same bits
+    for (int i = 0; i < 100; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    assert(same_bodies(scene, reference));
+    free(buf);
+    scene_free(scene);
+    scene_free(reference);
+}
+
+void test_restore_from_copy() {
+    Scene *scene = make_orbit();
+    void *buf = snapshot(scene);
+    size_t size = scene_snapshot_size(scene);
+    void *copy = malloc(size);
+    assert(copy);
+    memcpy(copy, buf, size);
+    free(buf);
+    Vector start = body_get_centroid(scene_get_body(scene, 0));
+    scene_tick(scene, 0.1);
+    scene_restore(scene, copy);
+    assert(vec_equal(body_get_centroid(scene_get_body(scene, 0)), start));
+    free(copy);
+    scene_free(scene);
+}
+
+void test_restore_drops_additions() {
+    Scene *scene = make_orbit();
+    void *buf = snapshot(scene);
+    Body *extra = make_box((Vector) {0, 10}, BULLET);
+    scene_add_body(scene, extra);
+    create_newtonian_gravity(scene, 100, scene_get_body(scene, 0), extra);
+    scene_add_impulse_contact(scene, scene_get_body(scene, 1), extra, 0, 0);
+    scene_add_pin_constraint(scene, extra, VEC_ZERO, 0);
+    scene_tick(scene, 0.1);
+    scene_restore(scene, buf);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_forces(scene) == 1);
+    assert(scene_impulse_contacts(scene) == 0);
+    assert(scene_constraints_count(scene) == 0);
+    // The scene still ticks without the freed body
+    scene_tick(scene, 0.1);
+    free(buf);
+    scene_free(scene);
+}
+
+void test_restore_undoes_edits() {
+    Scene *scene = make_orbit();
+    void *buf = snapshot(scene);
+    Body *body = scene_get_body(scene, 0);
+    Vector vertex = *(Vector *) list_get(body_get_shape(body), 0);
+    body_set_color(body, (RGBColor) {1, 0, 0});
+    body_set_role(body, TURN_WHITE_ON_COLLISION);
+    body_set_rotation(body, M_PI / 3);
+    body_remove(body);
+    scene_restore(scene, buf);
+    assert(body_get_color(body).r == 0);
+    assert(body_get_role(body) == PLAYER);
+    assert(body_get_angle(body) == 0);
+    assert(vec_equal(*(Vector *) list_get(body_get_shape(body), 0), vertex));
+    assert(!body_is_removed(body));
+    scene_tick(scene, 0.1);
+    assert(scene_bodies(scene) == 2);
+    free(buf);
+    scene_free(scene);
+}
+
+void test_restore_leaves_other_info() {
+    Scene *scene = scene_init();
+    double *info = malloc(sizeof(double));
+    assert(info);
+    *info = 1.0 / 3;
+    Body *body = body_init_with_info(get_rectangle(VEC_ZERO, 1, 1), 1, BLACK,
+        info, free);
+    scene_add_body(scene, body);
+    void *buf = snapshot(scene);
+    *info = 0.1;
+    scene_restore(scene, buf);
+    // The info isn't a Role, so none of it is written over
+    assert(*info == 0.1);
+    free(buf);
+    scene_free(scene);
+}
+
+/* Two boxes resting on the ground, held up by impulse contacts */
+Scene *make_stack(void) {
+    Scene *scene = scene_init();
+    scene_set_gravity(scene, (Vector) {0, -10});
+    Body *below = body_init(get_rectangle(VEC_ZERO, 100, 2), INFINITY, BLACK);
+    scene_add_body(scene, below);
+    for (int i = 0; i < 2; i++) {
+        Body *box = body_init(get_rectangle((Vector) {0, 2 + 2 * i}, 2, 2), 1,
+            BLACK);
+        scene_add_body(scene, box);
+        scene_add_impulse_contact(scene, below, box, 0, 0.5);
+        below = box;
+    }
+    return scene;
+}
+
+void test_restore_keeps_warm_starts() {
+    const double DT = 1.0 / 60;
+    Scene *scene = make_stack();
+    Scene *reference = make_stack();
+    for (int i = 0; i < 60; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    void *buf = snapshot(scene);
+    for (int i = 0; i < 20; i++) {
+        scene_tick(scene, DT);
+    }
+    scene_restore(scene, buf);
+    // The contacts start from the impulses they had, so nothing changes
+    for (int i = 0; i < 20; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    assert(same_bodies(scene, reference));
+    free(buf);
+    scene_free(scene);
+    scene_free(reference);
+}
+
+void test_restore_brings_back_removed() {
+    const double DT = 1.0 / 60;
+    Scene *scene = make_stack();
+    Scene *reference = make_stack();
+    scene_add_pin_constraint(scene, scene_get_body(scene, 2), \
+        (Vector) {0, 4}, 0);
+    scene_add_pin_constraint(reference, scene_get_body(reference, 2), \
+        (Vector) {0, 4}, 0);
+    for (int i = 0; i < 30; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    void *buf = snapshot(scene);
+    // Removing the middle box prunes both contacts and frees it in a tick
+    body_remove(scene_get_body(scene, 1));
+    scene_tick(scene, DT);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_impulse_contacts(scene) == 0);
+    scene_restore(scene, buf);
+    assert(scene_bodies(scene) == 3);
+    assert(scene_impulse_contacts(scene) == 2);
+    assert(scene_constraints_count(scene) == 1);
+    assert(!body_is_removed(scene_get_body(scene, 1)));
+    assert(same_bodies(scene, reference));
+    for (int i = 0; i < 30; i++) {
+        scene_tick(scene, DT);
+        scene_tick(reference, DT);
+    }
+    assert(same_bodies(scene, reference));
+    free(buf);
+    scene_free(scene);
+    scene_free(reference);
+}
+
+void test_restore_brings_back_forces() {
+    Scene *scene = make_orbit();
+    Body *left = scene_get_body(scene, 0);
+    void *first = snapshot(scene);
+    Body *extra = make_box((Vector) {0, 10}, BULLET);
+    scene_add_body(scene, extra);
+    create_newtonian_gravity(scene, 100, left, extra);
+    scene_tick(scene, 0.1);
+    void *second = snapshot(scene);
+    // Removing the extra box takes its gravity with it
+    body_remove(extra);
+    scene_tick(scene, 0.1);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_forces(scene) == 1);
+    scene_restore(scene, second);
+    assert(scene_bodies(scene) == 3);
+    assert(scene_forces(scene) == 2);
+    assert(scene_get_body(scene, 2) == extra);
+    // Going back further frees the box, which the first snapshot lacks
+    scene_restore(scene, first);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_forces(scene) == 1);
+    scene_tick(scene, 0.1);
+    free(first);
+    free(second);
+    scene_free(scene);
+}
+
+void test_release_removed() {
+    Scene *scene = make_orbit();
+    void *first = snapshot(scene);
+    body_remove(scene_get_body(scene, 1));
+    scene_tick(scene, 0.1);
+    // The first snapshot still has the removed body, so it is kept
+    scene_release_removed(scene, first);
+    scene_restore(scene, first);
+    assert(scene_bodies(scene) == 2);
+    assert(scene_forces(scene) == 1);
+    free(first);
+    // Once no snapshot has it, it is freed
+    body_remove(scene_get_body(scene, 1));
+    scene_tick(scene, 0.1);
+    void *second = snapshot(scene);
+    scene_release_removed(scene, second);
+    scene_restore(scene, second);
+    assert(scene_bodies(scene) == 1);
+    assert(scene_forces(scene) == 0);
+    free(second);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_restore_replays_exactly)
+    DO_TEST(test_restore_from_copy)
+    DO_TEST(test_restore_drops_additions)
+    DO_TEST(test_restore_undoes_edits)
+    DO_TEST(test_restore_leaves_other_info)
+    DO_TEST(test_restore_keeps_warm_starts)
+    DO_TEST(test_restore_brings_back_removed)
+    DO_TEST(test_restore_brings_back_forces)
+    DO_TEST(test_release_removed)
+
+    puts("snapshot_test PASS");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "forces.h"
+#include "spring_network.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+List *make_shape() {
+    List *shape = list_init(4, free);
+    list_add(shape, create_vector_p((Vector) {-1, -1}));
+    list_add(shape, create_vector_p((Vector) {+1, -1}));
+    list_add(shape, create_vector_p((Vector) {+1, +1}));
+    list_add(shape, create_vector_p((Vector) {-1, +1}));
+    return shape;
+}
+
+Body *make_body(Scene *scene, double mass, Vector centroid) {
+    Body *body = body_init(make_shape(), mass, (RGBColor) {0, 0, 0});
+    body_set_centroid(body, centroid);
+    scene_add_body(scene, body);
+    return body;
+}
+
+// A rope of N bodies with zero rest length matches N - 1 create_spring()s
+void test_matches_create_spring() {
+    const size_t N = 20;
+    const double K = 3, GAMMA = 0.5, DT = 1e-3;
+    const int STEPS = 2000;
+    Scene *scene1 = scene_init();
+    Scene *scene2 = scene_init();
+    SpringNetwork *network = spring_network_init(N - 1);
+    for (size_t i = 0; i < N; i++) {
+        Vector centroid = {10 * i, (i % 3) * 5.0};
+        Body *body1 = make_body(scene1, 1 + i % 4, centroid);
+        Body *body2 = make_body(scene2, 1 + i % 4, centroid);
+        size_t index = spring_network_add_body(network, body2);
+        assert(index == i);
+        if (i > 0) {
+            create_spring(scene1, K, scene_get_body(scene1, i - 1), body1);
+            spring_network_add_spring(network, i - 1, i, K, 0, 0);
+        }
+        if (i % 2 == 0) {
+            create_drag(scene1, GAMMA, body1);
+            spring_network_set_drag(network, i, GAMMA);
+        }
+    }
+    create_spring_network(scene2, network);
+    assert(spring_network_bodies(network) == N);
+    assert(spring_network_springs(network) == N - 1);
+    assert(scene_forces(scene2) == 1);
+    for (int step = 0; step < STEPS; step++) {
+        scene_tick(scene1, DT);
+        scene_tick(scene2, DT);
+    }
+    for (size_t i = 0; i < N; i++) {
+        assert(vec_within(1e-6, body_get_centroid(scene_get_body(scene1, i)),
+            body_get_centroid(scene_get_body(scene2, i))));
+    }
+    scene_free(scene1);
+    scene_free(scene2);
+}
+
+void test_rest_length() {
+    const double REST = 5;
+    Scene *scene = scene_init();
+    Body *body1 = make_body(scene, 1, (Vector) {0, 0});
+    Body *body2 = make_body(scene, 1, (Vector) {REST, 0});
+    SpringNetwork *network = spring_network_init(1);
+    spring_network_add_body(network, body1);
+    spring_network_add_body(network, body2);
+    spring_network_add_spring(network, 0, 1, 10, REST, 0);
+    create_spring_network(scene, network);
+    // At rest length nothing moves
+    scene_tick(scene, 0.1);
+    assert(vec_equal(body_get_velocity(body1), VEC_ZERO));
+    assert(vec_equal(body_get_velocity(body2), VEC_ZERO));
+    // Compressed, the spring pushes the bodies apart
+    body_set_centroid(body2, (Vector) {REST / 2, 0});
+    scene_tick(scene, 0.1);
+    assert(body_get_velocity(body1).x < 0);
+    assert(body_get_velocity(body2).x > 0);
+    assert(isclose(body_get_velocity(body1).x, -body_get_velocity(body2).x));
+    scene_free(scene);
+}
+
+void test_damping_loses_energy() {
+    const double DT = 1e-3;
+    Scene *scene = scene_init();
+    Body *body1 = make_body(scene, 1, (Vector) {0, 0});
+    Body *body2 = make_body(scene, 1, (Vector) {10, 0});
+    SpringNetwork *network = spring_network_init(1);
+    spring_network_add_body(network, body1);
+    spring_network_add_body(network, body2);
+    spring_network_add_spring(network, 0, 1, 10, 5, 2);
+    create_spring_network(scene, network);
+    for (int i = 0; i < 20000; i++) {
+        scene_tick(scene, DT);
+    }
+    // Damping settles the spring at its rest length
+    double distance = vec_distance(body_get_centroid(body1),
+        body_get_centroid(body2));
+    assert(within(1e-3, distance, 5));
+    scene_free(scene);
+}
+
+void test_removed_body_removes_network() {
+    Scene *scene = scene_init();
+    Body *body1 = make_body(scene, 1, (Vector) {0, 0});
+    Body *body2 = make_body(scene, 1, (Vector) {10, 0});
+    SpringNetwork *network = spring_network_init(0);
+    spring_network_add_body(network, body1);
+    spring_network_add_body(network, body2);
+    spring_network_add_spring(network, 0, 1, 1, 0, 0);
+    create_spring_network(scene, network);
+    body_remove(body2);
+    scene_tick(scene, 0.1);
+    assert(scene_forces(scene) == 0);
+    assert(scene_bodies(scene) == 1);
+    scene_free(scene);
+}
+
+/* Builds a scene with one spring of stiffness k between two bodies */
+Scene *make_spring_scene(double k, double anchor_mass, bool implicit) {
+    Scene *scene = scene_init();
+    scene_set_implicit_springs(scene, implicit);
+    Body *anchor = make_body(scene, anchor_mass, (Vector) {0, 0});
+    Body *weight = make_body(scene, 1, (Vector) {10, 5});
+    SpringNetwork *network = spring_network_init(1);
+    spring_network_add_body(network, anchor);
+    spring_network_add_body(network, weight);
+    spring_network_add_spring(network, 0, 1, k, 0, 0);
+    create_spring_network(scene, network);
+    return scene;
+}
+
+double spring_length(Scene *scene) {
+    return vec_distance(body_get_centroid(scene_get_body(scene, 0)),
+        body_get_centroid(scene_get_body(scene, 1)));
+}
+
+void test_implicit_stiff_spring_is_stable() {
+    const double K = 1e6, DT = 1.0 / 60;
+    Scene *explicit = make_spring_scene(K, 1, false);
+    Scene *implicit = make_spring_scene(K, 1, true);
+    assert(scene_get_implicit_springs(implicit));
+    double start = spring_length(implicit);
+    for (int i = 0; i < 600; i++) {
+        scene_tick(explicit, DT);
+        scene_tick(implicit, DT);
+        assert(spring_length(implicit) <= start);
+    }
+    // The explicit tick is far past its stability limit and blows up
+    assert(!(spring_length(explicit) < 1e3));
+    // The implicit one damps the oscillation out
+    assert(spring_length(implicit) < 1e-3);
+    scene_free(explicit);
+    scene_free(implicit);
+}
+
+void test_implicit_matches_explicit_for_small_dt() {
+    const double K = 1, DT = 1e-4;
+    Scene *explicit = make_spring_scene(K, 2, false);
+    Scene *implicit = make_spring_scene(K, 2, true);
+    for (int i = 0; i < 10000; i++) {
+        scene_tick(explicit, DT);
+        scene_tick(implicit, DT);
+    }
+    for (size_t i = 0; i < 2; i++) {
+        assert(vec_within(1e-2,
+            body_get_centroid(scene_get_body(explicit, i)),
+            body_get_centroid(scene_get_body(implicit, i))));
+    }
+    scene_free(explicit);
+    scene_free(implicit);
+}
+
+void test_implicit_keeps_anchor_fixed() {
+    Scene *scene = make_spring_scene(1e4, INFINITY, true);
+    double start = spring_length(scene);
+    for (int i = 0; i < 100; i++) {
+        scene_tick(scene, 1.0 / 30);
+        assert(spring_length(scene) <= start);
+    }
+    assert(vec_equal(body_get_centroid(scene_get_body(scene, 0)), VEC_ZERO));
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_matches_create_spring)
+    DO_TEST(test_rest_length)
+    DO_TEST(test_damping_loses_energy)
+    DO_TEST(test_removed_body_removes_network)
+    DO_TEST(test_implicit_stiff_spring_is_stable)
+    DO_TEST(test_implicit_matches_explicit_for_small_dt)
+    DO_TEST(test_implicit_keeps_anchor_fixed)
+
+    puts("spring_network_test PASS");
+    return 0;
+}
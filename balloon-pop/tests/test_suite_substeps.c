@@ -0,0 +1,129 @@
+#include "fixed_step.h"
+#include "scene.h"
+#include "test_util.h"
+#include "utils.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/* A scene with one unit box moving right at the given speed */
+Scene *make_mover(double speed) {
+    Scene *scene = scene_init();
+    Body *box = body_init(get_rectangle(VEC_ZERO, 1, 1), 1,
+        (RGBColor) {0, 0, 0});
+    body_set_velocity(box, (Vector) {speed, 0});
+    scene_add_body(scene, box);
+    return scene;
+}
+
+/* Two boxes sunk halfway into each other, pushed together by an impulse contact */
+Scene *make_overlap(void) {
+    Scene *scene = scene_init();
+    Body *left = body_init(get_rectangle(VEC_ZERO, 2, 2), 1,
+        (RGBColor) {0, 0, 0});
+    Body *right = body_init(get_rectangle((Vector) {1, 0}, 2, 2), 1,
+        (RGBColor) {0, 0, 0});
+    scene_add_body(scene, left);
+    scene_add_body(scene, right);
+    scene_add_impulse_contact(scene, left, right, 0, 0);
+    return scene;
+}
+
+void test_off_by_default() {
+    Scene *scene = make_mover(100);
+    assert(scene_get_tick_stats(scene).substeps == 0);
+    scene_tick(scene, 0.1);
+    TickStats stats = scene_get_tick_stats(scene);
+    assert(stats.substeps == 1);
+    assert(scene_get_dt(scene) == 0.1);
+    scene_free(scene);
+}
+
+void test_splits_fast_ticks() {
+    Scene *scene = make_mover(100);
+    scene_set_adaptive_substeps(scene, 0.5, 0, 16);
+    // The box would move 10 sizes, which takes 20 substeps; 16 is the cap
+    scene_tick(scene, 0.1);
+    TickStats stats = scene_get_tick_stats(scene);
+    assert(stats.substeps == 16);
+    assert(isclose(stats.max_motion, 10));
+    assert(isclose(scene_get_dt(scene), 0.1 / 16));
+    // Slow enough, and the tick isn't split
+    body_set_velocity(scene_get_body(scene, 0), (Vector) {1, 0});
+    scene_tick(scene, 0.1);
+    assert(scene_get_tick_stats(scene).substeps == 1);
+    scene_free(scene);
+}
+
+void test_substeps_match_short_ticks() {
+    Scene *split = make_mover(10);
+    Scene *manual = make_mover(10);
+    scene_set_gravity(split, (Vector) {0, -9.8});
+    scene_set_gravity(manual, (Vector) {0, -9.8});
+    scene_set_adaptive_substeps(split, 0.25, 0, 8);
+    // Speed 10, plus up to 0.98 from gravity, is 1.1 sizes per tick: 5 substeps
+    scene_tick(split, 0.1);
+    assert(scene_get_tick_stats(split).substeps == 5);
+    for (int i = 0; i < 5; i++) {
+        scene_tick(manual, 0.1 / 5);
+    }
+    Body *a = scene_get_body(split, 0);
+    Body *b = scene_get_body(manual, 0);
+    assert(vec_equal(body_get_centroid(a), body_get_centroid(b)));
+    assert(vec_equal(body_get_velocity(a), body_get_velocity(b)));
+    scene_free(split);
+    scene_free(manual);
+}
+
+void test_deep_contacts_split() {
+    Scene *scene = make_overlap();
+    scene_set_adaptive_substeps(scene, 0, 0.1, 8);
+    scene_tick(scene, 0.01);
+    TickStats stats = scene_get_tick_stats(scene);
+    assert(stats.substeps == 1);
+    assert(stats.max_depth > 0.1);
+    // The overlap from last tick doubles the substeps
+    scene_tick(scene, 0.01);
+    assert(scene_get_tick_stats(scene).substeps == 2);
+    scene_free(scene);
+}
+
+void test_merges_calm_ticks() {
+    const double DT = 0.25;
+    Scene *scene = make_mover(1);
+    scene_set_adaptive_substeps(scene, 0.8, 0, 8);
+    FixedStep *stepper = fixed_step_init(scene, DT, 10);
+    fixed_step_set_max_merge(stepper, 4);
+    // The first tick has no stats to go by, so it runs alone
+    assert(fixed_step_advance(stepper, DT) == 1);
+    // then the box moves 1/4 of its size per tick, so 3 ticks run as one
+    assert(fixed_step_advance(stepper, 3 * DT) == 3);
+    assert(scene_get_tick_stats(scene).substeps == 1);
+    assert(scene_get_dt(scene) == 3 * DT);
+    assert(vec_isclose(body_get_centroid(scene_get_body(scene, 0)),
+        (Vector) {1, 0}));
+    // Merging 4 at once moves it 1 size, which gets split back up
+    assert(fixed_step_advance(stepper, 4 * DT) == 4);
+    assert(scene_get_tick_stats(scene).substeps == 2);
+    fixed_step_free(stepper);
+    scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_off_by_default)
+    DO_TEST(test_splits_fast_ticks)
+    DO_TEST(test_substeps_match_short_ticks)
+    DO_TEST(test_deep_contacts_split)
+    DO_TEST(test_merges_calm_ticks)
+
+    puts("substeps_test PASS");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "timing.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+/* Keeps the CPU busy for about the given number of seconds */
+void work_for(double seconds) {
+    double start = timing_now();
+    while (timing_now() - start < seconds) {}
+}
+
+void test_now_is_wall_clock() {
+    double start = timing_now();
+    // Sleeping uses no CPU time, but wall-clock time still passes
+    struct timespec nap = {0, 20000000};
+    nanosleep(&nap, NULL);
+    double slept = timing_now() - start;
+    assert(slept >= 0.02);
+    assert(slept < 0.5);
+    // and the clock never runs backwards
+    double last = timing_now();
+    for (int i = 0; i < 1000; i++) {
+        double now = timing_now();
+        assert(now >= last);
+        last = now;
+    }
+}
+
+void test_unpaced_timer_measures() {
+    FrameTimer *timer = frame_timer_init(0);
+    assert(frame_timer_tick(timer) == 0);
+    assert(frame_timer_frames(timer) == 0);
+    assert(frame_timer_mean(timer) == 0);
+    for (int i = 0; i < 5; i++) {
+        work_for(0.004);
+        double frame = frame_timer_tick(timer);
+        assert(frame >= 0.004);
+    }
+    assert(frame_timer_frames(timer) == 5);
+    assert(frame_timer_min(timer) >= 0.004);
+    assert(frame_timer_max(timer) >= frame_timer_mean(timer));
+    assert(frame_timer_mean(timer) >= frame_timer_min(timer));
+    // Without pacing, every frame is busy the whole time
+    assert(frame_timer_busy(timer) <= frame_timer_mean(timer));
+    assert(frame_timer_busy(timer) >= 0.004);
+    frame_timer_reset_stats(timer);
+    assert(frame_timer_frames(timer) == 0);
+    assert(frame_timer_max(timer) == 0);
+    frame_timer_free(timer);
+}
+
+void test_paced_timer_holds_rate() {
+    const double FPS = 100;
+    const int FRAMES = 20;
+    FrameTimer *timer = frame_timer_init(FPS);
+    frame_timer_tick(timer);
+    double start = timing_now();
+    for (int i = 0; i < FRAMES; i++) {
+        work_for(0.002);
+        frame_timer_tick(timer);
+    }
+    double elapsed = timing_now() - start;
+    // The loop sleeps off the rest of each 10 ms frame
+    assert(elapsed >= (FRAMES - 1) / FPS);
+    assert(elapsed < 2 * FRAMES / FPS);
+    assert(frame_timer_busy(timer) < frame_timer_mean(timer));
+    // Pacing never lets frames run short; a loaded machine may run long
+    assert(frame_timer_mean(timer) >= 0.9 / FPS);
+    assert(frame_timer_mean(timer) < 2 / FPS);
+    frame_timer_free(timer);
+}
+
+void test_late_frames_dont_rush() {
+    const double FPS = 100;
+    FrameTimer *timer = frame_timer_init(FPS);
+    frame_timer_tick(timer);
+    // One long hitch...
+    work_for(0.05);
+    frame_timer_tick(timer);
+    // ...then the following frames still take a whole period each,
+    // instead of running back to back to make up for it
+    frame_timer_reset_stats(timer);
+    for (int i = 0; i < 5; i++) {
+        frame_timer_tick(timer);
+    }
+    assert(frame_timer_mean(timer) >= 0.9 / FPS);
+    frame_timer_free(timer);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_now_is_wall_clock)
+    DO_TEST(test_unpaced_timer_measures)
+    DO_TEST(test_paced_timer_holds_rate)
+    DO_TEST(test_late_frames_dont_rush)
+
+    puts("timing_test PASS");
+    return 0;
+}
@@ -4,6 +4,9 @@
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 
 /**
@@ -11,6 +14,46 @@
  **/
 typedef void nu_callback(int fd, char *str);
 
+/**
+ * Buffers what arrives on one connection, so it can be read a message at a
+ * time without a system call per message. Messages are handed out as views
+ * into the buffer, which stay valid until the next nu_reader_fill().
+ **/
+typedef struct nu_reader nu_reader;
+
+/**
+ * An event loop that waits on many connections at once with epoll (so it
+ * needs Linux) and calls back when they can be read or written, or when
+ * timers go off. One thread can serve hundreds of clients this way.
+ **/
+typedef struct nu_loop nu_loop;
+
+/**
+ * The longest frame nu_send_frame sends and nu_reader_next_frame accepts.
+ * Without a limit, a bad length prefix would make a reader try to allocate
+ * up to 4 GiB for a frame that never arrives.
+ **/
+#define NU_MAX_FRAME_SIZE (16 * 1024 * 1024)
+
+/**
+ * Specifies the type of callback the loop calls when fd is ready.
+ * aux is the value passed to nu_loop_add_fd.
+ **/
+typedef void nu_event_callback(nu_loop *loop, int fd, void *aux);
+
+/**
+ * Specifies the type of callback the loop calls when a timer goes off.
+ * aux is the value passed to nu_loop_add_timer.
+ **/
+typedef void nu_timer_callback(nu_loop *loop, void *aux);
+
+/**
+ * Listens on localhost:port for client connections, letting as many wait
+ * to be accepted as the system allows.
+ * Returns the listening socket, or -1 on error.
+ **/
+int nu_server_listen(int port);
+
 /**
  * Listens on localhost:port for a single client connection.
  * This function is blocking (i.e., it waits for a client to
@@ -34,6 +77,8 @@ int nu_send_str(int fd, char *str);
  * Attempts to read a string sent by nu_send_str from the open
  * connection represented by fd.
  * This function is non-blocking.
+ * Like nu_read_str, it reads through a reader kept for fd,
+ * and returns a copy that the caller must free.
  **/
 char *nu_try_read_str(int fd);
 
@@ -41,9 +86,140 @@ char *nu_try_read_str(int fd);
  * Reads a string sent by nu_send_str from the open 
  * connection represented by fd.
  * This function is blocking.
+ * Returns a copy that the caller must free, or NULL if the connection
+ * was closed or failed.
  **/
 char *nu_read_str(int fd);
 
+/**
+ * Sends a binary frame, prefixed with its length as a 4-byte big-endian
+ * integer, to the open connection represented by fd.
+ * On a blocking fd, this keeps writing until the whole frame has gone out.
+ * On a nonblocking fd, it stops once the socket is full, and returns fewer
+ * bytes than the frame and its prefix. The caller must then keep the rest
+ * and send it when fd can be written again (see nu_loop_want_write), or
+ * the other side will read garbage from then on.
+ * Returns the number of bytes sent, including the prefix, or -1 on error,
+ * including when nothing could be sent yet on a nonblocking fd (with errno
+ * set to EAGAIN), or when len is over NU_MAX_FRAME_SIZE (EMSGSIZE).
+ **/
+int nu_send_frame(int fd, const void *data, uint32_t len);
+
+/**
+ * Makes a reader for the open connection represented by fd.
+ **/
+nu_reader *nu_reader_init(int fd);
+
+/**
+ * Frees a reader. Does not close its connection.
+ **/
+void nu_reader_free(nu_reader *reader);
+
+/**
+ * Reads as much as is available into the reader's buffer with one read(),
+ * making room first, which invalidates views returned earlier.
+ * This function blocks if nothing has arrived yet.
+ * Returns the number of bytes read, 0 if the connection was closed,
+ * or -1 on error.
+ **/
+ssize_t nu_reader_fill(nu_reader *reader);
+
+/**
+ * Gets the next string ended by a NUL or a newline from the reader's buffer,
+ * without reading from the connection. The terminator is replaced by a NUL,
+ * and its length (not counting it) is stored in *len if len is not NULL.
+ * Returns NULL if no whole string has arrived yet.
+ **/
+char *nu_reader_next_str(nu_reader *reader, size_t *len);
+
+/**
+ * Gets the next frame sent by nu_send_frame from the reader's buffer,
+ * without reading from the connection, and stores its length in *len.
+ * The frame is binary, so it is not NUL-terminated.
+ * Returns NULL if no whole frame has arrived yet, with errno set to 0,
+ * or if the next frame is longer than NU_MAX_FRAME_SIZE, with errno set to
+ * EMSGSIZE. Nothing after a frame like that can be read, so the caller
+ * should close the connection.
+ **/
+char *nu_reader_next_frame(nu_reader *reader, size_t *len);
+
+/**
+ * Makes reads and writes on fd return right away (failing with EAGAIN)
+ * instead of waiting, as sockets in an event loop must.
+ * Returns 0, or -1 on error.
+ **/
+int nu_set_nonblocking(int fd);
+
+/**
+ * Accepts a client waiting on a socket from nu_server_listen,
+ * and makes its connection nonblocking.
+ * Returns the connection, or -1 if no client was waiting or on error.
+ **/
+int nu_accept_client(int listenfd);
+
+/**
+ * Makes an empty event loop.
+ * Returns NULL on error.
+ **/
+nu_loop *nu_loop_create(void);
+
+/**
+ * Frees an event loop and its timers. Does not close the fds in it.
+ **/
+void nu_loop_free(nu_loop *loop);
+
+/**
+ * Starts watching fd, which should be nonblocking.
+ * on_read is called whenever fd has something to read (or has been
+ * closed by the other side), and on_write whenever it can be written,
+ * as long as nu_loop_want_write has been turned on. Either may be NULL.
+ * They are called again every time the loop waits until they've read
+ * everything or stopped wanting to write.
+ * Returns 0, or -1 on error.
+ **/
+int nu_loop_add_fd(nu_loop *loop, int fd, nu_event_callback *on_read,
+    nu_event_callback *on_write, void *aux);
+
+/**
+ * Turns on_write calls for fd on or off. They start off, since most sockets
+ * can be written almost always; turn them on when a send comes up short
+ * and off once everything has gone out.
+ * Returns 0, or -1 on error.
+ **/
+int nu_loop_want_write(nu_loop *loop, int fd, bool want);
+
+/**
+ * Stops watching fd. Safe to call from fd's own callbacks,
+ * e.g. just before closing it.
+ **/
+void nu_loop_remove_fd(nu_loop *loop, int fd);
+
+/**
+ * Calls callback after delay_ms milliseconds, and then every interval_ms
+ * milliseconds if interval_ms is positive.
+ * Returns an id for nu_loop_cancel_timer.
+ **/
+int nu_loop_add_timer(nu_loop *loop, long delay_ms, long interval_ms,
+    nu_timer_callback *callback, void *aux);
+
+/**
+ * Stops a timer from going off again. Safe to call from any callback.
+ **/
+void nu_loop_cancel_timer(nu_loop *loop, int id);
+
+/**
+ * Waits for events and calls their callbacks until nu_loop_stop is called,
+ * or there are no fds or timers left to wait for.
+ * This function is blocking.
+ * Returns 0, or -1 on error.
+ **/
+int nu_loop_run(nu_loop *loop);
+
+/**
+ * Makes nu_loop_run return once the current callback does.
+ **/
+void nu_loop_stop(nu_loop *loop);
+
 /**
  * This function allows a client to simultaneously multiplex over two file descriptors
  * (which could be sockets or files).
@@ -52,7 +228,8 @@ char *nu_read_str(int fd);
 int nu_multiplex(int localfd, int remotefd, nu_callback on_local_write, nu_callback on_remote_write);
 
 /**
- * Closes a connection opened by nu_wait_client or nu_connect_server.
+ * Closes a connection opened by nu_wait_client or nu_connect_server,
+ * freeing the reader nu_read_str kept for it.
  **/
 void nu_close_connection(int fd);
 
@@ -5,12 +5,24 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 
 #include "network_util.h"
 
-#define INITIAL_BUFFER_SIZE 2
+// A reader's buffer starts this big, so most reads get everything waiting
+#define INITIAL_BUFFER_SIZE 65536
 #define RESIZE_MULTIPLIER 2
-#define LISTENQ 50
+#define FRAME_PREFIX_SIZE sizeof(uint32_t)
+// Most events nu_loop_run takes from epoll per wait
+#define MAX_EVENTS 64
+#define MS_PER_S 1000
+#define NS_PER_MS 1000000
+// Connections the kernel queues until accepted; bursts past this are dropped
+#define LISTENQ SOMAXCONN
 
 #define max(a,b) (a > b ? a : b)
 
@@ -18,6 +30,7 @@ int nu_server_listen(int port) {
     int myfd = 0;
     if ((myfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
         perror("socket");
+        return -1;
     }
 
     struct sockaddr_in server_addr;
@@ -89,70 +102,217 @@ int nu_send_str(int fd, char *str) {
     return len;
 }
 
-static int num_extra_chars;
-static char extra_chars[INITIAL_BUFFER_SIZE];
+int nu_send_frame(int fd, const void *data, uint32_t len) {
+    if (len > NU_MAX_FRAME_SIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    uint32_t prefix = htonl(len);
+    struct iovec parts[2] = {
+        {.iov_base = &prefix, .iov_len = FRAME_PREFIX_SIZE},
+        {.iov_base = (void *) data, .iov_len = len}
+    };
+    struct iovec *part = parts;
+    int parts_left = 2;
+    size_t sent = 0;
+    while (parts_left > 0) {
+        ssize_t written = writev(fd, part, parts_left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* A nonblocking fd is full: report what did go out, so the
+             * caller can send the rest once it can be written again */
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && sent > 0) {
+                return sent;
+            }
+            return -1;
+        }
+        sent += written;
+        /* Skip the parts that have gone out, and what of the next has */
+        while (parts_left > 0 && (size_t) written >= part->iov_len) {
+            written -= part->iov_len;
+            part++;
+            parts_left--;
+        }
+        if (parts_left > 0) {
+            part->iov_base = (char *) part->iov_base + written;
+            part->iov_len -= written;
+        }
+    }
+    return sent;
+}
+
+/* The unread bytes are buf[start] to buf[end - 1]. Reads append at end, and
+ * the unread bytes are only moved back to the front when the end of the
+ * buffer is reached, so every message is contiguous and can be handed out
+ * in place. */
+struct nu_reader {
+    int fd;
+    char *buf;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    size_t scanned;     // unread bytes already checked for a terminator
+    size_t wanted;      // unread bytes the next frame needs, if known
+};
+
+nu_reader *nu_reader_init(int fd) {
+    nu_reader *reader = malloc(sizeof(nu_reader));
+    assert(reader);
+    reader->fd = fd;
+    reader->buf = malloc(INITIAL_BUFFER_SIZE);
+    assert(reader->buf);
+    reader->capacity = INITIAL_BUFFER_SIZE;
+    reader->start = reader->end = 0;
+    reader->scanned = 0;
+    reader->wanted = 0;
+    return reader;
+}
+
+void nu_reader_free(nu_reader *reader) {
+    free(reader->buf);
+    free(reader);
+}
+
+ssize_t nu_reader_fill(nu_reader *reader) {
+    size_t unread = reader->end - reader->start;
+    if (unread == 0) {
+        reader->start = reader->end = 0;
+    }
 
-int nu_check_for_terminator(char *buf, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        if (buf[i] == '\n') {
-            buf[i] = '\0';
+    /* If there's no room left at the end, move the unread bytes to the
+     * front, and if a whole frame still won't fit, grow the buffer. */
+    if (reader->end == reader->capacity
+            || reader->start + reader->wanted > reader->capacity) {
+        memmove(reader->buf, reader->buf + reader->start, unread);
+        reader->start = 0;
+        reader->end = unread;
+        size_t needed = max(reader->wanted, unread + 1);
+        while (reader->capacity < needed) {
+            reader->capacity *= RESIZE_MULTIPLIER;
         }
-        if (buf[i] == '\0') {
-            return i;
+        reader->buf = realloc(reader->buf, reader->capacity);
+        assert(reader->buf);
+    }
+
+    ssize_t actually_read = read(reader->fd, reader->buf + reader->end,
+        reader->capacity - reader->end);
+    if (actually_read > 0) {
+        reader->end += actually_read;
+    }
+    return actually_read;
+}
+
+char *nu_reader_next_str(nu_reader *reader, size_t *len) {
+    char *str = reader->buf + reader->start;
+    size_t unread = reader->end - reader->start;
+    for (size_t i = reader->scanned; i < unread; i++) {
+        if (str[i] == '\n' || str[i] == '\0') {
+            str[i] = '\0';
+            reader->start += i + 1;
+            reader->scanned = 0;
+            if (len != NULL) {
+                *len = i;
+            }
+            return str;
         }
     }
-    return -1;
+    reader->scanned = unread;
+    return NULL;
 }
 
-char *nu_read_str(int fd) {
-    size_t current_buffer_size = INITIAL_BUFFER_SIZE;
-    char *buf = malloc(current_buffer_size);
+char *nu_reader_next_frame(nu_reader *reader, size_t *len) {
+    char *prefix = reader->buf + reader->start;
+    size_t unread = reader->end - reader->start;
+    if (unread < FRAME_PREFIX_SIZE) {
+        reader->wanted = FRAME_PREFIX_SIZE;
+        errno = 0;
+        return NULL;
+    }
+    uint32_t frame_len;
+    memcpy(&frame_len, prefix, FRAME_PREFIX_SIZE);
+    frame_len = ntohl(frame_len);
+    /* Don't grow the buffer for a frame we'd refuse anyway */
+    if (frame_len > NU_MAX_FRAME_SIZE) {
+        reader->wanted = 0;
+        errno = EMSGSIZE;
+        return NULL;
+    }
+    if (unread < FRAME_PREFIX_SIZE + frame_len) {
+        reader->wanted = FRAME_PREFIX_SIZE + frame_len;
+        errno = 0;
+        return NULL;
+    }
+    reader->start += FRAME_PREFIX_SIZE + frame_len;
+    reader->scanned = 0;
+    reader->wanted = 0;
+    *len = frame_len;
+    return prefix + FRAME_PREFIX_SIZE;
+}
 
-    memcpy(buf, extra_chars, num_extra_chars);
-    char *curr = buf + num_extra_chars;
+/* The readers nu_read_str and nu_try_read_str use, indexed by fd */
+static nu_reader **readers;
+static size_t num_readers;
 
+static nu_reader *nu_reader_for(int fd) {
+    if ((size_t) fd >= num_readers) {
+        size_t count = max((size_t) fd + 1, num_readers * RESIZE_MULTIPLIER);
+        readers = realloc(readers, count * sizeof(nu_reader *));
+        assert(readers);
+        memset(readers + num_readers, 0,
+            (count - num_readers) * sizeof(nu_reader *));
+        num_readers = count;
+    }
+    if (readers[fd] == NULL) {
+        readers[fd] = nu_reader_init(fd);
+    }
+    return readers[fd];
+}
+
+/* Copies the next whole string out of the reader, if there is one */
+static char *nu_copy_next_str(nu_reader *reader) {
+    size_t len;
+    char *str = nu_reader_next_str(reader, &len);
+    if (str == NULL) {
+        return NULL;
+    }
+    char *copy = malloc(len + 1);
+    assert(copy);
+    memcpy(copy, str, len + 1);
+    return copy;
+}
+
+char *nu_read_str(int fd) {
+    nu_reader *reader = nu_reader_for(fd);
     while (1) {
-        size_t to_read = INITIAL_BUFFER_SIZE - num_extra_chars;
-        num_extra_chars = 0;
-        ssize_t actually_read = read(fd, extra_chars, to_read);
+        char *str = nu_copy_next_str(reader);
+        if (str != NULL) {
+            return str;
+        }
 
-        /* If there was an error, destroy the buffer and indicate 
-         * an error has occurred. */
+        /* If there was an error, or the other side hung up before
+         * finishing the string, indicate an error has occurred. */
+        ssize_t actually_read = nu_reader_fill(reader);
         if (actually_read < 0) {
             perror("recv");
-            free(buf);
             return NULL;
         }
-
-        /* If we're out of space, realloc the buffer to include 
-         * more space. */
-        if ((curr - buf) + actually_read > current_buffer_size) {
-            buf = realloc(buf, current_buffer_size * RESIZE_MULTIPLIER); 
-            curr = buf + current_buffer_size; 
-            current_buffer_size *= RESIZE_MULTIPLIER;
-        }
-
-        memcpy(curr, extra_chars, actually_read);
-
-        /* If the block of bytes has a null terminator in it, then we need
-         * to finish the string and save the rest for the next call to
-         * this function. */
-        int terminator = nu_check_for_terminator(extra_chars, actually_read);
-        if (terminator != -1) {
-            num_extra_chars = actually_read - terminator - 1;
-            memcpy(extra_chars, curr + terminator + 1, num_extra_chars);
-            curr += terminator;
-            *curr = '\0';
-            return buf;
+        if (actually_read == 0) {
+            return NULL;
         }
-        curr += actually_read;
     }
-
-    // Execution should never reach here...
-    assert(false);
 }
 
 char *nu_try_read_str(int fd) {
+    /* A string may already be waiting in the buffer, in which case
+     * select wouldn't report anything new to read. */
+    nu_reader *reader = nu_reader_for(fd);
+    char *str = nu_copy_next_str(reader);
+    if (str != NULL) {
+        return str;
+    }
+
     fd_set rd;
     FD_ZERO(&rd);
     FD_SET(fd, &rd);
@@ -166,13 +326,17 @@ char *nu_try_read_str(int fd) {
     if ((result = select(fd + 1, &rd, NULL, NULL, &tv)) < 0) {
         return NULL;
     }
-    if (FD_ISSET(fd, &rd)) {
-        return nu_read_str(fd);
+    if (FD_ISSET(fd, &rd) && nu_reader_fill(reader) > 0) {
+        return nu_copy_next_str(reader);
     }
     return NULL;
 }
 
 void nu_close_connection(int fd) {
+    if ((size_t) fd < num_readers && readers[fd] != NULL) {
+        nu_reader_free(readers[fd]);
+        readers[fd] = NULL;
+    }
     close(fd);
 }
 
@@ -189,11 +353,314 @@ int nu_multiplex(int localfd, int remotefd, nu_callback on_local_write, nu_callb
             perror("select");
             return -1;
         }
+        /* One read may bring in several strings, and select won't
+         * report the ones left in the buffer, so hand them all over. */
+        char *str;
         if (FD_ISSET(remotefd, &rd)) {
             on_remote_write(remotefd, nu_read_str(remotefd));
+            while ((str = nu_copy_next_str(nu_reader_for(remotefd))) != NULL) {
+                on_remote_write(remotefd, str);
+            }
         }
         if (FD_ISSET(localfd, &rd)) {
             on_local_write(remotefd, nu_read_str(localfd));
+            while ((str = nu_copy_next_str(nu_reader_for(localfd))) != NULL) {
+                on_local_write(remotefd, str);
+            }
+        }
+    }
+}
+
+int nu_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        perror("fcntl");
+        return -1;
+    }
+    return 0;
+}
+
+int nu_accept_client(int listenfd) {
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_size = sizeof(struct sockaddr_in);
+    int clientfd = accept(listenfd, (struct sockaddr *) &client_addr, &client_addr_size);
+    if (clientfd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("accept");
+        }
+        return -1;
+    }
+    if (nu_set_nonblocking(clientfd) < 0) {
+        close(clientfd);
+        return -1;
+    }
+    return clientfd;
+}
+
+/* What the loop does when an fd is ready */
+typedef struct {
+    bool registered;
+    bool want_write;
+    nu_event_callback *on_read;
+    nu_event_callback *on_write;
+    void *aux;
+} nu_watch;
+
+typedef struct {
+    long deadline;      // in milliseconds on the monotonic clock
+    long interval;
+    int id;
+    nu_timer_callback *callback;    // NULL once cancelled
+    void *aux;
+} nu_timer;
+
+struct nu_loop {
+    int epfd;
+    nu_watch *watches;      // indexed by fd
+    size_t num_watches;
+    size_t num_fds;         // how many fds are registered
+    nu_timer *timers;       // a binary heap, soonest deadline first
+    size_t num_timers;
+    size_t timer_capacity;
+    int next_timer_id;
+    bool stopped;
+};
+
+static long now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * MS_PER_S + now.tv_nsec / NS_PER_MS;
+}
+
+nu_loop *nu_loop_create(void) {
+    nu_loop *loop = malloc(sizeof(nu_loop));
+    assert(loop);
+    loop->epfd = epoll_create1(0);
+    if (loop->epfd < 0) {
+        perror("epoll_create1");
+        free(loop);
+        return NULL;
+    }
+    loop->watches = NULL;
+    loop->num_watches = 0;
+    loop->num_fds = 0;
+    loop->timers = NULL;
+    loop->num_timers = 0;
+    loop->timer_capacity = 0;
+    loop->next_timer_id = 0;
+    loop->stopped = false;
+    return loop;
+}
+
+void nu_loop_free(nu_loop *loop) {
+    close(loop->epfd);
+    free(loop->watches);
+    free(loop->timers);
+    free(loop);
+}
+
+/* The epoll events to wait for on a watched fd */
+static uint32_t nu_watch_events(nu_watch *watch) {
+    return (watch->on_read ? EPOLLIN : 0) | (watch->want_write ? EPOLLOUT : 0);
+}
+
+int nu_loop_add_fd(nu_loop *loop, int fd, nu_event_callback *on_read,
+    nu_event_callback *on_write, void *aux) {
+    if ((size_t) fd >= loop->num_watches) {
+        size_t count = max((size_t) fd + 1, loop->num_watches * RESIZE_MULTIPLIER);
+        loop->watches = realloc(loop->watches, count * sizeof(nu_watch));
+        assert(loop->watches);
+        memset(loop->watches + loop->num_watches, 0,
+            (count - loop->num_watches) * sizeof(nu_watch));
+        loop->num_watches = count;
+    }
+    nu_watch *watch = &loop->watches[fd];
+    assert(!watch->registered);
+    *watch = (nu_watch) {
+        .registered = true,
+        .want_write = false,
+        .on_read = on_read,
+        .on_write = on_write,
+        .aux = aux
+    };
+    struct epoll_event event = {.events = nu_watch_events(watch), .data.fd = fd};
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        perror("epoll_ctl");
+        watch->registered = false;
+        return -1;
+    }
+    loop->num_fds++;
+    return 0;
+}
+
+int nu_loop_want_write(nu_loop *loop, int fd, bool want) {
+    assert((size_t) fd < loop->num_watches && loop->watches[fd].registered);
+    nu_watch *watch = &loop->watches[fd];
+    if (watch->want_write == want) {
+        return 0;
+    }
+    watch->want_write = want;
+    struct epoll_event event = {.events = nu_watch_events(watch), .data.fd = fd};
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &event) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+void nu_loop_remove_fd(nu_loop *loop, int fd) {
+    if ((size_t) fd >= loop->num_watches || !loop->watches[fd].registered) {
+        return;
+    }
+    /* Fails if fd was already closed, which removed it anyway */
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+    loop->watches[fd].registered = false;
+    loop->num_fds--;
+}
+
+static void nu_timer_swap(nu_loop *loop, size_t i, size_t j) {
+    nu_timer temp = loop->timers[i];
+    loop->timers[i] = loop->timers[j];
+    loop->timers[j] = temp;
+}
+
+static void nu_timer_push(nu_loop *loop, nu_timer timer) {
+    if (loop->num_timers == loop->timer_capacity) {
+        loop->timer_capacity = max(1, loop->timer_capacity * RESIZE_MULTIPLIER);
+        loop->timers = realloc(loop->timers,
+            loop->timer_capacity * sizeof(nu_timer));
+        assert(loop->timers);
+    }
+    /* Sift the new timer up past every later one */
+    size_t i = loop->num_timers++;
+    loop->timers[i] = timer;
+    while (i > 0 && loop->timers[(i - 1) / 2].deadline > loop->timers[i].deadline) {
+        nu_timer_swap(loop, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static nu_timer nu_timer_pop(nu_loop *loop) {
+    nu_timer first = loop->timers[0];
+    loop->timers[0] = loop->timers[--loop->num_timers];
+    /* Sift the moved timer down past every earlier one */
+    size_t i = 0;
+    while (1) {
+        size_t soonest = i;
+        size_t left = 2 * i + 1;
+        size_t right = 2 * i + 2;
+        if (left < loop->num_timers
+                && loop->timers[left].deadline < loop->timers[soonest].deadline) {
+            soonest = left;
+        }
+        if (right < loop->num_timers
+                && loop->timers[right].deadline < loop->timers[soonest].deadline) {
+            soonest = right;
+        }
+        if (soonest == i) {
+            return first;
+        }
+        nu_timer_swap(loop, i, soonest);
+        i = soonest;
+    }
+}
+
+int nu_loop_add_timer(nu_loop *loop, long delay_ms, long interval_ms,
+    nu_timer_callback *callback, void *aux) {
+    nu_timer timer = {
+        .deadline = now_ms() + delay_ms,
+        .interval = interval_ms,
+        .id = loop->next_timer_id++,
+        .callback = callback,
+        .aux = aux
+    };
+    nu_timer_push(loop, timer);
+    return timer.id;
+}
+
+void nu_loop_cancel_timer(nu_loop *loop, int id) {
+    /* Cancelled timers stay in the heap until their deadline comes up */
+    for (size_t i = 0; i < loop->num_timers; i++) {
+        if (loop->timers[i].id == id) {
+            loop->timers[i].callback = NULL;
         }
     }
 }
+
+/* Calls the callbacks of the timers that are due, rescheduling repeating ones */
+static void nu_loop_run_timers(nu_loop *loop) {
+    long now = now_ms();
+    while (loop->num_timers > 0 && loop->timers[0].deadline <= now
+            && !loop->stopped) {
+        nu_timer timer = nu_timer_pop(loop);
+        if (timer.callback == NULL) {
+            continue;
+        }
+        /* Rescheduled first, so the callback can cancel it */
+        if (timer.interval > 0) {
+            nu_timer next = timer;
+            next.deadline += timer.interval;
+            nu_timer_push(loop, next);
+        }
+        timer.callback(loop, timer.aux);
+    }
+}
+
+int nu_loop_run(nu_loop *loop) {
+    struct epoll_event events[MAX_EVENTS];
+    loop->stopped = false;
+    while (!loop->stopped) {
+        while (loop->num_timers > 0 && loop->timers[0].callback == NULL) {
+            nu_timer_pop(loop);
+        }
+        if (loop->num_fds == 0 && loop->num_timers == 0) {
+            return 0;
+        }
+
+        /* Wait for an fd, or until the next timer is due */
+        int timeout = -1;
+        if (loop->num_timers > 0) {
+            long wait = loop->timers[0].deadline - now_ms();
+            if (wait < 0) {
+                timeout = 0;
+            }
+            else if (wait > INT_MAX) {
+                timeout = INT_MAX;
+            }
+            else {
+                timeout = (int) wait;
+            }
+        }
+        int n = epoll_wait(loop->epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            return -1;
+        }
+
+        /* A callback may remove an fd that has an event later in the batch,
+         * so each one checks that its fd is still watched */
+        for (int i = 0; i < n && !loop->stopped; i++) {
+            int fd = events[i].data.fd;
+            nu_watch *watch = &loop->watches[fd];
+            if (watch->registered && watch->on_read
+                    && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                watch->on_read(loop, fd, watch->aux);
+            }
+            /* on_read may have added fds, moving the watches */
+            watch = &loop->watches[fd];
+            if (watch->registered && watch->want_write && watch->on_write
+                    && (events[i].events & EPOLLOUT) && !loop->stopped) {
+                watch->on_write(loop, fd, watch->aux);
+            }
+        }
+        nu_loop_run_timers(loop);
+    }
+    return 0;
+}
+
+void nu_loop_stop(nu_loop *loop) {
+    loop->stopped = true;
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
+#include <time.h>
 
 #include "list.h"
 #include "sdl_wrapper.h"
@@ -10,6 +11,50 @@
 #include "polygon.h"
 #include "network_util.h"
 
+/*
+ * The game runs in fixed frames, numbered from when the players connect.
+ * Each player sends "<frame> <direction>" for every move they make.
+ * Local moves apply right away, and the other player is predicted to stand
+ * still. When one of their moves turns up, it is slotted into the frame it
+ * was made in, and the frames since are played again from the state saved
+ * at that frame (rollback), so latency never shows up as input lag.
+ */
+#define FRAMES_PER_SECOND 60
+#define NS_PER_S 1000000000L
+// How many frames back a move can be rolled back into. Older moves count
+// as made in the oldest frame kept. Replaying them all takes microseconds,
+// since a frame only moves two squares.
+#define HISTORY_FRAMES 256
+#define MESSAGE_SIZE 32
+
+#define CLIENT 0
+#define SERVER 1
+
+/* Everything that changes as the game runs, saved every frame */
+typedef struct {
+    Vector position[2];
+} GameState;
+
+/* The moves each player made during a frame, added up */
+typedef struct {
+    Vector move[2];
+} FrameInput;
+
+const Vector MIN = {0, 0};
+const Vector MAX = {20, 10};
+
+int conn;
+int me;
+int them;
+List *squares[2];
+Vector drawn[2];    // where squares[i] has been translated to
+
+long frame;     // the frame being played, which hasn't been simulated yet
+// The state at the start of each of the last HISTORY_FRAMES frames and the
+// moves made during it, at index frame % HISTORY_FRAMES
+GameState states[HISTORY_FRAMES];
+FrameInput inputs[HISTORY_FRAMES];
+
 List *make_square() {
     List *sq = list_init(4, free);
     Vector *v = malloc(sizeof(*v));
@@ -27,43 +72,112 @@ List *make_square() {
     return sq;
 }
 
-int conn;
-List *me;
-List *them;
+Vector direction(char *dir) {
+    if (strcmp(dir, "up") == 0) {         return (Vector){0, 1};  }
+    else if (strcmp(dir, "down") == 0) {  return (Vector){0, -1}; }
+    else if (strcmp(dir, "left") == 0) {  return (Vector){-1, 0}; }
+    else if (strcmp(dir, "right") == 0) { return (Vector){1, 0};  }
+    else { exit(0); }
+}
 
-void move(List *who, char *dir) {
-    Vector translation;
+/* Keeps a square's center far enough inside the window to show all of it */
+Vector keep_on_screen(Vector position) {
+    position.x = fmin(fmax(position.x, MIN.x + 1), MAX.x - 1);
+    position.y = fmin(fmax(position.y, MIN.y + 1), MAX.y - 1);
+    return position;
+}
 
-    if (strcmp(dir, "up") == 0) {         translation = (Vector){0, 1};  }
-    else if (strcmp(dir, "down") == 0) {  translation = (Vector){0, -1}; }
-    else if (strcmp(dir, "left") == 0) {  translation = (Vector){-1, 0}; }
-    else if (strcmp(dir, "right") == 0) { translation = (Vector){1, 0};  }
-    else { exit(0); }
+/* Plays one frame. It must only depend on its arguments, so replays match */
+GameState simulate(GameState state, FrameInput input) {
+    for (int i = 0; i < 2; i++) {
+        state.position[i] =
+            keep_on_screen(vec_add(state.position[i], input.move[i]));
+    }
+    return state;
+}
+
+GameState *state_at(long f) {
+    return &states[f % HISTORY_FRAMES];
+}
+
+FrameInput *input_at(long f) {
+    return &inputs[f % HISTORY_FRAMES];
+}
 
-    polygon_translate(who, translation);
+/* Ends the current frame and starts the next, predicting no moves in it */
+void advance_frame() {
+    *state_at(frame + 1) = simulate(*state_at(frame), *input_at(frame));
+    frame++;
+    *input_at(frame) = (FrameInput) {{VEC_ZERO, VEC_ZERO}};
+}
+
+/* Adds a move the other player made in frame f, then replays from there */
+void rollback(long f, Vector move) {
+    // Moves stamped in the future (their clock runs ahead) happen now
+    if (f > frame) {
+        f = frame;
+    }
+    long oldest = frame - HISTORY_FRAMES + 1;
+    if (f < oldest || f < 0) {
+        f = oldest > 0 ? oldest : 0;
+    }
+    input_at(f)->move[them] = vec_add(input_at(f)->move[them], move);
+    for (long g = f; g < frame; g++) {
+        *state_at(g + 1) = simulate(*state_at(g), *input_at(g));
+    }
 }
 
 void on_key(char key, KeyEventType type, double held_time) {
-    if (type == KEY_PRESSED) {
-        switch (key) {
-            case UP_ARROW:
-                move(me, "up"); 
-                nu_send_str(conn, "up");
-                break;
-            case DOWN_ARROW:
-                move(me, "down"); 
-                nu_send_str(conn, "down");
-                break;
-            case LEFT_ARROW:
-                move(me, "left"); 
-                nu_send_str(conn, "left");
-                break;
-            case RIGHT_ARROW:
-                move(me, "right"); 
-                nu_send_str(conn, "right");
-                break;
-        }
+    if (type != KEY_PRESSED) {
+        return;
+    }
+    char *dir;
+    switch (key) {
+        case UP_ARROW: dir = "up"; break;
+        case DOWN_ARROW: dir = "down"; break;
+        case LEFT_ARROW: dir = "left"; break;
+        case RIGHT_ARROW: dir = "right"; break;
+        default: return;
+    }
+    input_at(frame)->move[me] = vec_add(input_at(frame)->move[me], \
+        direction(dir));
+    char message[MESSAGE_SIZE];
+    snprintf(message, sizeof(message), "%ld %s", frame, dir);
+    nu_send_str(conn, message);
+}
+
+/* Handles one message from the other player */
+void on_remote(char *remote) {
+    long f;
+    char dir[MESSAGE_SIZE];
+    if (strcmp(remote, "close window") == 0) {
+        free(remote);
+        nu_close_connection(conn);
+        exit(0);
+    }
+    if (sscanf(remote, "%ld %31s", &f, dir) != 2) {
+        exit(0);
+    }
+    rollback(f, direction(dir));
+}
+
+/* Moves the squares' vertices to where the given state has them */
+void draw(GameState state) {
+    for (int i = 0; i < 2; i++) {
+        polygon_translate(squares[i], \
+            vec_subtract(state.position[i], drawn[i]));
+        drawn[i] = state.position[i];
     }
+    sdl_clear();
+    sdl_draw_polygon(squares[CLIENT], (RGBColor) {1, 0, 0});
+    sdl_draw_polygon(squares[SERVER], (RGBColor) {0, 0, 1});
+    sdl_show();
+}
+
+long now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NS_PER_S + now.tv_nsec;
 }
 
 int make_connection(int argc, char **argv) {
@@ -96,55 +210,50 @@ int make_connection(int argc, char **argv) {
 
 int main(int argc, char **argv){
     conn = make_connection(argc, argv);
-    
-    printf("Type something and it will be transferred to the other party!\nType 'quit' to end the connection.\n");
 
-    // Create a shape
-    List *a = make_square();
-    List *b = make_square();
+    printf("Use the arrow keys to move your square!\n");
 
-    // Translate to the center of area
-    Vector center = {.x = 10.0, .y = 5.0};
-    polygon_translate(a, (Vector){1, 2});
-    polygon_translate(b, (Vector){19, 2});
+    // Create the squares, centered at the origin until first drawn
+    squares[CLIENT] = make_square();
+    squares[SERVER] = make_square();
+    drawn[CLIENT] = drawn[SERVER] = VEC_ZERO;
 
     if (strcmp(argv[1], "server") == 0) {
-        me = b;
-        them = a;
+        me = SERVER;
+        them = CLIENT;
     } else {
-        me = a;
-        them = b;
+        me = CLIENT;
+        them = SERVER;
     }
 
+    frame = 0;
+    state_at(0)->position[CLIENT] = (Vector){1, 2};
+    state_at(0)->position[SERVER] = (Vector){19, 2};
+    *input_at(0) = (FrameInput) {{VEC_ZERO, VEC_ZERO}};
+
     // Setup view
-    Vector min = VEC_ZERO;
-    Vector max = vec_add(center, center);
-    sdl_init(min, max);
+    sdl_init(MIN, MAX);
 
     sdl_on_key(on_key);
 
-    // Move shape
+    long next_frame = now_ns() + NS_PER_S / FRAMES_PER_SECOND;
     while (!sdl_is_done()) {
-        sdl_clear();
-        sdl_draw_polygon(a, (RGBColor) {1, 0, 0});
-        sdl_draw_polygon(b, (RGBColor) {0, 0, 1});
-        sdl_show();
-
-        char *remote = nu_try_read_str(conn);
-        if (remote != NULL) {
-            if (strcmp(remote, "close window") == 0) {
-                free(remote);
-                nu_close_connection(conn);
-                exit(0);
-            }
-            else {
-                move(them, remote);
-            }
+        char *remote;
+        while ((remote = nu_try_read_str(conn)) != NULL) {
+            on_remote(remote);
             free(remote);
         }
+        while (now_ns() >= next_frame) {
+            advance_frame();
+            next_frame += NS_PER_S / FRAMES_PER_SECOND;
+        }
+        // Show the moves made so far this frame too, so they show up at once
+        draw(simulate(*state_at(frame), *input_at(frame)));
     }
 
     nu_send_str(conn, "close window");
     nu_close_connection(conn);
+    list_free(squares[CLIENT]);
+    list_free(squares[SERVER]);
     return 0;
 }
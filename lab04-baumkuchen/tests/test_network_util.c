@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "network_util.h"
+
+#define FRAME_SIZE (1024 * 1024)
+#define SMALL_SNDBUF 4096
+
+/* A connected pair of sockets whose send buffer holds only a few pages,
+ * so big frames can't go out in one write */
+void small_socketpair(int sv[2]) {
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    int size = SMALL_SNDBUF;
+    assert(setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) == 0);
+}
+
+char *make_frame(void) {
+    char *data = malloc(FRAME_SIZE);
+    assert(data);
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        data[i] = (char) (i * 7);
+    }
+    return data;
+}
+
+/* Reads frames from fd in a child process, checking each against data,
+ * and exits with how many matched */
+pid_t check_frames(int fd, const char *data, int count) {
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid > 0) {
+        return pid;
+    }
+    nu_reader *reader = nu_reader_init(fd);
+    int matched = 0;
+    for (int i = 0; i < count; i++) {
+        size_t len;
+        char *frame;
+        while ((frame = nu_reader_next_frame(reader, &len)) == NULL) {
+            if (nu_reader_fill(reader) <= 0) {
+                exit(matched);
+            }
+        }
+        if (len == FRAME_SIZE && memcmp(frame, data, len) == 0) {
+            matched++;
+        }
+    }
+    nu_reader_free(reader);
+    exit(matched);
+}
+
+int wait_for(pid_t pid) {
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status));
+    return WEXITSTATUS(status);
+}
+
+void test_blocking_send_writes_everything() {
+    int sv[2];
+    small_socketpair(sv);
+    char *data = make_frame();
+    pid_t reader = check_frames(sv[1], data, 2);
+    close(sv[1]);
+    for (int i = 0; i < 2; i++) {
+        assert(nu_send_frame(sv[0], data, FRAME_SIZE) == 4 + FRAME_SIZE);
+    }
+    close(sv[0]);
+    assert(wait_for(reader) == 2);
+    free(data);
+}
+
+void test_nonblocking_send_reports_short_writes() {
+    int sv[2];
+    small_socketpair(sv);
+    char *data = make_frame();
+    nu_set_nonblocking(sv[0]);
+    // Nobody is reading yet, so only part of the frame fits
+    int sent = nu_send_frame(sv[0], data, FRAME_SIZE);
+    assert(sent > 4 && sent < 4 + FRAME_SIZE);
+    // Nothing more fits until the other side reads
+    assert(nu_send_frame(sv[0], data, FRAME_SIZE) == -1);
+    assert(errno == EAGAIN || errno == EWOULDBLOCK);
+
+    // Sending the rest once the reader drains keeps the stream in step
+    pid_t reader = check_frames(sv[1], data, 1);
+    close(sv[1]);
+    int flags = fcntl(sv[0], F_GETFL);
+    assert(fcntl(sv[0], F_SETFL, flags & ~O_NONBLOCK) == 0);
+    size_t done = sent - 4;
+    while (done < FRAME_SIZE) {
+        ssize_t written = write(sv[0], data + done, FRAME_SIZE - done);
+        assert(written > 0);
+        done += written;
+    }
+    close(sv[0]);
+    assert(wait_for(reader) == 1);
+    free(data);
+}
+
+void test_oversize_frames_are_refused() {
+    int sv[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    unsigned char prefix[] = {0xff, 0xff, 0xff, 0xff};
+    assert(write(sv[0], prefix, sizeof(prefix)) == sizeof(prefix));
+    nu_reader *reader = nu_reader_init(sv[1]);
+    size_t len;
+    assert(nu_reader_fill(reader) > 0);
+    assert(nu_reader_next_frame(reader, &len) == NULL);
+    assert(errno == EMSGSIZE);
+    nu_reader_free(reader);
+    assert(nu_send_frame(sv[0], prefix, NU_MAX_FRAME_SIZE + 1) == -1);
+    assert(errno == EMSGSIZE);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main(void) {
+    test_blocking_send_writes_everything();
+    test_nonblocking_send_reports_short_writes();
+    test_oversize_frames_are_refused();
+    puts("network_util_test PASS");
+    return 0;
+}